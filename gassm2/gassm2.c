@@ -22,15 +22,25 @@
 #include "reads.h"
 #include "pointer_array.h"
 #include "librcorrect.h"
+#include "ref-profile.h"
 #include "gassm2.h"
 
 
-UTILS_TYPED_CALLOC_FUNCTION(GEN_ARRAY_ONE_READ)
+UTILS_TYPED_CALLOC_FUNCTION(GEN_ARRAY_READ_VIEW)
+UTILS_TYPED_CALLOC_FUNCTION(GEN_ARRAY_char)
 UTILS_TYPED_CALLOC_FUNCTION(GEN_ARRAY_VARIANT_CALL)
-
-
-static PUTILS_LOOKASIDE *_vertexLAs;
-static PUTILS_LOOKASIDE *_edgeLAs;
+UTILS_TYPED_CALLOC_FUNCTION(VC_INDEX)
+UTILS_TYPED_CALLOC_FUNCTION(UTILS_ARENA)
+UTILS_TYPED_CALLOC_FUNCTION(GRAPH_MEMORY_STATISTICS)
+UTILS_TYPED_CALLOC_FUNCTION(READ_COVERAGE_STATISTICS)
+UTILS_TYPED_CALLOC_FUNCTION(GRAPH_LOOKASIDES)
+UTILS_TYPED_CALLOC_FUNCTION(ONE_READ)
+
+
+static PGRAPH_LOOKASIDES _graphLAs;
+static PUTILS_ARENA _graphArenas;
+static PGRAPH_MEMORY_STATISTICS _graphMemoryStats;
+static PREAD_COVERAGE_STATISTICS _readCoverage;
 static 	EGassm2CommandType _command = gctUnknown;
 
 
@@ -56,6 +66,11 @@ static void _init_default_values(int argc, char **argv)
 	program_option_init(PROGRAM_OPTION_OUTPUT_DIRECTORY, PROGRAM_OPTION_OUTPUT_DIRECTORY_DESC, String, "\0");
 	program_option_init(PROGRAM_OPTION_READ_POS_QUALITY, PROGRAM_OPTION_READ_POS_QUALITY_DESC, UInt8, 10);
 	program_option_init(PROGRAM_OPTION_NO_SHORT_VARIANTS, PROGRAM_OPTION_NO_SHORT_VARIANTS_DESC, Boolean, FALSE);
+	program_option_init(PROGRAM_OPTION_CACHE_FILE, PROGRAM_OPTION_CACHE_FILE_DESC, String, "\0");
+	program_option_init(PROGRAM_OPTION_SCHEDULE_REPORT, PROGRAM_OPTION_SCHEDULE_REPORT_DESC, String, "\0");
+	program_option_init(PROGRAM_OPTION_SPECULATIVE_KMERS, PROGRAM_OPTION_SPECULATIVE_KMERS_DESC, UInt32, 1);
+	program_option_init(PROGRAM_OPTION_SOLID_KMERS, PROGRAM_OPTION_SOLID_KMERS_DESC, UInt32, 0);
+	program_option_init(PROGRAM_OPTION_REF_PROFILE, PROGRAM_OPTION_REF_PROFILE_DESC, Boolean, FALSE);
 
 	option_set_shortcut(PROGRAM_OPTION_KMERSIZE, 'k');
 	option_set_shortcut(PROGRAM_OPTION_SEQFILE, 'f');
@@ -64,6 +79,7 @@ static void _init_default_values(int argc, char **argv)
 	option_set_shortcut(PROGRAM_OPTION_READFILE, 'F');
 	option_set_shortcut(PROGRAM_OPTION_OUTPUT_DIRECTORY, 'o');
 	option_set_shortcut(PROGRAM_OPTION_VCFFILE, 'v');
+	option_set_shortcut(PROGRAM_OPTION_CACHE_FILE, 'c');
 
 	_command = gctHelp;
 	if (argc > 1) {
@@ -71,6 +87,10 @@ static void _init_default_values(int argc, char **argv)
 			_command = gctCall;
 		else if (strcmp(argv[1], "correct") == 0)
 			_command = gctCorrect;
+		else if (strcmp(argv[1], "index") == 0)
+			_command = gctIndex;
+		else if (strcmp(argv[1], "sort-benchmark") == 0)
+			_command = gctSortBenchmark;
 	}
 
 	return;
@@ -106,13 +126,13 @@ static ERR_VALUE _capture_program_options(PPROGRAM_OPTIONS Options)
 		}
 	}
 
-	if (_command == gctCall && ret == ERR_SUCCESS) {
+	if (_command != gctCorrect && ret == ERR_SUCCESS) {
 		ret = option_get_Int32(PROGRAM_OPTION_THREADS, &Options->OMPThreads);
 		if (ret != ERR_SUCCESS)
 			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_THREADS);
 	}
 
-	if (_command == gctCall && ret == ERR_SUCCESS) {
+	if (_command != gctCorrect && ret == ERR_SUCCESS) {
 		ret = option_get_UInt8(PROGRAM_OPTION_READ_POS_QUALITY, &Options->ReadPosQuality);
 		if (ret != ERR_SUCCESS)
 			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_READ_POS_QUALITY);
@@ -163,15 +183,70 @@ static ERR_VALUE _capture_program_options(PPROGRAM_OPTIONS Options)
 			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_SEQFILE);
 	}
 
+	if (_command == gctCall && ret == ERR_SUCCESS) {
+		ret = option_get_String(PROGRAM_OPTION_SCHEDULE_REPORT, &Options->ScheduleReportFile);
+		if (ret != ERR_SUCCESS)
+			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_SCHEDULE_REPORT);
+	}
+
+	if (_command == gctCall && ret == ERR_SUCCESS) {
+		ret = option_get_UInt32(PROGRAM_OPTION_SPECULATIVE_KMERS, &Options->SpeculativeKMers);
+		if (ret != ERR_SUCCESS || !in_range(1, KMER_SIZE_ATTEMPTS, Options->SpeculativeKMers)) {
+			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_SPECULATIVE_KMERS);
+			ret = ERR_INTERNAL_ERROR;
+		}
+	}
+
+	if (_command == gctCall && ret == ERR_SUCCESS) {
+		ret = option_get_UInt32(PROGRAM_OPTION_SOLID_KMERS, &Options->ParseOptions.SolidKMerThreshold);
+		if (ret != ERR_SUCCESS)
+			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_SOLID_KMERS);
+	}
+
+	if (_command == gctCall && ret == ERR_SUCCESS) {
+		ret = option_get_Boolean(PROGRAM_OPTION_REF_PROFILE, &Options->RefProfile);
+		if (ret != ERR_SUCCESS)
+			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_REF_PROFILE);
+	}
+
+	if (_command == gctIndex && ret == ERR_SUCCESS) {
+		ret = option_get_String(PROGRAM_OPTION_CACHE_FILE, &Options->CacheFile);
+		if (ret != ERR_SUCCESS || *Options->CacheFile == '\0') {
+			fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_CACHE_FILE);
+			ret = ERR_INTERNAL_ERROR;
+		}
+	}
+
 	if (ret == ERR_SUCCESS) {
 		char *readFile = NULL;
 
 		ret = option_get_String(PROGRAM_OPTION_READFILE, &readFile);
-		if (ret == ERR_SUCCESS && *readFile != '\0') {			
-			fprintf(stderr, "Loading reads from %s...\n", readFile);
-			ret = input_get_reads(readFile, "sam", &Options->Reads, &Options->ReadCount);
-			if (ret != ERR_SUCCESS)
-				fprintf(stderr, "Error during read loading: %u\n", ret);
+		if (ret == ERR_SUCCESS && *readFile != '\0') {
+			READ_LOAD_OPTIONS loadOptions;
+			const char *readType = input_guess_reads_type(readFile);
+			double loadTime = 0;
+
+			memset(&loadOptions, 0, sizeof(loadOptions));
+			loadOptions.ThreadCount = (_command != gctCorrect) ? Options->OMPThreads : omp_get_num_procs();
+			loadOptions.Filter = (_command != gctCorrect);
+			loadOptions.MinQuality = Options->ReadPosQuality;
+			loadOptions.UseCIGAR = TRUE;
+			fprintf(stderr, "Loading reads from %s (%s)...\n", readFile, readType);
+			loadTime = omp_get_wtime();
+			if (strcmp(readType, "cache") == 0) {
+				if (_command == gctCall) {
+					ret = read_store_map(readFile, &Options->ReadStore, &Options->Reads, &Options->ReadCount, &Options->CacheInfo);
+					if (ret == ERR_SUCCESS) {
+						Options->ReadsCached = TRUE;
+						Options->ReadStats = Options->CacheInfo.Stats;
+					}
+				} else ret = ERR_UNKNOWN_READS_INPUT_TYPE;
+			} else ret = input_load_reads(readFile, readType, &loadOptions, &Options->ReadStats, &Options->Reads, &Options->ReadCount);
+
+			loadTime = omp_get_wtime() - loadTime;
+			if (ret == ERR_SUCCESS)
+				fprintf(stderr, "Loaded %zu reads in %.2f s (%.0f reads/s)\n", Options->ReadCount, loadTime, (loadTime > 0) ? Options->ReadCount / loadTime : 0.0);
+			else fprintf(stderr, "Error during read loading: %u\n", ret);
 		} else fprintf(stderr, "Invalid value for the \"%s\" parameter\n", PROGRAM_OPTION_READFILE);
 	}
 
@@ -199,7 +274,13 @@ static ERR_VALUE _capture_program_options(PPROGRAM_OPTIONS Options)
 				ret = ERR_INTERNAL_ERROR;
 			}
 
-			if (*Options->RefSeqFile == '\0') {
+			if (Options->ReadsCached &&
+				(Options->CacheInfo.MinQuality != Options->ReadPosQuality || Options->CacheInfo.ReadStrip != Options->ReadStrip)) {
+				fprintf(stderr, "The read cache was created with MAPQ %u and read end strip %u, index the reads again\n", Options->CacheInfo.MinQuality, Options->CacheInfo.ReadStrip);
+				ret = ERR_INTERNAL_ERROR;
+			}
+
+			if (_command == gctCall && *Options->RefSeqFile == '\0') {
 				fprintf(stderr, "No reference sequence file specified\n");
 				ret = ERR_INTERNAL_ERROR;
 			}
@@ -288,130 +369,618 @@ static void _on_delete_edge(const KMER_GRAPH *Graph, const KMER_EDGE *Edge, void
 }
 
 
-static ERR_VALUE _compute_graph(uint32_t KMerSize, const KMER_GRAPH_ALLOCATOR *Allocator, const PROGRAM_OPTIONS *Options, const PARSE_OPTIONS *ParseOptions, const ASSEMBLY_TASK *Task, PGEN_ARRAY_VARIANT_CALL VCArray)
+static PUTILS_LOOKASIDE _get_vertex_lookaside(PGRAPH_LOOKASIDES Lookasides, const uint32_t KmerSize)
 {
-	PKMER_GRAPH g = NULL;
+	PUTILS_LOOKASIDE ret = NULL;
+	const size_t blockSize = UTILS_LOOKASIDE_BLOCK_SIZE(KMER_BYTES_EXTRA(KmerSize, sizeof(KMER_VERTEX)));
+
+	ret = Lookasides->VertexPools[KmerSize];
+	if (ret == NULL) {
+		for (size_t i = 0; i < Lookasides->VertexPoolCount; ++i) {
+			if (Lookasides->VertexPoolStorage[i].BlockSize == blockSize) {
+				ret = Lookasides->VertexPoolStorage + i;
+				break;
+			}
+		}
+
+		if (ret == NULL) {
+			ret = Lookasides->VertexPoolStorage + Lookasides->VertexPoolCount;
+			if (utils_lookaside_init(ret, blockSize, 3000) == ERR_SUCCESS)
+				++Lookasides->VertexPoolCount;
+			else ret = NULL;
+		}
+
+		Lookasides->VertexPools[KmerSize] = ret;
+	}
+
+	return ret;
+}
+
+
+static PKMER_VERTEX _lookaside_vertex_alloc(struct _KMER_GRAPH *Graph, void *Context)
+{
+	PKMER_VERTEX ret = NULL;
+	PUTILS_LOOKASIDE ll = _get_vertex_lookaside((PGRAPH_LOOKASIDES)Context, kmer_graph_get_kmer_size(Graph));
+
+	if (ll != NULL)
+		utils_lookaside_alloc(ll, &ret);
+
+	return ret;
+}
+
+static void _lookaside_vertex_free(struct _KMER_GRAPH *Graph, PKMER_VERTEX Vertex, void *Context)
+{
+	PGRAPH_LOOKASIDES l = (PGRAPH_LOOKASIDES)Context;
+
+	utils_lookaside_free(l->VertexPools[kmer_graph_get_kmer_size(Graph)], Vertex);
+
+	return;
+}
+
+
+static PKMER_EDGE _lookaside_edge_alloc(struct _KMER_GRAPH *Graph, void *Context)
+{
+	PKMER_EDGE ret = NULL;
+	PGRAPH_LOOKASIDES l = (PGRAPH_LOOKASIDES)Context;
+
+	utils_lookaside_alloc(&l->EdgePool, &ret);
+
+	return ret;
+}
+
+static void _lookaside_edge_free(struct _KMER_GRAPH *Graph, PKMER_EDGE Edge, void *Context)
+{
+	PGRAPH_LOOKASIDES l = (PGRAPH_LOOKASIDES)Context;
+
+	utils_lookaside_free(&l->EdgePool, Edge);
+
+	return;
+}
+
+
+static void _set_graph_allocator(PKMER_GRAPH_ALLOCATOR Allocator, PGRAPH_LOOKASIDES Lookasides, PUTILS_ARENA Arena)
+{
+	Allocator->VertexAllocatorContext = Lookasides;
+	Allocator->VertexAllocator = _lookaside_vertex_alloc;
+	Allocator->VertexFreer = _lookaside_vertex_free;
+	Allocator->EdgeAllocatorContext = Lookasides;
+	Allocator->EdgeAllocator = _lookaside_edge_alloc;
+	Allocator->EdgeFreer = _lookaside_edge_free;
+	Allocator->Arena = Arena;
+	Allocator->Arena->PeakBytesUsed = 0;
+
+	return;
+}
+
+
+static void _init_graph_allocator(PKMER_GRAPH_ALLOCATOR Allocator, size_t ThreadIndex)
+{
+	_set_graph_allocator(Allocator, _graphLAs + ThreadIndex, _graphArenas + ThreadIndex);
+
+	return;
+}
+
+
+/** @brief
+ *  Releases all memory of a destroyed graph at once.
+ *
+ *  @param Allocator Allocator the graph was using.
+ *  @param KmerSize K-mer size of the graph.
+ */
+static void _reset_graph_allocator(const KMER_GRAPH_ALLOCATOR *Allocator, const uint32_t KmerSize)
+{
+	PGRAPH_LOOKASIDES l = (PGRAPH_LOOKASIDES)Allocator->VertexAllocatorContext;
+
+	if (Allocator->Arena != NULL)
+		utils_arena_reset(Allocator->Arena);
+
+	if (l != NULL) {
+		if (l->VertexPools[KmerSize] != NULL)
+			utils_lookaside_reset(l->VertexPools[KmerSize]);
+
+		utils_lookaside_reset(&l->EdgePool);
+	}
+
+	return;
+}
+
+
+static void _finit_graph_lookasides(PGRAPH_LOOKASIDES Lookasides)
+{
+	for (size_t i = 0; i < Lookasides->VertexPoolCount; ++i)
+		utils_lookaside_finit(Lookasides->VertexPoolStorage + i);
+
+	utils_lookaside_finit(&Lookasides->EdgePool);
+
+	return;
+}
+
+
+/** Tells whether a concurrent attempt with a smaller k-mer size has already decided the region. */
+static boolean _attempt_cancelled(const volatile boolean *Cancelled)
+{
+	return (Cancelled != NULL && *Cancelled);
+}
+
+
+/** Builds the graph of a region at the k-mer size of the (empty) graph of the assembly state.
+ *  If Cancelled becomes TRUE, the build stops between its stages with ERR_CANCELLED.
+ */
+static ERR_VALUE _compute_graph(PASSEMBLY_STATE State, const PROGRAM_OPTIONS *Options, const PARSE_OPTIONS *ParseOptions, const ASSEMBLY_TASK *Task, PGEN_ARRAY_VARIANT_CALL VCArray, const volatile boolean *Cancelled)
+{
+	PKMER_GRAPH g = State->Graph;
+	size_t deletedThings = 0;
+	GEN_ARRAY_KMER_EDGE_PAIR ep;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	ASSEMBLY_STATE state;
 
-	ret = kmer_graph_create(KMerSize, 2500, 6000, &g);
+	dym_array_init_KMER_EDGE_PAIR(&ep, 140);
+	ret = assembly_parse_reference(State);
+	_print_graph(g, Options, Task, GRAPH_PRINT_REFERENCE);
+	if (ret == ERR_REF_REPEATS)
+		ret = ERR_SUCCESS;
+	
+	if (ret == ERR_SUCCESS && _attempt_cancelled(Cancelled))
+		ret = ERR_CANCELLED;
+
+	if (ret == ERR_SUCCESS)
+		ret = assembly_parse_reads(State);
+
+	_print_graph(g, Options, Task, GRAPH_PRINT_RAW_READS);
+	if (ret == ERR_SUCCESS)
+		ret = assembly_add_helper_vertices(State);
+		
+	_print_graph(g, Options, Task, GRAPH_PRINT_HELPER);
+	if (ret == ERR_SUCCESS)
+		ret = assembly_create_long_edges(State, &ep);
+
+	_print_graph(g, Options, Task, GRAPH_PRINT_LONG_EDGES);
+	if (ret == ERR_SUCCESS && _attempt_cancelled(Cancelled))
+		ret = ERR_CANCELLED;
+
 	if (ret == ERR_SUCCESS) {
-		ret = assembly_state_init(g, ParseOptions, Task->Reads, Task->ReadCount, &state);
+		g->DeleteEdgeCallback = _on_delete_edge;
+		g->DeleteEdgeCallbackContext = &ep;
+		kmer_graph_delete_edges_under_threshold(g, 0);
+		kmer_graph_delete_trailing_things(g, &deletedThings);
+		g->DeleteEdgeCallback = NULL;
+	}
+
+	_print_graph(g, Options, Task, GRAPH_PRINT_THRESHOLD_1);
+	if (ret == ERR_SUCCESS && _attempt_cancelled(Cancelled))
+		ret = ERR_CANCELLED;
+
+	if (ret == ERR_SUCCESS && g->TypedEdgeCount[kmetRead] > 0) {
+		size_t changeCount = 0;
+
+		ret = kmer_graph_connect_reads_by_pairs(g, ParseOptions->ReadThreshold, &ep, &changeCount);
+		_print_graph(g, Options, Task, GRAPH_PRINT_CONNECT);
 		if (ret == ERR_SUCCESS) {
-			size_t deletedThings = 0;
-			GEN_ARRAY_KMER_EDGE_PAIR ep;
-
-			dym_array_init_KMER_EDGE_PAIR(&ep, 140);
-			ret = assembly_parse_reference(&state);
-			_print_graph(g, Options, Task, GRAPH_PRINT_REFERENCE);
-			if (ret == ERR_REF_REPEATS)
-				ret = ERR_SUCCESS;
-			
-			if (ret == ERR_SUCCESS)
-				ret = assembly_parse_reads(&state);
+			kmer_graph_compute_weights(g);
+			kmer_graph_delete_edges_under_threshold(g, ParseOptions->ReadThreshold);
+			kmer_graph_delete_trailing_things(g, &deletedThings);
+		}
+		
+		_print_graph(g, Options, Task, GRAPH_PRINT_THRESHOLD_2);
+		if (ret == ERR_SUCCESS && ParseOptions->LinearShrink)
+			kmer_graph_delete_1to1_vertices(g);
 
-			_print_graph(g, Options, Task, GRAPH_PRINT_RAW_READS);
-			if (ret == ERR_SUCCESS)
-				ret = assembly_add_helper_vertices(&state);
-				
-			_print_graph(g, Options, Task, GRAPH_PRINT_HELPER);
-			if (ret == ERR_SUCCESS)
-				ret = assembly_create_long_edges(&state, &ep);
+		_print_graph(g, Options, Task, GRAPH_PRINT_SHRINK);
+		if (ret == ERR_SUCCESS && _attempt_cancelled(Cancelled))
+			ret = ERR_CANCELLED;
 
-			_print_graph(g, Options, Task, GRAPH_PRINT_LONG_EDGES);
-			if (ret == ERR_SUCCESS) {
-				g->DeleteEdgeCallback = _on_delete_edge;
-				g->DeleteEdgeCallbackContext = &ep;
-				kmer_graph_delete_edges_under_threshold(g, 0);
-				kmer_graph_delete_trailing_things(g, &deletedThings);
-				g->DeleteEdgeCallback = NULL;
-			}
+		if (ret == ERR_SUCCESS) {
+			boolean changed = FALSE;
 
-			_print_graph(g, Options, Task, GRAPH_PRINT_THRESHOLD_1);
-			if (ret == ERR_SUCCESS && g->TypedEdgeCount[kmetRead] > 0) {
-				size_t changeCount = 0;
+			do {
+				changed = FALSE;
+				ret = kmer_graph_detect_variant(g, VCArray, Options->RefSeq.Name, ParseOptions, &changed);
+			} while (ret == ERR_SUCCESS && changed);
+		}
 
-				ret = kmer_graph_connect_reads_by_pairs(g, ParseOptions->ReadThreshold, &ep, &changeCount);
-				_print_graph(g, Options, Task, GRAPH_PRINT_CONNECT);
-				if (ret == ERR_SUCCESS) {
-					kmer_graph_compute_weights(g);
-					kmer_graph_delete_edges_under_threshold(g, ParseOptions->ReadThreshold);
-					kmer_graph_delete_trailing_things(g, &deletedThings);
-				}
-				
-				_print_graph(g, Options, Task, GRAPH_PRINT_THRESHOLD_2);
-				if (ret == ERR_SUCCESS && ParseOptions->LinearShrink)
-					kmer_graph_delete_1to1_vertices(g);
+		if (ret == ERR_SUCCESS)
+			ret = assembly_variants_to_edges(State, VCArray);
 
-				_print_graph(g, Options, Task, GRAPH_PRINT_SHRINK);
-				if (ret == ERR_SUCCESS) {
-					boolean changed = FALSE;
+		_print_graph(g, Options, Task, GRAPH_PRINT_VARIANTS);
+		if (g->TypedEdgeCount[kmetRead] > 0)
+			ret = ERR_TOO_COMPLEX;
+	}
 
-					do {
-						changed = FALSE;
-						ret = kmer_graph_detect_variant(g, VCArray, Options->RefSeq.Name, ParseOptions, &changed);
-					} while (ret == ERR_SUCCESS && changed);
-				}
+	PKMER_EDGE_PAIR p = ep.Data;
 
-				if (ret == ERR_SUCCESS)
-					ret = assembly_variants_to_edges(&state, VCArray);
+	for (size_t i = 0; i < gen_array_size(&ep); ++i) {
+		if (p->Edges != NULL)
+			utils_free(p->Edges);
+
+		++p;
+	}
+
+	dym_array_finit_KMER_EDGE_PAIR(&ep);
+
+	return ret;
+}
 
-				_print_graph(g, Options, Task, GRAPH_PRINT_VARIANTS);
-				if (g->TypedEdgeCount[kmetRead] > 0)
-					ret = ERR_TOO_COMPLEX;
-			}
-		
-			PKMER_EDGE_PAIR p = ep.Data;
 
-			for (size_t i = 0; i < gen_array_size(&ep); ++i) {
-				if (p->Edges != NULL)
-					utils_free(p->Edges);
+/** @brief
+ *  Assembles a region, increasing the k-mer size while the reference contains
+ *  repeats or the graph is too complex.
+ *
+ *  @remark
+ *  One graph and one assembly state serve all the attempts. Between them, the graph
+ *  is reset to the new k-mer size, so its tables keep their capacity, and the graph
+ *  memory (including paths of the reads) is recycled by resetting the allocator.
+ *  The first attempt uses KMerSize, taken from the reference profile if it is enabled.
+ */
+static ERR_VALUE _compute_graphs(const KMER_GRAPH_ALLOCATOR *Allocator, const PROGRAM_OPTIONS *Options, const uint32_t KMerSize, const PARSE_OPTIONS *ParseOptions, const ASSEMBLY_TASK *Task, PGEN_ARRAY_VARIANT_CALL VCArray, PVC_INDEX VCIndex)
+{
+	PKMER_GRAPH g = NULL;
+	ASSEMBLY_STATE state;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+	uint32_t kmerSize = KMerSize;
+	GEN_ARRAY_VARIANT_CALL lowerArray;
+	GEN_ARRAY_VARIANT_CALL higherArray;
+	const uint32_t step = KMER_SIZE_STEP;
+
+	dym_array_init_VARIANT_CALL(&lowerArray, 140);
+	dym_array_init_VARIANT_CALL(&higherArray, 140);
+	ret = kmer_graph_create(kmerSize, 2500, 6000, &g);
+	if (ret == ERR_SUCCESS) {
+		g->Allocator = *Allocator;
+		ret = assembly_state_init(g, ParseOptions, Task->Reads, Task->ReadCount, &state);
+		if (ret == ERR_SUCCESS) {
+			for (uint32_t i = 0; i < KMER_SIZE_ATTEMPTS; ++i) {
+				if (kmerSize > KMER_MAXIMUM_SIZE)
+					break;
+
+				if (kmer_graph_get_kmer_size(g) != kmerSize) {
+					const uint32_t oldKMerSize = kmer_graph_get_kmer_size(g);
+
+					assembly_state_reset(&state);
+					ret = kmer_graph_reset(g, kmerSize);
+					_reset_graph_allocator(Allocator, oldKMerSize);
+					if (ret != ERR_SUCCESS)
+						break;
+				}
+
+				ret = _compute_graph(&state, Options, ParseOptions, Task, &lowerArray, NULL);
+				if (ret == ERR_SUCCESS ||
+					(ret == ERR_TOO_COMPLEX && kmerSize + step > KMER_MAXIMUM_SIZE)) {
+					vc_array_intersection(&lowerArray, &lowerArray, VCArray, VCIndex);
+					break;
+				}
 
-				++p;
+				vc_array_clear(&lowerArray);
+				vc_array_clear(&higherArray);
+				if (ret != ERR_REF_REPEATS && ret != ERR_TOO_COMPLEX)
+					break;
+
+				kmerSize += step;
 			}
 
-			dym_array_finit_KMER_EDGE_PAIR(&ep);
 			assembly_state_finit(&state);
 		}
 
+		kmerSize = kmer_graph_get_kmer_size(g);
 		kmer_graph_destroy(g);
+		_reset_graph_allocator(Allocator, kmerSize);
 	} else printf("kmer_graph_create(): %u\n", ret);
 
+	dym_array_finit_VARIANT_CALL(&higherArray);
+	dym_array_finit_VARIANT_CALL(&lowerArray);
+
 	return ret;
 }
 
 
-static ERR_VALUE _compute_graphs(const KMER_GRAPH_ALLOCATOR *Allocator, const PROGRAM_OPTIONS *Options, const PARSE_OPTIONS *ParseOptions, const ASSEMBLY_TASK *Task, PGEN_ARRAY_VARIANT_CALL VCArray)
+/** Graph memory of a thread assembling a region at one of several k-mer sizes. */
+typedef struct _SPECULATION_SLOT {
+	/** Created by the first attempt using the slot, reset by the following ones. */
+	PKMER_GRAPH Graph;
+	GRAPH_LOOKASIDES Lookasides;
+	UTILS_ARENA Arena;
+} SPECULATION_SLOT, *PSPECULATION_SLOT;
+
+UTILS_TYPED_CALLOC_FUNCTION(SPECULATION_SLOT)
+UTILS_TYPED_CALLOC_FUNCTION(PSPECULATION_SLOT)
+
+/** One of the k-mer sizes of a region assembled concurrently. */
+typedef struct _KMER_ATTEMPT {
+	uint32_t KMerSize;
+	ERR_VALUE Result;
+	/** Set when an attempt with a smaller k-mer size decides the region. */
+	volatile boolean Cancelled;
+	GEN_ARRAY_VARIANT_CALL VCArray;
+	/** Attempts run outside their worker, so each has its own graph memory. */
+	PSPECULATION_SLOT Slot;
+} KMER_ATTEMPT, *PKMER_ATTEMPT;
+
+UTILS_TYPED_CALLOC_FUNCTION(KMER_ATTEMPT)
+
+typedef struct _KMER_ATTEMPTS {
+	const PROGRAM_OPTIONS *Options;
+	const PARSE_OPTIONS *ParseOptions;
+	const ASSEMBLY_TASK *Task;
+	PKMER_ATTEMPT Attempts;
+	size_t Count;
+	/** Number of attempts running in the current batch. */
+	size_t BatchSize;
+} KMER_ATTEMPTS, *PKMER_ATTEMPTS;
+
+
+/** Threads processing active regions or lent to concurrent assembly attempts. */
+static long _busyThreads = 0;
+/** Number of threads given to the variant calling. */
+static long _threadLimit = 0;
+/** One slot for each thread. */
+static PSPECULATION_SLOT _speculationSlots = NULL;
+/** Slots not used by any attempt. */
+static PSPECULATION_SLOT *_freeSpeculationSlots = NULL;
+static long _freeSpeculationSlotCount = 0;
+/** Guards the thread budget and the free slots. */
+static omp_lock_t _speculationLock;
+
+
+/** @brief
+ *  Prepares the thread budget and graph memory for concurrent assembly attempts.
+ *
+ *  @param ThreadCount Number of workers processing the active regions. All of them
+ *  are counted as busy until they run out of regions.
+ */
+static ERR_VALUE _speculation_init(const long ThreadCount)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	uint32_t kmerSize = Options->KMerSize;
-	GEN_ARRAY_VARIANT_CALL lowerArray;
-	GEN_ARRAY_VARIANT_CALL higherArray;
-	const uint32_t step = 10;
 
-	dym_array_init_VARIANT_CALL(&lowerArray, 140);
-	dym_array_init_VARIANT_CALL(&higherArray, 140);
-	for (uint32_t i = 0; i < 8; ++i) {
-		if (kmerSize > KMER_MAXIMUM_SIZE)
+	ret = utils_calloc_SPECULATION_SLOT(ThreadCount, &_speculationSlots);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_PSPECULATION_SLOT(ThreadCount, &_freeSpeculationSlots);
+		if (ret == ERR_SUCCESS) {
+			for (long i = 0; i < ThreadCount && ret == ERR_SUCCESS; ++i) {
+				PSPECULATION_SLOT s = _speculationSlots + i;
+
+				memset(s, 0, sizeof(SPECULATION_SLOT));
+				ret = utils_lookaside_init(&s->Lookasides.EdgePool, sizeof(KMER_EDGE), 5000);
+				if (ret == ERR_SUCCESS)
+					ret = utils_arena_init(&s->Arena, UTILS_ARENA_DEFAULT_CHUNK_SIZE);
+
+				_freeSpeculationSlots[i] = s;
+			}
+
+			if (ret == ERR_SUCCESS) {
+				_freeSpeculationSlotCount = ThreadCount;
+				_threadLimit = ThreadCount;
+				_busyThreads = ThreadCount;
+				omp_init_lock(&_speculationLock);
+			} else {
+				for (long i = 0; i < ThreadCount; ++i) {
+					utils_arena_finit(&_speculationSlots[i].Arena);
+					_finit_graph_lookasides(&_speculationSlots[i].Lookasides);
+				}
+
+				utils_free(_freeSpeculationSlots);
+			}
+		}
+
+		if (ret != ERR_SUCCESS)
+			utils_free(_speculationSlots);
+	}
+
+	return ret;
+}
+
+
+static void _speculation_finit(void)
+{
+	omp_destroy_lock(&_speculationLock);
+	for (long i = 0; i < _threadLimit; ++i) {
+		PSPECULATION_SLOT s = _speculationSlots + i;
+
+		if (s->Graph != NULL)
+			kmer_graph_destroy(s->Graph);
+
+		utils_arena_finit(&s->Arena);
+		_finit_graph_lookasides(&s->Lookasides);
+	}
+
+	utils_free(_freeSpeculationSlots);
+	utils_free(_speculationSlots);
+
+	return;
+}
+
+
+/** Returns the thread of a worker that has no more regions to the budget. */
+static void _speculation_worker_done(void)
+{
+	omp_set_lock(&_speculationLock);
+	--_busyThreads;
+	omp_unset_lock(&_speculationLock);
+
+	return;
+}
+
+
+/** @brief
+ *  Borrows threads of idle workers, together with their graph memory.
+ *
+ *  @param Wanted Number of threads wanted.
+ *  @param Slots Receives a slot for each borrowed thread, starting at the second
+ *  item. The first item is the slot of the calling thread, filled if it is NULL.
+ *  There is a slot for each thread of the budget, so the calling one always gets it.
+ *
+ *  @return
+ *  Number of threads borrowed.
+ */
+static long _speculation_acquire(const long Wanted, PSPECULATION_SLOT *Slots)
+{
+	long ret = 0;
+
+	omp_set_lock(&_speculationLock);
+	if (*Slots == NULL)
+		*Slots = _freeSpeculationSlots[--_freeSpeculationSlotCount];
+
+	ret = max(min(Wanted, _threadLimit - _busyThreads), 0);
+	_busyThreads += ret;
+	for (long i = 1; i <= ret; ++i)
+		Slots[i] = _freeSpeculationSlots[--_freeSpeculationSlotCount];
+
+	omp_unset_lock(&_speculationLock);
+
+	return ret;
+}
+
+
+/** @brief
+ *  Returns borrowed threads to the budget, and their slots to the free ones.
+ *
+ *  @param Slots Slots to return.
+ *  @param SlotCount Number of slots to return.
+ *  @param ThreadCount Number of threads to return.
+ */
+static void _speculation_release(PSPECULATION_SLOT *Slots, const long SlotCount, const long ThreadCount)
+{
+	omp_set_lock(&_speculationLock);
+	_busyThreads -= ThreadCount;
+	for (long i = 0; i < SlotCount; ++i)
+		_freeSpeculationSlots[_freeSpeculationSlotCount++] = Slots[i];
+
+	omp_unset_lock(&_speculationLock);
+
+	return;
+}
+
+
+/** Tells whether the attempt decides the region, in the same way as the loop of _compute_graphs() does. */
+static boolean _kmer_attempt_decisive(const KMER_ATTEMPT *Attempt)
+{
+	boolean ret = FALSE;
+
+	switch (Attempt->Result) {
+		case ERR_TOO_COMPLEX:
+			ret = (Attempt->KMerSize + KMER_SIZE_STEP > KMER_MAXIMUM_SIZE);
 			break;
-		
-		ret = _compute_graph(kmerSize, Allocator, Options, ParseOptions, Task, &lowerArray);
-		if (ret == ERR_SUCCESS ||
-			(ret == ERR_TOO_COMPLEX && kmerSize + step > KMER_MAXIMUM_SIZE)) {
-			vc_array_intersection(&lowerArray, &lowerArray, VCArray);			
+		case ERR_REF_REPEATS:
+		case ERR_CANCELLED:
+			ret = FALSE;
+			break;
+		default:
+			ret = TRUE;
 			break;
+	}
+
+	return ret;
+}
+
+
+static void _kmer_attempt_worker(PKMER_ATTEMPTS Attempts, long Index, size_t ThreadNo)
+{
+	PKMER_ATTEMPT a = Attempts->Attempts + Index;
+	PSPECULATION_SLOT s = a->Slot;
+	KMER_GRAPH_ALLOCATOR ga;
+	ASSEMBLY_STATE state;
+
+	_set_graph_allocator(&ga, &s->Lookasides, &s->Arena);
+	if (s->Graph == NULL) {
+		a->Result = kmer_graph_create(a->KMerSize, 2500, 6000, &s->Graph);
+		if (a->Result == ERR_SUCCESS)
+			s->Graph->Allocator = ga;
+	} else a->Result = kmer_graph_reset(s->Graph, a->KMerSize);
+
+	if (a->Result == ERR_SUCCESS) {
+		a->Result = assembly_state_init(s->Graph, Attempts->ParseOptions, Attempts->Task->Reads, Attempts->Task->ReadCount, &state);
+		if (a->Result == ERR_SUCCESS) {
+			a->Result = _compute_graph(&state, Attempts->Options, Attempts->ParseOptions, Attempts->Task, &a->VCArray, &a->Cancelled);
+			assembly_state_finit(&state);
 		}
+	}
 
-		vc_array_clear(&lowerArray);
-		vc_array_clear(&higherArray);
-		if (ret != ERR_REF_REPEATS && ret != ERR_TOO_COMPLEX)
-			break;
+	// Keep the graph tables for the next attempt, release the rest of the memory
+	if (s->Graph != NULL && kmer_graph_reset(s->Graph, a->KMerSize) != ERR_SUCCESS) {
+		kmer_graph_destroy(s->Graph);
+		s->Graph = NULL;
+	}
 
-		kmerSize += step;
+	_reset_graph_allocator(&ga, a->KMerSize);
+	if (_kmer_attempt_decisive(a)) {
+		for (size_t i = Index + 1; i < Attempts->BatchSize; ++i)
+			Attempts->Attempts[i].Cancelled = TRUE;
 	}
 
-	dym_array_finit_VARIANT_CALL(&higherArray);
-	dym_array_finit_VARIANT_CALL(&lowerArray);
+	return;
+}
+
+
+/** @brief
+ *  Assembles a hard region at several k-mer sizes concurrently.
+ *
+ *  @remark
+ *  Batches of consecutive k-mer sizes of the ladder run on their own threads. The
+ *  smallest k-mer size that decides the region wins and cancels the attempts with
+ *  larger sizes, so the calls are the same as of _compute_graphs(). The threads
+ *  are borrowed from workers that have run out of regions, so no more than OMPThreads
+ *  threads run at once. Each batch borrows again, so a long region gets the threads
+ *  freed while it runs. Without them, a batch holds just one k-mer size.
+ */
+static ERR_VALUE _compute_graphs_speculative(const PROGRAM_OPTIONS *Options, const uint32_t KMerSize, const uint32_t KMerCount, const PARSE_OPTIONS *ParseOptions, const ASSEMBLY_TASK *Task, PGEN_ARRAY_VARIANT_CALL VCArray, PVC_INDEX VCIndex)
+{
+	KMER_ATTEMPTS attempts;
+	PSPECULATION_SLOT slots[KMER_SIZE_ATTEMPTS];
+	const long maxExtra = (long)min(KMerCount, KMER_SIZE_ATTEMPTS) - 1;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(&attempts, 0, sizeof(attempts));
+	attempts.Options = Options;
+	attempts.ParseOptions = ParseOptions;
+	attempts.Task = Task;
+	attempts.Count = (size_t)maxExtra + 1;
+	ret = utils_calloc_KMER_ATTEMPT(attempts.Count, &attempts.Attempts);
+	if (ret == ERR_SUCCESS) {
+		uint32_t kmerSize = KMerSize;
+		uint32_t attemptCount = 0;
+		boolean decided = FALSE;
+
+		slots[0] = NULL;
+		for (size_t i = 0; i < attempts.Count; ++i)
+			dym_array_init_VARIANT_CALL(&attempts.Attempts[i].VCArray, 140);
+
+		while (!decided && attemptCount < KMER_SIZE_ATTEMPTS && kmerSize <= KMER_MAXIMUM_SIZE) {
+			const long extraThreads = _speculation_acquire(maxExtra, slots);
+
+			attempts.BatchSize = 0;
+			while (attempts.BatchSize < (size_t)extraThreads + 1 && attemptCount < KMER_SIZE_ATTEMPTS && kmerSize <= KMER_MAXIMUM_SIZE) {
+				PKMER_ATTEMPT a = attempts.Attempts + attempts.BatchSize;
+
+				a->KMerSize = kmerSize;
+				a->Result = ERR_INTERNAL_ERROR;
+				a->Cancelled = FALSE;
+				a->Slot = slots[attempts.BatchSize];
+				++attempts.BatchSize;
+				++attemptCount;
+				kmerSize += KMER_SIZE_STEP;
+			}
+
+			kt_for((int)attempts.BatchSize, _kmer_attempt_worker, &attempts, (long)attempts.BatchSize);
+			_speculation_release(slots + 1, extraThreads, extraThreads);
+			for (size_t i = 0; i < attempts.BatchSize; ++i) {
+				PKMER_ATTEMPT a = attempts.Attempts + i;
+
+				if (!decided) {
+					ret = a->Result;
+					decided = _kmer_attempt_decisive(a);
+					if (decided && (ret == ERR_SUCCESS || ret == ERR_TOO_COMPLEX))
+						vc_array_intersection(&a->VCArray, &a->VCArray, VCArray, VCIndex);
+				}
+
+				vc_array_clear(&a->VCArray);
+			}
+		}
+
+		if (slots[0] != NULL)
+			_speculation_release(slots, 1, 0);
+
+		for (size_t i = 0; i < attempts.Count; ++i)
+			dym_array_finit_VARIANT_CALL(&attempts.Attempts[i].VCArray);
+
+		utils_free(attempts.Attempts);
+	}
 
 	return ret;
 }
@@ -456,16 +1025,29 @@ static ERR_VALUE _obtain_files(PPOINTER_ARRAY_char Array, const size_t MaxCount,
 }
 
 
+/** Read coverage of all threads, summed after the regions are processed. */
 static double _readBaseCount = 0;
 static size_t _totalRegionLength = 0;
-static omp_lock_t _readCoverageLock;
 
 
-ERR_VALUE process_active_region(const KMER_GRAPH_ALLOCATOR *Allocator, const PROGRAM_OPTIONS *Options, const uint64_t RegionStart, const char *RefSeq, PGEN_ARRAY_ONE_READ FilteredReads, PGEN_ARRAY_VARIANT_CALL VCArray)
+static void _reduce_read_coverage(const size_t ThreadCount)
+{
+	_readBaseCount = 0;
+	_totalRegionLength = 0;
+	for (size_t i = 0; i < ThreadCount; ++i) {
+		_readBaseCount += _readCoverage[i].ReadBaseCount;
+		_totalRegionLength += _readCoverage[i].TotalRegionLength;
+	}
+
+	return;
+}
+
+
+ERR_VALUE process_active_region(const KMER_GRAPH_ALLOCATOR *Allocator, const PROGRAM_OPTIONS *Options, const uint32_t KMerSize, const uint32_t SpeculativeKMers, const uint64_t RegionStart, const char *RefSeq, const ONE_READ *Reads, const size_t ReadCount, PGEN_ARRAY_READ_VIEW FilteredReads, PGEN_ARRAY_char ReadBases, PGEN_ARRAY_VARIANT_CALL VCArray, PVC_INDEX VCIndex, PREAD_COVERAGE_STATISTICS Coverage)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	ret = input_filter_reads(Options->KMerSize, Options->Reads, Options->ReadCount, RegionStart, Options->RegionLength, FilteredReads);
+	ret = input_region_reads(Options->KMerSize, &Options->ReadStore, Reads, ReadCount, RegionStart, Options->RegionLength, FilteredReads, ReadBases);
 	if (ret == ERR_SUCCESS) {
 		if (gen_array_size(FilteredReads) > 0) {
 			char taskName[128];
@@ -476,13 +1058,10 @@ ERR_VALUE process_active_region(const KMER_GRAPH_ALLOCATOR *Allocator, const PRO
 
 			memset(po.ReadQualityDistribution, 0, sizeof(po.ReadQualityDistribution));
 			{
-				const ONE_READ *fr = FilteredReads->Data;
+				const READ_VIEW *fr = FilteredReads->Data;
 				uint32_t baseCount = 0;
 
-				omp_set_lock(&_readCoverageLock);
-				_totalRegionLength += Options->RegionLength;
 				for (size_t i = 0; i < gen_array_size(FilteredReads); ++i) {
-					_readBaseCount += fr->ReadSequenceLen;
 					baseCount += fr->ReadSequenceLen;
 					for (size_t j = 0; j < fr->ReadSequenceLen; ++j)
 						++po.ReadQualityDistribution[fr->Quality[j]];
@@ -490,7 +1069,8 @@ ERR_VALUE process_active_region(const KMER_GRAPH_ALLOCATOR *Allocator, const PRO
 					++fr;
 				}
 
-				omp_unset_lock(&_readCoverageLock);
+				Coverage->TotalRegionLength += Options->RegionLength;
+				Coverage->ReadBaseCount += baseCount;
 				coverage = baseCount / Options->RegionLength;
 			}
 			
@@ -504,14 +1084,15 @@ ERR_VALUE process_active_region(const KMER_GRAPH_ALLOCATOR *Allocator, const PRO
 			po.RegionStart = RegionStart;
 			po.RegionLength = Options->RegionLength;
 			po.Reference = RefSeq;
-			ret = _compute_graphs(Allocator, Options, &po, &task, VCArray);
+			if (SpeculativeKMers > 1)
+				ret = _compute_graphs_speculative(Options, KMerSize, SpeculativeKMers, &po, &task, VCArray, VCIndex);
+			else ret = _compute_graphs(Allocator, Options, KMerSize, &po, &task, VCArray, VCIndex);
+
 			assembly_task_finit(&task);
 		}
-
-		input_free_filtered_reads(FilteredReads->Data, gen_array_size(FilteredReads));
 	}
 
-	dym_array_clear_ONE_READ(FilteredReads);
+	dym_array_clear_READ_VIEW(FilteredReads);
 
 	return ret;
 }
@@ -521,151 +1102,513 @@ static long _activeRegionCount = 0;
 static volatile long _activeRegionProcessed = 0;
 
 
-static ERR_VALUE _init_lookasides(const uint32_t KmerSize, PUTILS_LOOKASIDE *VA, PUTILS_LOOKASIDE *EA, size_t ThreadIndex)
+static void _update_graph_memory_stats(const KMER_GRAPH_ALLOCATOR *Allocator, size_t ThreadIndex)
+{
+	PGRAPH_MEMORY_STATISTICS s = _graphMemoryStats + ThreadIndex;
+	const size_t peak = Allocator->Arena->PeakBytesUsed;
+
+	if (peak > 0) {
+		++s->RegionCount;
+		s->TotalBytes += peak;
+		if (s->MaxBytes < peak)
+			s->MaxBytes = peak;
+	}
+
+	return;
+}
+
+
+static void _print_graph_memory_stats(FILE *Stream, const size_t ThreadCount)
 {
-	ERR_VALUE ret = ERR_SUCCESS;
+	GRAPH_MEMORY_STATISTICS total;
+	size_t reserved = 0;
+
+	memset(&total, 0, sizeof(total));
+	for (size_t i = 0; i < ThreadCount; ++i) {
+		total.RegionCount += _graphMemoryStats[i].RegionCount;
+		total.TotalBytes += _graphMemoryStats[i].TotalBytes;
+		total.MaxBytes = max(total.MaxBytes, _graphMemoryStats[i].MaxBytes);
+		reserved += _graphArenas[i].BytesReserved;
+	}
 
-	if (_vertexLAs[ThreadIndex] == NULL) {
-		ret = utils_malloc(sizeof(UTILS_LOOKASIDE), _vertexLAs + ThreadIndex);
-		if (ret == ERR_SUCCESS) {
-			ret = utils_lookaside_init(_vertexLAs[ThreadIndex], sizeof(KMER_VERTEX) + KmerSize, 3000);
-			if (ret != ERR_SUCCESS) {
-				utils_free(_vertexLAs[ThreadIndex]);
-				_vertexLAs[ThreadIndex] = NULL;
-			}
+	fprintf(Stream, "Graph memory: %zu regions, %zu bytes per region on average, %zu bytes at most, %zu bytes reserved\n",
+		total.RegionCount, (total.RegionCount > 0) ? total.TotalBytes / total.RegionCount : 0, total.MaxBytes, reserved);
+	for (size_t i = 0; i < ThreadCount; ++i) {
+		const GRAPH_LOOKASIDES *l = _graphLAs + i;
+		size_t vertexHits = 0;
+		size_t vertexMisses = 0;
+
+		for (size_t j = 0; j < l->VertexPoolCount; ++j) {
+			vertexHits += l->VertexPoolStorage[j].Hits;
+			vertexMisses += l->VertexPoolStorage[j].Misses;
 		}
+
+		if (vertexHits + vertexMisses + l->EdgePool.Hits + l->EdgePool.Misses > 0)
+			fprintf(Stream, "Thread %zu lookasides: vertices %zu hits %zu misses (%zu pools), edges %zu hits %zu misses\n",
+				i, vertexHits, vertexMisses, l->VertexPoolCount, l->EdgePool.Hits, l->EdgePool.Misses);
+	}
+
+	return;
+}
+
+
+/** Weight of the reference repeats in the predicted cost of an active region.
+ *
+ *  Repeats do not restart the assembly (_compute_graph() ignores ERR_REF_REPEATS),
+ *  but they make the graph branched and cyclic, so the path searches take longer.
+ *  The value is a heuristic; the correlation printed by _ar_schedule_report() tells
+ *  how well the predicted costs follow the actual ones for a given input.
+ */
+#define AR_COST_REPEAT_WEIGHT					8.0
+/** Maximum size of k-mers used to find the reference repeats. */
+#define AR_COST_REPEAT_KMER_SIZE				31
+/** Regions whose predicted cost exceeds the average this many times are assembled
+ *  at several k-mer sizes concurrently, see _compute_graphs_speculative(). */
+#define AR_SPECULATION_COST_FACTOR				4.0
+
+
+typedef struct _AR_WRAPPER_CONTEXT{
+	const char *Reference;
+	uint64_t RegionStart;
+	const PROGRAM_OPTIONS *Options;
+	/** Reads that may overlap the region, taken from the read index. */
+	const ONE_READ *Reads;
+	size_t ReadCount;
+	/** Number of reference k-mers of the region that occur at a lower position as well. */
+	uint32_t RepeatCount;
+	/** K-mer size of the first assembly attempt. */
+	uint32_t KMerSize;
+	/** Number of k-mer sizes to assemble concurrently, 1 for regions not predicted to be hard. */
+	uint32_t SpeculativeKMers;
+	/** Cost estimated from the reads and the reference repeats, in arbitrary units. */
+	double PredictedCost;
+	/** Time spent by processing the region, in seconds. */
+	double ActualCost;
+} AR_WRAPPER_CONTEXT, *PAR_WRAPPER_CONTEXT;
+
+UTILS_TYPED_CALLOC_FUNCTION(AR_WRAPPER_CONTEXT)
+
+
+/** Lazily generates windows of the valid active regions in order of their starts.
+ *
+ *  A few windows are generated ahead and their costs are estimated, workers always
+ *  take the most expensive one of them, so the memory does not depend on the size
+ *  of the reference and regions hard to assemble do not wait until the end of
+ *  the run.
+ */
+typedef struct _AR_GENERATOR {
+	const PROGRAM_OPTIONS *Options;
+	const ACTIVE_REGION *Regions;
+	size_t RegionCount;
+	/** Active region the next window is taken from. */
+	size_t CurrentRegion;
+	/** Offset of the next window in the current active region, -1 after its last window. */
+	uint64_t NextOffset;
+	PREAD_INDEX ReadIndex;
+	/** The smallest k-mer sizes without reference repeats, NULL if all windows start
+	 *  at the k-mer size of the options. */
+	const REF_PROFILE *Profile;
+	/** Windows generated ahead, a heap ordered by _ar_cost_comparator(). */
+	PAR_WRAPPER_CONTEXT Pending;
+	size_t PendingCount;
+	/** Windows taken from the regions whose costs are being estimated, each has a slot
+	 *  of the heap reserved. */
+	size_t InFlight;
+	size_t Lookahead;
+	/** Sum of the predicted costs of the generated windows. */
+	double GeneratedCost;
+	size_t GeneratedCount;
+	omp_lock_t Lock;
+	/** Sums of the predicted and actual costs (and of their products) of the processed windows. */
+	size_t DoneCount;
+	double SumP;
+	double SumA;
+	double SumPP;
+	double SumAA;
+	double SumPA;
+	AR_WRAPPER_CONTEXT Slowest;
+	/** Receives the costs of every window, NULL if not wanted. */
+	FILE *ReportFile;
+} AR_GENERATOR, *PAR_GENERATOR;
+
+
+static void _ar_estimate_cost(PAR_WRAPPER_CONTEXT Task)
+{
+	const PROGRAM_OPTIONS *o = Task->Options;
+
+	Task->RepeatCount = 0;
+	if (ref_count_repeats(Task->Reference, o->RegionLength, min(o->KMerSize, AR_COST_REPEAT_KMER_SIZE), &Task->RepeatCount) != ERR_SUCCESS)
+		Task->RepeatCount = 0;
+
+	Task->PredictedCost = (Task->ReadCount + 1)*(1.0 + AR_COST_REPEAT_WEIGHT*Task->RepeatCount / o->RegionLength);
+	Task->ActualCost = 0;
+
+	return;
+}
+
+
+/** Orders the regions from the most expensive ones. */
+static int _ar_cost_comparator(const void *A, const void *B)
+{
+	const AR_WRAPPER_CONTEXT *a = (const AR_WRAPPER_CONTEXT *)A;
+	const AR_WRAPPER_CONTEXT *b = (const AR_WRAPPER_CONTEXT *)B;
+	int ret = 0;
+
+	if (a->PredictedCost > b->PredictedCost)
+		ret = -1;
+	else if (a->PredictedCost < b->PredictedCost)
+		ret = 1;
+	else if (a->RegionStart < b->RegionStart)
+		ret = -1;
+	else if (a->RegionStart > b->RegionStart)
+		ret = 1;
+
+	return ret;
+}
+
+
+static void _ar_heap_up(PAR_WRAPPER_CONTEXT Heap, size_t Index)
+{
+	while (Index > 0) {
+		const size_t parent = (Index - 1) / 2;
+		AR_WRAPPER_CONTEXT tmp;
+
+		if (_ar_cost_comparator(Heap + parent, Heap + Index) <= 0)
+			break;
+
+		tmp = Heap[parent];
+		Heap[parent] = Heap[Index];
+		Heap[Index] = tmp;
+		Index = parent;
 	}
 
+	return;
+}
+
+
+static void _ar_heap_down(PAR_WRAPPER_CONTEXT Heap, const size_t Count, size_t Index)
+{
+	for (;;) {
+		size_t first = Index;
+		const size_t left = 2 * Index + 1;
+		const size_t right = left + 1;
+		AR_WRAPPER_CONTEXT tmp;
+
+		if (left < Count && _ar_cost_comparator(Heap + left, Heap + first) < 0)
+			first = left;
+
+		if (right < Count && _ar_cost_comparator(Heap + right, Heap + first) < 0)
+			first = right;
+
+		if (first == Index)
+			break;
+
+		tmp = Heap[first];
+		Heap[first] = Heap[Index];
+		Heap[Index] = tmp;
+		Index = first;
+	}
+
+	return;
+}
+
+
+static ERR_VALUE _ar_generator_init(PAR_GENERATOR Generator, const PROGRAM_OPTIONS *Options, const ACTIVE_REGION *Regions, const size_t RegionCount, PREAD_INDEX ReadIndex, const REF_PROFILE *Profile)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Generator, 0, sizeof(AR_GENERATOR));
+	Generator->Options = Options;
+	Generator->Regions = Regions;
+	Generator->RegionCount = RegionCount;
+	Generator->ReadIndex = ReadIndex;
+	Generator->Profile = Profile;
+	Generator->Lookahead = 4 * (size_t)max(Options->OMPThreads, 1);
+	ret = utils_calloc_AR_WRAPPER_CONTEXT(Generator->Lookahead, &Generator->Pending);
 	if (ret == ERR_SUCCESS) {
-		*VA = _vertexLAs[ThreadIndex];
-		if (_edgeLAs[ThreadIndex] == NULL) {
-			ret = utils_malloc(sizeof(UTILS_LOOKASIDE), _edgeLAs + ThreadIndex);
-			if (ret == ERR_SUCCESS) {
-				ret = utils_lookaside_init(_edgeLAs[ThreadIndex], sizeof(KMER_EDGE), 5000);
-				if (ret != ERR_SUCCESS) {
-					utils_free(_edgeLAs[ThreadIndex]);
-					_edgeLAs[ThreadIndex] = NULL;
-				}
-			}
+		if (Options->ScheduleReportFile != NULL && *Options->ScheduleReportFile != '\0') {
+			ret = utils_fopen(Options->ScheduleReportFile, FOPEN_MODE_WRITE, &Generator->ReportFile);
+			if (ret == ERR_SUCCESS)
+				fprintf(Generator->ReportFile, "#start\treads\trepeats\tpredicted\tseconds\n");
+			else fprintf(stderr, "Unable to write the schedule report to %s\n", Options->ScheduleReportFile);
 		}
 
 		if (ret == ERR_SUCCESS)
-			*EA = _edgeLAs[ThreadIndex];
+			omp_init_lock(&Generator->Lock);
+
+		if (ret != ERR_SUCCESS)
+			utils_free(Generator->Pending);
 	}
 
 	return ret;
 }
 
 
-static PKMER_VERTEX _lookaside_vertex_alloc(struct _KMER_GRAPH *Graph, void *Context)
+static void _ar_generator_finit(PAR_GENERATOR Generator)
 {
-	PKMER_VERTEX ret = NULL;
-	PUTILS_LOOKASIDE ll = (PUTILS_LOOKASIDE)Context;
+	omp_destroy_lock(&Generator->Lock);
+	if (Generator->ReportFile != NULL)
+		utils_fclose(Generator->ReportFile);
 
-	utils_lookaside_alloc(ll, &ret);
+	utils_free(Generator->Pending);
 
-	return ret;
+	return;
 }
 
-static void _lookaside_vertex_free(struct _KMER_GRAPH *Graph, PKMER_VERTEX Vertex, void *Context)
+
+/** Takes the next window of the valid active regions, the last window of each region
+ *  is aligned to its end. Must be called with the generator lock held, since the read
+ *  index is queried in order of the window starts.
+ */
+static boolean _ar_generator_window(PAR_GENERATOR Generator, PAR_WRAPPER_CONTEXT Task)
 {
-	PUTILS_LOOKASIDE ll = (PUTILS_LOOKASIDE)Context;
+	const PROGRAM_OPTIONS *o = Generator->Options;
+	const ACTIVE_REGION *pa = NULL;
+	uint64_t offset = 0;
+	size_t firstRead = 0;
+	size_t readCount = 0;
+
+	while (Generator->CurrentRegion < Generator->RegionCount) {
+		pa = Generator->Regions + Generator->CurrentRegion;
+		if (pa->Type == artValid && pa->Length >= o->RegionLength && Generator->NextOffset != (uint64_t)-1)
+			break;
+
+		++Generator->CurrentRegion;
+		Generator->NextOffset = 0;
+	}
 
-	utils_lookaside_free(ll, Vertex);
+	if (Generator->CurrentRegion == Generator->RegionCount)
+		return FALSE;
 
-	return;
+	offset = Generator->NextOffset;
+	if (offset < pa->Length - o->RegionLength)
+		Generator->NextOffset += o->TestStep;
+	else {
+		offset = pa->Length - o->RegionLength;
+		Generator->NextOffset = (uint64_t)-1;
+	}
+
+	memset(Task, 0, sizeof(AR_WRAPPER_CONTEXT));
+	Task->Options = o;
+	Task->Reference = pa->Sequence + offset;
+	Task->RegionStart = pa->Offset + offset;
+	input_read_index_range(Generator->ReadIndex, Task->RegionStart, o->RegionLength, &firstRead, &readCount);
+	Task->Reads = o->Reads + firstRead;
+	Task->ReadCount = readCount;
+	if (Generator->Profile != NULL)
+		Task->KMerSize = ref_profile_kmer_size(Generator->Profile, Generator->CurrentRegion, offset);
+
+	if (Task->KMerSize == 0)
+		Task->KMerSize = o->KMerSize;
+
+	return TRUE;
 }
 
 
-static PKMER_EDGE _lookaside_edge_alloc(struct _KMER_GRAPH *Graph, void *Context)
+/** Gives a worker its next window, FALSE when all windows are taken.
+ *
+ *  @remark
+ *  Costs of the windows generated ahead are estimated outside the lock, their heap
+ *  slots are reserved while the lock is held, so the heap never exceeds Lookahead
+ *  windows. A window generated by a worker always ends in the heap before the worker
+ *  looks for its next window, so no window is lost when the other workers find the
+ *  heap empty. Each worker reserves at most one slot and Lookahead exceeds the number
+ *  of workers, so a worker failing to reserve a slot always finds a window in the heap.
+ */
+static boolean _ar_generator_next(PAR_GENERATOR Generator, PAR_WRAPPER_CONTEXT Task)
 {
-	PKMER_EDGE ret = NULL;
-	PUTILS_LOOKASIDE ll = (PUTILS_LOOKASIDE)Context;
+	boolean ret = FALSE;
+	boolean generated = TRUE;
+
+	while (generated) {
+		AR_WRAPPER_CONTEXT w;
+
+		omp_set_lock(&Generator->Lock);
+		generated = (Generator->PendingCount + Generator->InFlight < Generator->Lookahead && _ar_generator_window(Generator, &w));
+		if (generated)
+			++Generator->InFlight;
+		else if (Generator->PendingCount > 0) {
+			*Task = Generator->Pending[0];
+			--Generator->PendingCount;
+			Generator->Pending[0] = Generator->Pending[Generator->PendingCount];
+			_ar_heap_down(Generator->Pending, Generator->PendingCount, 0);
+			ret = TRUE;
+		}
 
-	utils_lookaside_alloc(ll, &ret);
+		omp_unset_lock(&Generator->Lock);
+		if (generated) {
+			_ar_estimate_cost(&w);
+			omp_set_lock(&Generator->Lock);
+			--Generator->InFlight;
+			Generator->GeneratedCost += w.PredictedCost;
+			++Generator->GeneratedCount;
+			w.SpeculativeKMers = 1;
+			if (w.PredictedCost > AR_SPECULATION_COST_FACTOR*Generator->GeneratedCost / Generator->GeneratedCount)
+				w.SpeculativeKMers = Generator->Options->SpeculativeKMers;
+
+			Generator->Pending[Generator->PendingCount] = w;
+			++Generator->PendingCount;
+			_ar_heap_up(Generator->Pending, Generator->PendingCount - 1);
+			omp_unset_lock(&Generator->Lock);
+		}
+	}
 
 	return ret;
 }
 
-static void _lookaside_edge_free(struct _KMER_GRAPH *Graph, PKMER_EDGE Edge, void *Context)
+
+/** Records the actual cost of a processed window. */
+static void _ar_generator_done(PAR_GENERATOR Generator, const AR_WRAPPER_CONTEXT *Task)
 {
-	PUTILS_LOOKASIDE ll = (PUTILS_LOOKASIDE)Context;
+	const double p = Task->PredictedCost;
+	const double a = Task->ActualCost;
+
+	omp_set_lock(&Generator->Lock);
+	++Generator->DoneCount;
+	Generator->SumP += p;
+	Generator->SumA += a;
+	Generator->SumPP += p*p;
+	Generator->SumAA += a*a;
+	Generator->SumPA += p*a;
+	if (Generator->DoneCount == 1 || Generator->Slowest.ActualCost < a)
+		Generator->Slowest = *Task;
+
+	if (Generator->ReportFile != NULL)
+		fprintf(Generator->ReportFile, "%" PRIu64 "\t%zu\t%u\t%.1lf\t%.6lf\n", Task->RegionStart, Task->ReadCount, Task->RepeatCount, p, a);
 
-	utils_lookaside_free(ll, Edge);
+	omp_unset_lock(&Generator->Lock);
 
 	return;
 }
 
 
-typedef struct _AR_WRAPPER_CONTEXT{
-	const char *Reference;
-	uint64_t RegionStart;
-	const PROGRAM_OPTIONS *Options;
-} AR_WRAPPER_CONTEXT, *PAR_WRAPPER_CONTEXT;
-
-GEN_ARRAY_TYPEDEF(AR_WRAPPER_CONTEXT);
-GEN_ARRAY_IMPLEMENTATION(AR_WRAPPER_CONTEXT)
+/** Compares the predicted costs of the windows with the times they actually took. */
+static void _ar_schedule_report(FILE *Stream, const AR_GENERATOR *Generator)
+{
+	const double n = (double)Generator->DoneCount;
+	const double cov = n*Generator->SumPA - Generator->SumP*Generator->SumA;
+	const double varP = n*Generator->SumPP - Generator->SumP*Generator->SumP;
+	const double varA = n*Generator->SumAA - Generator->SumA*Generator->SumA;
+	double correlation = 0;
+
+	if (Generator->DoneCount > 0) {
+		if (varP > 0 && varA > 0)
+			correlation = cov / sqrt(varP*varA);
+
+		fprintf(Stream, "Scheduling: %zu regions, %.3lf s in total, predicted/actual cost correlation %.3lf, slowest region %" PRIu64 " took %.3lf s (predicted cost %.1lf, %.1lf on average)\n",
+			Generator->DoneCount, Generator->SumA, correlation, Generator->Slowest.RegionStart, Generator->Slowest.ActualCost, Generator->Slowest.PredictedCost, Generator->SumP / n);
+	}
 
+	return;
+}
 
-static GEN_ARRAY_AR_WRAPPER_CONTEXT _assemblyTasks;
 
-static void _ar_wrapper(PAR_WRAPPER_CONTEXT Context, long WorkIndex, size_t ThreadNo)
+/** Processes windows taken from the generator until there are none left. */
+static void _ar_worker(PAR_GENERATOR Generator, long WorkerIndex, size_t ThreadNo)
 {
-	long done = 0;
-	PUTILS_LOOKASIDE el = NULL;
-	PUTILS_LOOKASIDE vl = NULL;
-	KMER_GRAPH_ALLOCATOR ga;
-	PAR_WRAPPER_CONTEXT task = Context + WorkIndex;
-
-	_init_lookasides(task->Options->KMerSize, &vl, &el, ThreadNo);
-	ga.VertexAllocatorContext = vl;
-	ga.VertexAllocator = _lookaside_vertex_alloc;
-	ga.VertexFreer = _lookaside_vertex_free;
-	ga.EdgeAllocatorContext = el;
-	ga.EdgeAllocator = _lookaside_edge_alloc;
-	ga.EdgeFreer = _lookaside_edge_free;
-	process_active_region(&ga, task->Options, task->RegionStart, task->Reference, task->Options->ReadSubArrays + ThreadNo, task->Options->VCSubArrays + ThreadNo);
-	done = utils_atomic_increment(&_activeRegionProcessed);
-	if (done % (_activeRegionCount / 10000) == 0)
-		fprintf(stderr, "%u %%\r", done * 10000 / _activeRegionCount);
+	AR_WRAPPER_CONTEXT task;
+	const PROGRAM_OPTIONS *o = Generator->Options;
+
+	while (_ar_generator_next(Generator, &task)) {
+		long done = 0;
+		KMER_GRAPH_ALLOCATOR ga;
+		double startTime = omp_get_wtime();
+
+		_init_graph_allocator(&ga, ThreadNo);
+		process_active_region(&ga, o, task.KMerSize, task.SpeculativeKMers, task.RegionStart, task.Reference, task.Reads, task.ReadCount, o->ReadSubArrays + ThreadNo, o->ReadBaseSubArrays + ThreadNo, o->VCSubArrays + ThreadNo, o->VCSubIndices + ThreadNo, _readCoverage + ThreadNo);
+		task.ActualCost = omp_get_wtime() - startTime;
+		_update_graph_memory_stats(&ga, ThreadNo);
+		_ar_generator_done(Generator, &task);
+		done = utils_atomic_increment(&_activeRegionProcessed);
+		if (done % (_activeRegionCount / 10000) == 0)
+			fprintf(stderr, "%u %%\r", done * 10000 / _activeRegionCount);
+	}
+
+	_speculation_worker_done();
 
 	return;
 }
 
 
-static void process_active_region_in_parallel(const ACTIVE_REGION *Contig, const PROGRAM_OPTIONS *Options)
+/** Sorts shuffled copies of the reads with 1 to OMPThreads threads and reports the times. */
+static ERR_VALUE _sort_benchmark(const PROGRAM_OPTIONS *Options)
 {
-	PUTILS_LOOKASIDE el = NULL;
-	PUTILS_LOOKASIDE vl = NULL;
-	
-	_init_lookasides(Options->KMerSize, &vl, &el, 0);
+	PONE_READ shuffled = NULL;
+	PONE_READ reads = NULL;
+	double baseTime = 0;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_calloc_ONE_READ(max(Options->ReadCount, 1), &shuffled);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_ONE_READ(max(Options->ReadCount, 1), &reads);
+		if (ret == ERR_SUCCESS) {
+			memcpy(shuffled, Options->Reads, Options->ReadCount*sizeof(ONE_READ));
+			for (size_t i = Options->ReadCount; i > 1; --i) {
+				const size_t j = utils_ranged_rand(0, i);
+				ONE_READ tmp = shuffled[i - 1];
+
+				shuffled[i - 1] = shuffled[j];
+				shuffled[j] = tmp;
+			}
+
+			fprintf(stdout, "Threads\tTime [s]\tSpeedup\n");
+			for (int32_t t = 1; t <= Options->OMPThreads; ++t) {
+				double sortTime = 0;
+
+				memcpy(reads, shuffled, Options->ReadCount*sizeof(ONE_READ));
+				sortTime = omp_get_wtime();
+				ret = input_sort_reads(reads, Options->ReadCount, t);
+				sortTime = omp_get_wtime() - sortTime;
+				if (ret != ERR_SUCCESS)
+					break;
+
+				for (size_t i = 1; i < Options->ReadCount; ++i) {
+					if (reads[i - 1].Pos > reads[i].Pos) {
+						ret = ERR_INTERNAL_ERROR;
+						break;
+					}
+				}
 
-	for (uint64_t i = 0; i < Contig->Length - Options->RegionLength; i += Options->TestStep) {
-		AR_WRAPPER_CONTEXT arCtx;
+				if (ret != ERR_SUCCESS)
+					break;
+
+				if (t == 1)
+					baseTime = sortTime;
+
+				fprintf(stdout, "%i\t%.4f\t%.2f\n", t, sortTime, (sortTime > 0) ? baseTime / sortTime : 0.0);
+			}
 
-		arCtx.Options = Options;
-		arCtx.Reference = Contig->Sequence + i;
-		arCtx.RegionStart = Contig->Offset + i;
-		dym_array_push_back_no_alloc_AR_WRAPPER_CONTEXT(&_assemblyTasks, arCtx);
-//		kt_for(Options->OMPThreads, _ar_wrapper, &arCtx, MaxWorkIndex);
+			utils_free(reads);
+		}
+
+		utils_free(shuffled);
 	}
 
-	KMER_GRAPH_ALLOCATOR ga;
+	return ret;
+}
 
-	_init_lookasides(Options->KMerSize, &vl, &el, 0);
-	ga.VertexAllocatorContext = vl;
-	ga.VertexAllocator = _lookaside_vertex_alloc;
-	ga.VertexFreer = _lookaside_vertex_free;
-	ga.EdgeAllocatorContext = el;
-	ga.EdgeAllocator = _lookaside_edge_alloc;
-	ga.EdgeFreer = _lookaside_edge_free;
-	process_active_region(&ga, Options, Contig->Offset + Contig->Length - Options->RegionLength, Contig->Sequence + Contig->Length - Options->RegionLength, Options->ReadSubArrays, Options->VCSubArrays);
-		
-	long done = utils_atomic_increment(&_activeRegionProcessed);
-	if (done % (_activeRegionCount / 10000) == 0)
-		fprintf(stderr, "%u %%\r", done * 10000 / _activeRegionCount);
 
-	return;
+/** Unless the reads were mapped from a read cache, removes overlaps of the mates,
+ *  strips the read ends and moves the reads to the read store. */
+static ERR_VALUE _prepare_reads(PPROGRAM_OPTIONS Options)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = ERR_SUCCESS;
+	if (!Options->ReadsCached) {
+		paired_reads_fix_overlaps(&Options->Paired, FALSE);
+
+		for (size_t i = 0; i < Options->ReadCount; ++i)
+			read_shorten(Options->Reads + i, Options->ReadStrip);
+
+		paired_reads_fix_overlaps(&Options->Paired, TRUE);
+		ret = read_store_build(&Options->ReadStore, Options->Reads, Options->ReadCount);
+	}
+
+	if (ret == ERR_SUCCESS)
+		fprintf(stderr, "Read store:                 %zu bytes (%zu bases, %zu interned strings)\n", read_store_memory(&Options->ReadStore), Options->ReadStore.BaseCount, Options->ReadStore.InternedCount);
+
+	return ret;
 }
 
 
@@ -674,7 +1617,6 @@ int main(int argc, char *argv[])
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
 		utils_allocator_init(omp_get_num_procs());
-		omp_init_lock(&_readCoverageLock);
 		ret = options_module_init(37);
 		if (ret == ERR_SUCCESS) {
 			_init_default_values(argc, argv);
@@ -694,6 +1636,8 @@ int main(int argc, char *argv[])
 					if (_command == gctHelp) {
 						fprintf(stdout, "Usage: gassm2 call -f <reference.fa> -F <reads.sam> [OPTIONS]\n");
 						fprintf(stdout, "Usage: gassm2 correct -F <reads.sam>\n");
+						fprintf(stdout, "Usage: gassm2 index -F <reads.sam> -c <reads.cache> [OPTIONS]\n");
+						fprintf(stdout, "Usage: gassm2 sort-benchmark -F <reads.sam> --threads <max. threads>\n");
 						fprintf(stdout, "\nOptions:\n");
 						options_print_help();
 					} else if (_command == gctCorrect) {
@@ -722,6 +1666,35 @@ int main(int argc, char *argv[])
 								}
 							}
 						}
+					} else if (_command == gctSortBenchmark) {
+						fprintf(stderr, "Sorting %zu reads with 1 to %i threads...\n", po.ReadCount, po.OMPThreads);
+						ret = _sort_benchmark(&po);
+						if (ret != ERR_SUCCESS)
+							fprintf(stderr, "Error during read sorting: %u\n", ret);
+
+						input_free_reads(po.Reads, po.ReadCount);
+					} else if (_command == gctIndex) {
+						fprintf(stderr, "Filtered out reads with MAPQ less than %u, stripping %u bases from read ends...\n", po.ReadPosQuality, po.ReadStrip);
+						read_set_stats_print(stderr, &po.ReadStats);
+						ret = paired_reads_init(&po.Paired, po.Reads, po.ReadCount);
+						if (ret == ERR_SUCCESS) {
+							ret = _prepare_reads(&po);
+							if (ret == ERR_SUCCESS) {
+								po.CacheInfo.MinQuality = po.ReadPosQuality;
+								po.CacheInfo.ReadStrip = po.ReadStrip;
+								po.CacheInfo.Stats = po.ReadStats;
+								fprintf(stderr, "Writing read cache to %s...\n", po.CacheFile);
+								ret = read_store_save(&po.ReadStore, po.Reads, po.ReadCount, &po.CacheInfo, po.CacheFile);
+								if (ret != ERR_SUCCESS)
+									fprintf(stderr, "Error during read cache writing: %u\n", ret);
+							}
+
+							paired_reads_finit(&po.Paired);
+							if (po.ReadStore.Extensions != NULL) {
+								read_store_finit(&po.ReadStore);
+								utils_free(po.Reads);
+							}
+						}
 					} else if (_command == gctCall) {
 						fprintf(stderr, "K-mer size:                 %u\n", po.KMerSize);
 						fprintf(stderr, "Active region length:       %u\n", po.RegionLength);
@@ -733,6 +1706,7 @@ int main(int argc, char *argv[])
 						fprintf(stderr, "Output VCF file:            %s\n", po.VCFFile);
 						fprintf(stderr, "Read end strip:             %u\n", po.ReadStrip);
 						fprintf(stderr, "Step size:                  %u\n", po.TestStep);
+						fprintf(stderr, "Speculative k-mer sizes:    %u\n", po.SpeculativeKMers);
 						fprintf(stderr, "backward penalty:           %u\n", po.ParseOptions.BackwardRefseqPenalty);
 						fprintf(stderr, "Missing edge penaly:        %u\n", po.ParseOptions.MissingEdgePenalty);
 						fprintf(stderr, "Short variant optimization: %u\n", po.ParseOptions.OptimizeShortVariants);
@@ -743,152 +1717,211 @@ int main(int argc, char *argv[])
 						fprintf(stderr, "Read threshold:             %u\n", po.Threshold);
 						fprintf(stderr, "Binomic threshold:          %" PRIu64 "\n", po.ParseOptions.BinomThreshold);
 						fprintf(stderr, "Low q. variant threshold:   %u\n", po.ParseOptions.LQVariant);
+						fprintf(stderr, "Solid k-mer threshold:      %u\n", po.ParseOptions.SolidKMerThreshold);
+						fprintf(stderr, "Reference profile:          %u\n", po.RefProfile);
 
-						fprintf(stderr, "Filtering out reads with MAPQ less than %u and stripping %u bases from read ends...\n", po.ReadPosQuality, po.ReadStrip);
-						BAD_READS_STATISTICS badStats;
-						read_set_stats(po.Reads, po.ReadCount, po.ReadPosQuality, &badStats);
-						read_set_stats_print(stderr, &badStats);
-						input_filter_bad_reads(po.Reads, &po.ReadCount, po.ReadPosQuality, TRUE);
-						input_sort_reads(po.Reads, po.ReadCount);
+						fprintf(stderr, "Filtered out reads with MAPQ less than %u, stripping %u bases from read ends...\n", po.ReadPosQuality, po.ReadStrip);
+						read_set_stats_print(stderr, &po.ReadStats);
 
-						ret = paired_reads_init();
+						ret = paired_reads_init(&po.Paired, po.Reads, po.ReadCount);
 						if (ret == ERR_SUCCESS) {
-							ret = paired_reads_insert_array(po.Reads, po.ReadCount);
+							ret = _prepare_reads(&po);
 							if (ret == ERR_SUCCESS) {
-								paired_reads_fix_overlaps(FALSE);
-
-								for (size_t i = 0; i < po.ReadCount; ++i)
-									read_shorten(po.Reads + i, po.ReadStrip);
-
-								paired_reads_fix_overlaps(TRUE);
-							}
+								FASTA_FILE seqFile;
 
-							if (ret == ERR_SUCCESS) {
+								ret = fasta_load(po.RefSeqFile, &seqFile);
 								if (ret == ERR_SUCCESS) {
-									FASTA_FILE seqFile;
+									ret = fasta_read_seq(&seqFile, &po.RefSeq);
+									if (ret != ERR_SUCCESS)
+										fasta_free(&seqFile);
+								}
 
-									ret = fasta_load(po.RefSeqFile, &seqFile);
-									if (ret == ERR_SUCCESS) {
-										ret = fasta_read_seq(&seqFile, &po.RefSeq);
-										if (ret != ERR_SUCCESS)
-											fasta_free(&seqFile);
+								if (ret == ERR_SUCCESS) {
+									po.VCFFileHandle = NULL;
+									if (*po.VCFFile != '\0') {
+										if (strcmp(po.VCFFile, "-") != 0) {
+											po.VCFFileHandle = fopen(po.VCFFile, "w");
+											ret = (po.VCFFileHandle != NULL) ? ERR_SUCCESS : ERR_NOT_FOUND;
+										} else po.VCFFileHandle = stdout;
+
+										if (ret == ERR_SUCCESS)
+											dym_array_init_VARIANT_CALL(&po.VCArray, 140);
 									}
 
 									if (ret == ERR_SUCCESS) {
-										po.VCFFileHandle = NULL;
-										if (*po.VCFFile != '\0') {
-											if (strcmp(po.VCFFile, "-") != 0) {
-												po.VCFFileHandle = fopen(po.VCFFile, "w");
-												ret = (po.VCFFileHandle != NULL) ? ERR_SUCCESS : ERR_NOT_FOUND;
-											} else po.VCFFileHandle = stdout;
-
-											if (ret == ERR_SUCCESS)
-												dym_array_init_VARIANT_CALL(&po.VCArray, 140);
-										}
+										ret = utils_calloc_GRAPH_LOOKASIDES(omp_get_num_procs(), &_graphLAs);
 
-										if (ret == ERR_SUCCESS) {
-											ret = utils_calloc_PUTILS_LOOKASIDE(omp_get_num_procs(), &_vertexLAs);
-											if (ret == ERR_SUCCESS)
-												ret = utils_calloc_PUTILS_LOOKASIDE(omp_get_num_procs(), &_edgeLAs);
+										if (ret == ERR_SUCCESS)
+											ret = utils_calloc_UTILS_ARENA(omp_get_num_procs(), &_graphArenas);
+
+										if (ret == ERR_SUCCESS)
+											ret = utils_calloc_GRAPH_MEMORY_STATISTICS(omp_get_num_procs(), &_graphMemoryStats);
 
+										if (ret == ERR_SUCCESS)
+											ret = utils_calloc_READ_COVERAGE_STATISTICS(omp_get_num_procs(), &_readCoverage);
+
+										if (ret == ERR_SUCCESS)
+											ret = utils_calloc_GEN_ARRAY_char(omp_get_num_procs(), &po.ReadBaseSubArrays);
+
+										if (ret == ERR_SUCCESS)
 											ret = utils_calloc_GEN_ARRAY_VARIANT_CALL(omp_get_num_procs(), &po.VCSubArrays);
+
+										if (ret == ERR_SUCCESS)
+											ret = utils_calloc_VC_INDEX(omp_get_num_procs(), &po.VCSubIndices);
+
+										if (ret == ERR_SUCCESS) {
+											ret = utils_calloc_GEN_ARRAY_READ_VIEW(omp_get_num_procs(), &po.ReadSubArrays);
 											if (ret == ERR_SUCCESS) {
-												ret = utils_calloc_GEN_ARRAY_ONE_READ(omp_get_num_procs(), &po.ReadSubArrays);
-												if (ret == ERR_SUCCESS) {
-													const size_t numThreads = omp_get_num_procs();
-													for (size_t i = 0; i < numThreads; ++i) {
-														dym_array_init_VARIANT_CALL(po.VCSubArrays + i, 140);
-														dym_array_init_ONE_READ(po.ReadSubArrays + i, 140);
-														_vertexLAs[i] = NULL;
-														_edgeLAs[i] = NULL;
-													}
+												const size_t numThreads = omp_get_num_procs();
+												// Threads after a failed one stay zeroed, which their cleanup accepts
+												for (size_t i = 0; i < numThreads && ret == ERR_SUCCESS; ++i) {
+													dym_array_init_VARIANT_CALL(po.VCSubArrays + i, 140);
+													if (ret == ERR_SUCCESS)
+														ret = vc_index_init(po.VCSubArrays + i, 0, po.VCSubIndices + i);
+
+													dym_array_init_READ_VIEW(po.ReadSubArrays + i, 140);
+													dym_array_init_char(po.ReadBaseSubArrays + i, 140);
+													memset(_graphLAs + i, 0, sizeof(GRAPH_LOOKASIDES));
+													if (ret == ERR_SUCCESS)
+														ret = utils_lookaside_init(&_graphLAs[i].EdgePool, sizeof(KMER_EDGE), 5000);
+
+													if (ret == ERR_SUCCESS)
+														ret = utils_arena_init(_graphArenas + i, UTILS_ARENA_DEFAULT_CHUNK_SIZE);
+												}
 
-													dym_array_init_AR_WRAPPER_CONTEXT(&_assemblyTasks, 140);
-													ret = dym_array_reserve_AR_WRAPPER_CONTEXT(&_assemblyTasks, po.RefSeq.Length / po.TestStep);
-													size_t regionCount = 0;
-													PACTIVE_REGION regions = NULL;
+												size_t regionCount = 0;
+												PACTIVE_REGION regions = NULL;
 
+												if (ret == ERR_SUCCESS)
 													ret = input_refseq_to_regions(po.RefSeq.Sequence, po.RefSeq.Length, &regions, &regionCount);
-													if (ret == ERR_SUCCESS) {
-														const ACTIVE_REGION *pa = NULL;
 
-														pa = regions;
-														for (size_t i = 0; i < regionCount; ++i) {
-															if (pa->Type == artValid && pa->Length >= po.RegionLength)
-																_activeRegionCount += (long)(pa->Length / po.TestStep);
+												if (ret == ERR_SUCCESS) {
+													const ACTIVE_REGION *pa = NULL;
+
+													pa = regions;
+													for (size_t i = 0; i < regionCount; ++i) {
+														if (pa->Type == artValid && pa->Length >= po.RegionLength)
+															_activeRegionCount += (long)(pa->Length / po.TestStep);
 
-															++pa;
+														++pa;
+													}
+
+													READ_INDEX readIndex;
+													AR_GENERATOR generator;
+													REF_PROFILE profile;
+													double profileTime = omp_get_wtime();
+
+													memset(&profile, 0, sizeof(profile));
+													if (po.RefProfile) {
+														ret = ref_profile_build(regions, regionCount, po.RegionLength, po.TestStep, po.KMerSize, min(KMER_MAXIMUM_SIZE, po.KMerSize + (KMER_SIZE_ATTEMPTS - 1)*KMER_SIZE_STEP), KMER_SIZE_STEP, po.OMPThreads, &profile);
+														if (ret == ERR_SUCCESS) {
+															size_t largerCount = 0;
+															size_t noneCount = 0;
+
+															profileTime = omp_get_wtime() - profileTime;
+															for (size_t i = 0; i < profile.WindowCount; ++i) {
+																if (profile.KMerSizes[i] > po.KMerSize)
+																	++largerCount;
+																else if (profile.KMerSizes[i] == 0)
+																	++noneCount;
+															}
+
+															fprintf(stderr, "Reference profile:          %zu windows, %zu need k-mers larger than %u, %zu have repeats at all sizes up to %u (%.3lf s)\n", profile.WindowCount, largerCount, po.KMerSize, noneCount, profile.MaxKMerSize, profileTime);
 														}
+													}
 
+													if (ret == ERR_SUCCESS) {
 														_activeRegionProcessed = 0;
-														pa = regions;
-														for (size_t i = 0; i < regionCount; ++i) {
-															if (pa->Type == artValid && pa->Length >= po.RegionLength)
-																process_active_region_in_parallel(pa, &po);
-
-															++pa;
+														input_read_index_init(&readIndex, po.Reads, po.ReadCount);
+														ret = _speculation_init(max(po.OMPThreads, 1));
+														if (ret == ERR_SUCCESS) {
+															ret = _ar_generator_init(&generator, &po, regions, regionCount, &readIndex, (po.RefProfile) ? &profile : NULL);
+															if (ret == ERR_SUCCESS) {
+																kt_for(po.OMPThreads, _ar_worker, &generator, max(po.OMPThreads, 1));
+																_ar_schedule_report(stderr, &generator);
+																_ar_generator_finit(&generator);
+															}
+
+															_speculation_finit();
 														}
 
-														kt_for(po.OMPThreads, _ar_wrapper, _assemblyTasks.Data, (long)gen_array_size(&_assemblyTasks));
-														input_free_regions(regions, regionCount);
+														if (po.RefProfile)
+															ref_profile_finit(&profile);
 													}
 
-													dym_array_finit_AR_WRAPPER_CONTEXT(&_assemblyTasks);
-													fasta_free_seq(&po.RefSeq);
-													fprintf(stderr, "Merging the results...\n");
-													vc_array_merge(&po.VCArray, po.VCSubArrays, numThreads);
+													input_free_regions(regions, regionCount);
+												}
 
-													int i = 0;
-#pragma omp parallel for shared(po)
-													for (i = 0; i < (int)numThreads; ++i) {
-														dym_array_finit_ONE_READ(po.ReadSubArrays + i);
-														vc_array_finit(po.VCSubArrays + i);
-													}
+												fasta_free_seq(&po.RefSeq);
+												fprintf(stderr, "Merging the results...\n");
+												// The merge sorts the per-thread arrays, so their indices are not valid anymore
+												for (size_t i = 0; i < numThreads; ++i)
+													vc_index_finit(po.VCSubIndices + i);
 
-													utils_free(po.ReadSubArrays);
+												vc_array_merge(&po.VCArray, po.VCSubArrays, numThreads);
+												_print_graph_memory_stats(stderr, numThreads);
+												_reduce_read_coverage(numThreads);
+
+												int i = 0;
+#pragma omp parallel for shared(po)
+												for (i = 0; i < (int)numThreads; ++i) {
+													dym_array_finit_READ_VIEW(po.ReadSubArrays + i);
+													dym_array_finit_char(po.ReadBaseSubArrays + i);
+													vc_array_finit(po.VCSubArrays + i);
+													utils_arena_finit(_graphArenas + i);
+													_finit_graph_lookasides(_graphLAs + i);
 												}
 
-												utils_free(po.VCSubArrays);
+												utils_free(po.ReadSubArrays);
 											}
 
-											utils_free(_edgeLAs);
-											utils_free(_vertexLAs);
+											utils_free(po.VCSubIndices);
+											utils_free(po.VCSubArrays);
+										}
 
-											if (po.VCFFileHandle != NULL && gen_array_size(&po.VCArray) > 0) {
-												if (ret == ERR_SUCCESS) {
-													VARIANT_GRAPH vg;
+										utils_free(po.ReadBaseSubArrays);
+										utils_free(_readCoverage);
+										utils_free(_graphMemoryStats);
+										utils_free(_graphArenas);
+										utils_free(_graphLAs);
 
-													fprintf(stderr, "Creating variant graph...\n");
-													ret = vg_graph_init(po.VCArray.Data, gen_array_size(&po.VCArray), po.Threshold, &vg);
+										if (po.VCFFileHandle != NULL && gen_array_size(&po.VCArray) > 0) {
+											if (ret == ERR_SUCCESS) {
+												VARIANT_GRAPH vg;
+
+												fprintf(stderr, "Creating variant graph...\n");
+												ret = vg_graph_init(po.VCArray.Data, gen_array_size(&po.VCArray), po.Threshold, &vg);
+												if (ret == ERR_SUCCESS) {
+													ret = vg_graph_add_paired(&vg, &po.Paired);
 													if (ret == ERR_SUCCESS) {
-														ret = vg_graph_add_paired(&vg);
-														if (ret == ERR_SUCCESS) {
-															vg_graph_color(&vg);
+														vg_graph_color(&vg);
 //															vg_graph_print(stdout, &vg);
-															vg_graph_finalize(&vg);
-														}
-
-														vg_graph_finit(&vg);
+														vg_graph_finalize(&vg);
 													}
 
-													vc_array_print(po.VCFFileHandle, po.RefSeqFile, &po.VCArray);
+													vg_graph_finit(&vg);
 												}
 
-												vc_array_finit(&po.VCArray);
-												if (po.VCFFileHandle != NULL && po.VCFFileHandle != stdout)
-													fclose(po.VCFFileHandle);
+												vc_array_print(po.VCFFileHandle, po.RefSeqFile, &po.VCArray);
 											}
 
+											vc_array_finit(&po.VCArray);
+											if (po.VCFFileHandle != NULL && po.VCFFileHandle != stdout)
+												fclose(po.VCFFileHandle);
 										}
 
-										fasta_free(&seqFile);
 									}
-								}
 
+									fasta_free(&seqFile);
+								}
 							}
 
 							fprintf(stderr, "Read coverage: %lf\n", _readBaseCount / _totalRegionLength);
-							paired_reads_finit();
+							paired_reads_finit(&po.Paired);
+							if (po.ReadStore.Extensions != NULL) {
+								read_store_finit(&po.ReadStore);
+								utils_free(po.Reads);
+							}
 						}
 					}
 				}
@@ -897,7 +1930,6 @@ int main(int argc, char *argv[])
 			options_module_finit();
 		}
 
-		omp_destroy_lock(&_readCoverageLock);
 
 	return ret;
 }
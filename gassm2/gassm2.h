@@ -10,6 +10,7 @@
 #include "input-file.h"
 #include "variant-types.h"
 #include "libkmer.h"
+#include "utils-lookaside.h"
 
 /************************************************************************/
 /*                   PROGRAM OTPIONS                                    */
@@ -27,6 +28,11 @@
 #define PROGRAM_OPTION_LOW_QUALITY_VARIANT				"low-quality-variant"
 #define PROGRAM_OPTION_BINOM_THRESHOLD					"binom-threshold"
 #define PROGRAM_OPTION_NO_SHORT_VARIANTS				"no-short-variants"
+#define PROGRAM_OPTION_CACHE_FILE						"cache-file"
+#define PROGRAM_OPTION_SCHEDULE_REPORT					"schedule-report"
+#define PROGRAM_OPTION_SPECULATIVE_KMERS				"speculative-kmers"
+#define PROGRAM_OPTION_SOLID_KMERS						"solid-kmers"
+#define PROGRAM_OPTION_REF_PROFILE						"ref-profile"
 
 
 
@@ -38,7 +44,7 @@
 #define PROGRAM_OPTION_SEQFILE_DESC						"File (FASTA) containing the reference sequence"
 #define PROGRAM_OPTION_SEQLEN_DESC						"Length of a reference sequence or an active region (500..50000)"
 #define PROGRAM_OPTION_THRESHOLD_DESC					"Global threshold"
-#define PROGRAM_OPTION_READFILE_DESC					"Name of a file (SAM) that contains reads. Valid only for non-test mode."
+#define PROGRAM_OPTION_READFILE_DESC					"Name of a file (SAM, BAM or a read cache) that contains reads. Valid only for non-test mode."
 #define PROGRAM_OPTION_OUTPUT_DIRECTORY_DESC			"Directory for debug outputs"
 #define PROGRAM_OPTION_VCFFILE_DESC						"VCF file name"
 #define PROGRAM_OPTION_NO_SHORT_VARIANTS_DESC			"Do not optimize for short variants"
@@ -46,6 +52,11 @@
 #define PROGRAM_OPTION_BINOM_THRESHOLD_DESC				"Binomial threshold (0..100)"
 #define PROGRAM_OPTION_READ_POS_QUALITY_DESC			"Minimal mapping quality of accepted reads"
 #define PROGRAM_OPTION_THREADS_DESC						"Number of threads to parallelize the variant calling"
+#define PROGRAM_OPTION_CACHE_FILE_DESC					"Read cache created by the index command"
+#define PROGRAM_OPTION_SCHEDULE_REPORT_DESC				"File to write predicted and actual costs of the active regions to (TSV)"
+#define PROGRAM_OPTION_SPECULATIVE_KMERS_DESC			"Number of k-mer sizes assembled concurrently for regions predicted to be hard (1..8, 1 disables)"
+#define PROGRAM_OPTION_SOLID_KMERS_DESC					"Minimum number of occurrences of a read k-mer in an active region to become a vertex (0 disables the filter, other values may drop calls of variants with low coverage)"
+#define PROGRAM_OPTION_REF_PROFILE_DESC					"Start each active region at the smallest k-mer size without repeats in its reference (changes the calls of repetitive regions)"
 
 /************************************************************************/
 /*                                                                      */
@@ -67,6 +78,12 @@
 	GRAPH_PRINT_THRESHOLD_2 | GRAPH_PRINT_SHRINK | GRAPH_PRINT_VARIANTS)		\
 
 
+/** Difference between k-mer sizes of two consecutive assembly attempts. */
+#define KMER_SIZE_STEP							10
+/** Maximum number of assembly attempts of a region. */
+#define KMER_SIZE_ATTEMPTS						8
+
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
@@ -77,8 +94,45 @@ typedef enum _EGassm2CommandType {
 	gctHelp,
 	gctCall,
 	gctCorrect,
+	gctIndex,
+	gctSortBenchmark,
 } EGassm2CommandType, *PEGassm2CommandType;
 
+/** Memory consumed by assembly graphs of one thread. */
+typedef struct _GRAPH_MEMORY_STATISTICS {
+	/** Number of active regions for which at least one graph was built. */
+	size_t RegionCount;
+	/** Sum of peak arena usages of the regions. */
+	size_t TotalBytes;
+	/** Maximum arena usage seen for a single region. */
+	size_t MaxBytes;
+} GRAPH_MEMORY_STATISTICS, *PGRAPH_MEMORY_STATISTICS;
+
+/** Read coverage accumulated by one thread. Padded to a cache line, so the threads
+ *  do not write to the same lines. */
+typedef struct _READ_COVERAGE_STATISTICS {
+	/** Number of bases of the reads of the processed regions. */
+	double ReadBaseCount;
+	/** Total length of the processed regions. */
+	size_t TotalRegionLength;
+	uint8_t Padding[64 - sizeof(double) - sizeof(size_t)];
+} READ_COVERAGE_STATISTICS, *PREAD_COVERAGE_STATISTICS;
+
+/** Vertex and edge pools of one thread.
+ *
+ *  Vertex size depends on the k-mer size that grows when the assembly of a region
+ *  fails, so each k-mer size gets its own pool created on first use. K-mer sizes
+ *  leading to the same block size share one pool.
+ */
+typedef struct _GRAPH_LOOKASIDES {
+	/** Vertex pool for each k-mer size, NULL if not created yet. */
+	PUTILS_LOOKASIDE VertexPools[KMER_MAXIMUM_SIZE + 1];
+	/** Storage of the distinct vertex pools. */
+	UTILS_LOOKASIDE VertexPoolStorage[KMER_MAXIMUM_SIZE + 1];
+	size_t VertexPoolCount;
+	UTILS_LOOKASIDE EdgePool;
+} GRAPH_LOOKASIDES, *PGRAPH_LOOKASIDES;
+
 typedef struct _PROGRAM_OPTIONS {
 	const char *OutputDirectoryBase;
 	uint32_t KMerSize;
@@ -89,12 +143,32 @@ typedef struct _PROGRAM_OPTIONS {
 	uint32_t Threshold;
 	size_t ReadCount;
 	PONE_READ Reads;
+	/** Statistics of bad reads, filtered out during loading. */
+	BAD_READS_STATISTICS ReadStats;
 	const char *VCFFile;
 	int32_t OMPThreads;
 	uint8_t ReadPosQuality;
 	FILE *VCFFileHandle;
 	GEN_ARRAY_VARIANT_CALL *VCSubArrays;
-	GEN_ARRAY_ONE_READ *ReadSubArrays;
+	/** Indices of the per-thread call arrays, they live as long as the arrays. */
+	VC_INDEX *VCSubIndices;
+	GEN_ARRAY_READ_VIEW *ReadSubArrays;
+	/** Per-thread buffers for bases of the views, see input_region_reads(). */
+	GEN_ARRAY_char *ReadBaseSubArrays;
+	/** Compact storage of the reads, built before the active regions are processed. */
+	READ_STORE ReadStore;
+	/** The reads were mapped from a read cache and are already preprocessed. */
+	boolean ReadsCached;
+	READ_CACHE_INFO CacheInfo;
+	char *CacheFile;
+	/** Predicted and actual costs of the active regions go there, empty if not wanted. */
+	char *ScheduleReportFile;
+	/** Maximum number of k-mer sizes assembled concurrently for a hard region. */
+	uint32_t SpeculativeKMers;
+	/** Start each region at the smallest k-mer size without reference repeats. */
+	boolean RefProfile;
+	/** Reads grouped by their templates. */
+	PAIRED_READS Paired;
 	GEN_ARRAY_VARIANT_CALL VCArray;
 	uint32_t ReadStrip;
 	PARSE_OPTIONS ParseOptions;
@@ -28,18 +28,22 @@ typedef struct _PARSE_OPTIONS {
 	uint32_t RegionLength;
 	uint64_t BinomThreshold;
 	uint32_t LQVariant;
+	/** Read k-mers occurring fewer times in the region do not become vertices, 0 disables the filter. */
+	uint32_t SolidKMerThreshold;
 	PLOT_OPTIONS PlotOptions;
 } PARSE_OPTIONS, *PPARSE_OPTIONS;
 
 typedef struct _ASSEMBLY_STATE {
 	PKMER_GRAPH Graph;
-	PONE_READ Reads;
+	const READ_VIEW *Reads;
 	size_t ReadCount;
 	PARSE_OPTIONS ParseOptions;
 	PKMER_VERTEX **Paths;
 	PKMER_EDGE **EdgePaths;
 	uint8_t **FlagPaths;
 	size_t *PathLengths;
+	/** The reads trimmed to their solid k-mers, NULL if the filter is disabled. */
+	PREAD_VIEW SolidReads;
 } ASSEMBLY_STATE, *PASSEMBLY_STATE;
 
 
@@ -49,7 +53,8 @@ ERR_VALUE assembly_add_helper_vertices(PASSEMBLY_STATE State);
 ERR_VALUE assembly_create_long_edges(PASSEMBLY_STATE State, PGEN_ARRAY_KMER_EDGE_PAIR PairArray);
 ERR_VALUE assembly_variants_to_edges(PASSEMBLY_STATE State, const GEN_ARRAY_VARIANT_CALL *VCArray);
 
-ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptions, PONE_READ Reads, size_t ReadCount, PASSEMBLY_STATE State);
+ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptions, const READ_VIEW *Reads, size_t ReadCount, PASSEMBLY_STATE State);
+void assembly_state_reset(PASSEMBLY_STATE State);
 void assembly_state_finit(PASSEMBLY_STATE State);
 
 
@@ -19,11 +19,13 @@
 		size_t AllocLength;								\
 		aDataType *Data;								\
 		size_t Ratio;									\
+		PUTILS_ARENA Arena;								\
 		aDataType Storage[GEN_ARRAY_STATIC_ALLOC];							\
 	} GEN_ARRAY_TYPE(aDataType), *PGEN_ARRAY_##aDataType	\
 
 
 #define gen_array_size(aArray)							((aArray)->ValidLength)
+#define gen_array_set_arena(aArray, aArena)				((aArray)->Arena = (aArena))
 
 #define GEN_ARRAY_IMPLEMENTATION(aDataType)									\
 	GEN_ARRAY_ALLOC_FUNCTION(aDataType)										\
@@ -64,7 +66,7 @@
 #define GEN_ARRAY_FINIT_FUNCTION(aDataType)												\
 	INLINE_FUNCTION void dym_array_finit_##aDataType(GEN_ARRAY_PTYPE(aDataType) Array)	\
 	{																					\
-		if (Array->AllocLength > 0 && Array->Data != Array->Storage)					\
+		if (Array->Arena == NULL && Array->AllocLength > 0 && Array->Data != Array->Storage)	\
 			utils_free(Array->Data);													\
 																						\
 		Array->Data = NULL;																\
@@ -80,10 +82,12 @@
 		if (Count <= Array->AllocLength)														\
 			return ERR_SUCCESS;																	\
 																								\
-		ret = dym_array_alloc_data_##aDataType(Count, &newData);						\
+		if (Array->Arena != NULL)																\
+			ret = utils_arena_calloc(Array->Arena, Count, sizeof(aDataType), (void **)&newData);	\
+		else ret = dym_array_alloc_data_##aDataType(Count, &newData);					\
 		if (ret == ERR_SUCCESS) {																\
 			memcpy(newData, Array->Data, Array->ValidLength*sizeof(aDataType));					\
-			if (Array->AllocLength > 0 && Array->Data != Array->Storage)						\
+			if (Array->Arena == NULL && Array->AllocLength > 0 && Array->Data != Array->Storage)	\
 				utils_free(Array->Data);														\
 																								\
 			Array->AllocLength = Count;															\
@@ -10,10 +10,12 @@
 #include "kmer.h"
 
 
-typedef struct _KMER_EDGE_TABLE_KEY {
-	const KMER *Source;
-	const KMER *Dest;
-} KMER_EDGE_TABLE_KEY, *PKMER_EDGE_TABLE_KEY;
+/** Key of the edge table, composed from identifiers of the source (upper 32 bits)
+ *  and destination (lower 32 bits) vertices.
+ */
+typedef uint64_t KMER_EDGE_TABLE_KEY, *PKMER_EDGE_TABLE_KEY;
+
+#define kmer_edge_table_key(aSourceId, aDestId)		((((uint64_t)(aSourceId)) << 32) | (uint64_t)(aDestId))
 
 struct _KMER_EDGE_TABLE;
 
@@ -46,13 +48,14 @@ typedef struct _KMER_EDGE_TABLE {
 
 ERR_VALUE kmer_edge_table_create(const uint32_t KMerSize, const size_t Size, const PKMER_EDGE_TABLE_CALLBACKS Callbacks, PKMER_EDGE_TABLE *Table);
 void kmer_edge_table_destroy(PKMER_EDGE_TABLE Table);
+void kmer_edge_table_reset(PKMER_EDGE_TABLE Table, const uint32_t KMerSize);
 
 #define kmer_edge_table_size(aTable)	\
 	(kh_size((aTable)->KHashTable))
 
-ERR_VALUE kmer_edge_table_insert(PKMER_EDGE_TABLE Table, const KMER *Source, const KMER *Dest, void *Data);
-ERR_VALUE kmer_edge_table_delete(PKMER_EDGE_TABLE Table, const PKMER Source, const PKMER Dest);
-void *kmer_edge_table_get(const struct _KMER_EDGE_TABLE *Table, const struct _KMER *Source, const struct _KMER *Dest);
+ERR_VALUE kmer_edge_table_insert(PKMER_EDGE_TABLE Table, const uint32_t SourceId, const uint32_t DestId, void *Data);
+ERR_VALUE kmer_edge_table_delete(PKMER_EDGE_TABLE Table, const uint32_t SourceId, const uint32_t DestId);
+void *kmer_edge_table_get(const struct _KMER_EDGE_TABLE *Table, const uint32_t SourceId, const uint32_t DestId);
 ERR_VALUE kmer_edge_table_first(const PKMER_EDGE_TABLE Table, void **Slot, void **Data);
 ERR_VALUE kmer_edge_table_next(const PKMER_EDGE_TABLE Table, const void *Current, void **Next, void **Data);
 
@@ -21,6 +21,8 @@ struct _KMER_GRAPH;
 typedef struct _KMER_EDGE {
 	struct _KMER_VERTEX *Source;
 	struct _KMER_VERTEX *Dest;
+	/** Identifier of the edge, unique within its graph. */
+	uint32_t Id;
 	/** Edge creation order. */
 	unsigned int Order;
 	/** Edge type (read, reference, variant). */
@@ -58,7 +60,12 @@ POINTER_ARRAY_IMPLEMENTATION(KMER_EDGE)
 
 /** Represents one vertex of the de Bruijn graph. */
 typedef struct _KMER_VERTEX {
+	/** Identifier of the vertex, unique within its graph. Keys of the edge tables
+	    are derived from it. */
+	uint32_t Id;
 	uint32_t Order;
+	/** Position in the dirty vertex list of the graph plus one, 0 if not there. */
+	uint32_t DirtyIndex;
 	/** Indicates whether this is a helper vertex. */
 	boolean Helper;
 	/** Can connecting/long edges start here? */
@@ -146,6 +153,11 @@ typedef struct _KMER_GRAPH_ALLOCATOR {
 	KMER_GRAPH_EDGE_ALLOCATOR *EdgeAllocator;
 	KMER_GRAPH_EDGE_FREER *EdgeFreer;
 	void *EdgeAllocatorContext;
+	/** If not NULL, arrays of vertices and edges, edge sequences and read information
+	    are allocated from this arena (vertices and edges too, unless the routines
+	    above are provided). kmer_graph_destroy() then does not visit individual
+	    objects; the arena and the vertex and edge allocators are reset by the caller. */
+	PUTILS_ARENA Arena;
 } KMER_GRAPH_ALLOCATOR, *PKMER_GRAPH_ALLOCATOR;
 
 /** Stores k-mers equal by sequence (but differrent by their context numbers). */
@@ -162,6 +174,10 @@ typedef struct _KMER_GRAPH {
 	uint32_t KMerSize;
 	uint32_t NumberOfVertices;
 	uint32_t NumberOfEdges;
+	/** Identifier to be assigned to the next vertex created. */
+	uint32_t NextVertexId;
+	/** Identifier to be assigned to the next edge created. */
+	uint32_t NextEdgeId;
 	uint32_t TypedEdgeCount[kmetMax];
 	PKMER_TABLE VertexTable;
 	PKMER_EDGE_TABLE EdgeTable;
@@ -171,6 +187,11 @@ typedef struct _KMER_GRAPH {
 	GRAPH_ON_DELETE_EDGE_CALLBACK *DeleteEdgeCallback;
 	void *DeleteEdgeCallbackContext;
 	PKMER_VERTEX VerticesToDeleteList;
+	/** Vertices that may have lost all their incoming or outgoing edges, kmer_graph_delete_trailing_things()
+	    looks only at them. Each vertex with no incoming or outgoing edges is there (except the start and end). */
+	POINTER_ARRAY_KMER_VERTEX DirtyVertices;
+	/** Some vertices could not be added to the dirty list, the next pass must visit all of them. */
+	boolean DirtyVerticesLost;
 	PKMER_TABLE KmerListTable;
 	uint8_t QualityTable[256];
 	POINTER_ARRAY_KMER_VERTEX RefVertices;
@@ -178,6 +199,55 @@ typedef struct _KMER_GRAPH {
 } KMER_GRAPH, *PKMER_GRAPH;
 
 
+/** Frequently accessed fields of a vertex in a frozen graph. */
+typedef struct _KMER_FROZEN_VERTEX {
+	/** Type of the vertex (start, end, reference, read). */
+	EKMerVertexType Type;
+	/** Indicates whether this is a helper vertex. */
+	boolean Helper;
+	/** The original vertex. */
+	PKMER_VERTEX Vertex;
+} KMER_FROZEN_VERTEX, *PKMER_FROZEN_VERTEX;
+
+/** Frequently accessed fields of an edge in a frozen graph. */
+typedef struct _KMER_FROZEN_EDGE {
+	/** Index of the source vertex. */
+	uint32_t Source;
+	/** Index of the destination vertex. */
+	uint32_t Dest;
+	/** The original edge. */
+	PKMER_EDGE Edge;
+} KMER_FROZEN_EDGE, *PKMER_FROZEN_EDGE;
+
+/** Snapshot of the graph adjacency in the compressed sparse row form.
+ *
+ *  Vertices are numbered from zero. Outgoing edges of a vertex occupy the first
+ *  @SuccCounts[v] items of a range of the @Edges array (starting at @SuccOffsets[v],
+ *  ordered in the same way as the Successors array of the vertex).
+ *
+ *  The snapshot becomes invalid when the graph changes, unless the change is
+ *  repeated by kmer_graph_frozen_delete_edge() and kmer_graph_frozen_add_edge().
+ */
+typedef struct _KMER_GRAPH_FROZEN {
+	uint32_t VertexCount;
+	uint32_t EdgeCount;
+	PKMER_FROZEN_VERTEX Vertices;
+	PKMER_FROZEN_EDGE Edges;
+	/** VertexCount + 1 items, the last one is EdgeCount. */
+	uint32_t *SuccOffsets;
+	/** VertexCount items, the current number of outgoing edges. */
+	uint32_t *SuccCounts;
+	/** Maps vertex identifiers to vertex indices. */
+	uint32_t *IdToIndex;
+	uint32_t IdCount;
+	/** Maps edge identifiers to edge indices. */
+	uint32_t *EdgeIdToIndex;
+	uint32_t EdgeIdCount;
+	/** One byte per edge, available to traversal routines. Must be zeroed after use. */
+	uint8_t *EdgeMarks;
+} KMER_GRAPH_FROZEN, *PKMER_GRAPH_FROZEN;
+
+
 
 
 
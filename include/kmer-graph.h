@@ -36,9 +36,17 @@ UTILS_NAMED_CALLOC_FUNCTION(PPKMER_EDGE, PKMER_EDGE *)
 #define kmer_vertex_out_degree(aVertex)						(pointer_array_size(&(aVertex)->Successors))
 PKMER_EDGE kmer_vertex_get_edge_by_base(PKMER_VERTEX Vertex, const char Base);
 
+#define kmer_frozen_vertex_index(aFrozen, aVertex)			((aFrozen)->IdToIndex[(aVertex)->Id])
+#define kmer_frozen_edge_index(aFrozen, aEdge)				((aFrozen)->EdgeIdToIndex[(aEdge)->Id])
+#define kmer_frozen_vertex_out_degree(aFrozen, aIndex)		((aFrozen)->SuccCounts[(aIndex)])
+#define kmer_frozen_succ_edge_index(aFrozen, aIndex, aEdge)	((aFrozen)->SuccOffsets[(aIndex)] + (aEdge))
+
 
 ERR_VALUE kmer_graph_create(const uint32_t KMerSize, const size_t VerticesHint, const size_t EdgesHint, PKMER_GRAPH *Graph);
 void kmer_graph_destroy(PKMER_GRAPH Graph);
+ERR_VALUE kmer_graph_reset(PKMER_GRAPH Graph, const uint32_t KMerSize);
+ERR_VALUE kmer_graph_alloc(const KMER_GRAPH *Graph, const size_t Size, void **Address);
+void kmer_graph_free(const KMER_GRAPH *Graph, void *Address);
 void kmer_graph_print(FILE *Stream, const KMER_GRAPH *Graph);
 void kmer_graph_set_starting_vertex(PKMER_GRAPH Graph, const KMER *KMer);
 void kmer_graph_set_ending_vertex(PKMER_GRAPH Graph, const KMER *KMer);
@@ -50,7 +58,7 @@ ERR_VALUE kmer_graph_connect_reads_by_pairs(PKMER_GRAPH Graph, const size_t Thre
 ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL VCArray, const char *CHrom, const PARSE_OPTIONS *Options, boolean *Changed);
 
 ERR_VALUE kmer_graph_add_vertex_ex(PKMER_GRAPH Graph, const KMER *KMer, const EKMerVertexType Type, PKMER_VERTEX *Vertex);
-ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER *KMer1, const KMER *KMer2, PKMER_VERTEX *Vertex);
+ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER_VERTEX *Source, const KMER_VERTEX *Dest, PKMER_VERTEX *Vertex);
 ERR_VALUE kmer_graph_add_edge_ex(PKMER_GRAPH Graph, PKMER_VERTEX Source, PKMER_VERTEX Dest, const EKMerEdgeType Type, PKMER_EDGE *Edge);
 ERR_VALUE kmer_graph_delete_vertex(PKMER_GRAPH Graph, PKMER_VERTEX Vertex);
 void kmer_graph_delete_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge);
@@ -59,7 +67,7 @@ ERR_VALUE kmer_graph_get_splitted_edge(PKMER_GRAPH Graph, const KMER_VERTEX *Sou
 ERR_VALUE kmer_graph_split_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge, PKMER_EDGE *SourceEdge, PKMER_EDGE *DestEdge, PKMER_VERTEX *SplitVertex);
 void kmer_edge_add_seq(PKMER_EDGE Edge, EKMerEdgeType Type, const char *Seq, const size_t Length);
 
-PKMER_EDGE kmer_graph_get_edge(const struct _KMER_GRAPH *Graph, const struct _KMER *Source, const struct _KMER *Dest);
+PKMER_EDGE kmer_graph_get_edge(const struct _KMER_GRAPH *Graph, const struct _KMER_VERTEX *Source, const struct _KMER_VERTEX *Dest);
 ERR_VALUE kmer_graph_get_vertices(const KMER_GRAPH *Graph, const KMER *KMer, PPOINTER_ARRAY_KMER_VERTEX *VertexArray);
 
 PKMER_EDGE _get_refseq_edge(const KMER_VERTEX *Vertex);
@@ -67,6 +75,11 @@ PKMER_EDGE _get_refseq_or_variant_edge(const KMER_VERTEX *Vertex);
 
 ERR_VALUE kmer_graph_compute_weights(PKMER_GRAPH Graph);
 
+ERR_VALUE kmer_graph_freeze(const KMER_GRAPH *Graph, PKMER_GRAPH_FROZEN Frozen);
+void kmer_graph_frozen_finit(PKMER_GRAPH_FROZEN Frozen);
+ERR_VALUE kmer_graph_frozen_delete_edge(PKMER_GRAPH_FROZEN Frozen, const KMER_EDGE *Edge);
+ERR_VALUE kmer_graph_frozen_add_edge(PKMER_GRAPH_FROZEN Frozen, const KMER_EDGE *Edge);
+
 ERR_VALUE kmer_edge_add_read(PKMER_EDGE Edge, size_t ReadIndex, size_t ReadPosition, uint8_t Quality);
 
 
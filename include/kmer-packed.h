@@ -0,0 +1,58 @@
+
+#ifndef __GASSM_KMER_PACKED_H__
+#define __GASSM_KMER_PACKED_H__
+
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include "utils.h"
+
+
+/** Represents a k-mer with two bits per base.
+ *
+ *  The @Bases array consists of three parts. The first one holds the 2-bit codes of
+ *  the bases (the last base occupies the two least significant bits of the first word),
+ *  the second one is an exception mask with one bit per position. Positions marked
+ *  in the mask do not contain a nucleotide but one of the special symbols (B, H, D, N)
+ *  that are encoded in the same two bits. The last word keeps a rolling (ntHash-like)
+ *  hash of the sequence that is updated in constant time by every modification, so
+ *  the whole array can be copied by kmer_packed_seq_init_raw().
+ */
+typedef struct _KMER_PACKED {
+	uint32_t Number;
+	uint32_t Size;
+	uint64_t Bases[1];
+} KMER_PACKED, *PKMER_PACKED;
+
+
+#define KMER_PACKED_MAXIMUM_SIZE						101
+#define KMER_PACKED_BASE_WORDS(aKMerSize)				(((aKMerSize) + 31) / 32)
+#define KMER_PACKED_MASK_WORDS(aKMerSize)				(((aKMerSize) + 63) / 64)
+#define KMER_PACKED_SEQ_WORDS(aKMerSize)				(KMER_PACKED_BASE_WORDS(aKMerSize) + KMER_PACKED_MASK_WORDS(aKMerSize))
+#define KMER_PACKED_WORDS(aKMerSize)					(KMER_PACKED_SEQ_WORDS(aKMerSize) + 1)
+#define KMER_PACKED_BYTES(aKMerSize)					(sizeof(KMER_PACKED) + (KMER_PACKED_WORDS(aKMerSize) - 1)*sizeof(uint64_t))
+#define KMER_PACKED_BYTES_EXTRA(aKMerSize, aExtra)		(KMER_PACKED_BYTES(aKMerSize) + (aExtra))
+
+
+#define kmer_packed_get_size(aKMer)						((aKMer)->Size)
+#define kmer_packed_set_size(aKMer, aSize)				((aKMer)->Size = (aSize))
+#define kmer_packed_get_number(aKMer)					((aKMer)->Number)
+#define kmer_packed_set_number(aKMer, aNumber)			((aKMer)->Number = (aNumber))
+#define kmer_packed_get_rolling_hash(aSize, aKMer)		((aKMer)->Bases[KMER_PACKED_SEQ_WORDS(aSize)])
+
+void kmer_packed_seq_init_raw(PKMER_PACKED KMer, const uint32_t KMerSize, const uint64_t *Data);
+void kmer_packed_seq_init_by_sequence(PKMER_PACKED KMer, const uint32_t KMerSize, const char *Sequence);
+void kmer_packed_advance(const uint32_t KMerSize, PKMER_PACKED KMer, const char Base);
+void kmer_packed_back(const uint32_t KMerSize, PKMER_PACKED KMer, const char Base);
+void kmer_packed_set_base(const uint32_t KMerSize, PKMER_PACKED KMer, const uint32_t Pos, const char Base);
+char kmer_packed_get_base(const uint32_t KMerSize, const KMER_PACKED *KMer, const uint32_t Pos);
+char kmer_packed_get_last_base(const uint32_t KMerSize, const KMER_PACKED *KMer);
+size_t kmer_packed_hash(const uint32_t KMerSize, const KMER_PACKED *KMer);
+void kmer_packed_print(FILE *Stream, const uint32_t KMerSize, const KMER_PACKED *KMer);
+boolean kmer_packed_seq_equal(const uint32_t KMerSize, const KMER_PACKED *K1, const KMER_PACKED *K2);
+
+
+
+
+#endif
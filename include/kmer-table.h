@@ -3,13 +3,11 @@
 #define __GASSM_KMER_TABLE_H__
 
 
-#include "khash.h"
+#include <stddef.h>
 #include "err.h"
 #include "kmer.h"
 
 
-__KHASH_TYPE(vertexTable, const KMER *, void *)
-
 struct _KMER_TABLE;
 
 typedef void(KMER_TABLE_ON_INSERT_CALLBACK)(struct _KMER_TABLE *Table, void *ItemData, const uint32_t Order);
@@ -26,20 +24,47 @@ typedef struct _KMER_TABLE_CALLBACKS {
 } KMER_TABLE_CALLBACKS, *PKMER_TABLE_CALLBACKS;
 
 
+/** One slot of the open-addressing table. The key is copied into the slot,
+ *  so comparing keys does not require dereferencing the data.
+ */
+typedef struct _KMER_TABLE_ENTRY {
+	/** Hash of the key, computed during the insertion. */
+	size_t Hash;
+	/** Data associated with the key. NULL marks an empty slot. */
+	void *Data;
+	/** The key. Must be the last member since its size depends on k. */
+	KMER KMer;
+} KMER_TABLE_ENTRY, *PKMER_TABLE_ENTRY;
+
+/** Hash table mapping k-mers to pointers. Uses linear probing over
+ *  an array of slots with inlined keys. Deleted slots are marked by tombstones,
+ *  so the table may be modified while being enumerated.
+ */
 typedef struct _KMER_TABLE {
 	uint32_t KMerSize;
 	uint32_t LastOrder;
 	KMER_TABLE_CALLBACKS Callbacks;
-	khash_t(vertexTable) *KHashTable;
+	/** Size of one slot, in bytes. */
+	size_t EntrySize;
+	/** Number of slots, always a power of two. */
+	size_t Capacity;
+	/** Number of slots holding valid data. */
+	size_t Count;
+	/** Number of tombstones. */
+	size_t Deleted;
+	unsigned char *Entries;
+	/** Size of the slot array, in bytes. */
+	size_t EntriesSize;
 } KMER_TABLE, *PKMER_TABLE;
 
 
 ERR_VALUE kmer_table_create(const uint32_t KMerSize, const size_t Size, const KMER_TABLE_CALLBACKS *Callbacks, PKMER_TABLE *Table);
 void kmer_table_destroy(PKMER_TABLE Table);
+ERR_VALUE kmer_table_reset(PKMER_TABLE Table, const uint32_t KMerSize);
 void kmer_table_print(FILE *Stream, const PKMER_TABLE Table);
 
 #define kmer_table_size(aTable)	\
-	(kh_size((aTable)->KHashTable))
+	((aTable)->Count)
 
 ERR_VALUE kmer_table_delete(PKMER_TABLE Table, const KMER *KMer);
 ERR_VALUE kmer_table_insert(PKMER_TABLE Table, const KMER *KMer, void *Data);
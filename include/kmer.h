@@ -14,9 +14,16 @@
 #include "utils.h"
 #include "kmer-debug.h"
 #include "kmer-short.h"
+#include "kmer-packed.h"
 
 
-#if 1
+/*
+ * The k-mer representation is selected at build time. The 2-bit packed one is
+ * the default, KMER_BACKEND_DEBUG (one character per base) and KMER_BACKEND_SHORT
+ * (bit planes, at most 63 bases) may be enabled through the compiler command line.
+ */
+
+#if defined(KMER_BACKEND_DEBUG)
 
 #define KMER_MAXIMUM_SIZE						KMER_DEBUG_MAXIMUM_SIZE
 #define KMER_BYTES(aKMerSize)					KMER_DEBUG_BYTES(aKMerSize)
@@ -42,7 +49,7 @@
 #define	kmer_print						kmer_debug_print
 #define	kmer_hash						kmer_debug_hash
 
-#else
+#elif defined(KMER_BACKEND_SHORT)
 
 #define KMER_MAXIMUM_SIZE						KMER_SHORT_MAXIMUM_SIZE
 #define KMER_BYTES(aKMerSize)					KMER_SHORT_BYTES(aKMerSize)
@@ -68,6 +75,32 @@
 #define	kmer_print						kmer_short_print
 #define	kmer_hash						kmer_short_hash
 
+#else
+
+#define KMER_MAXIMUM_SIZE						KMER_PACKED_MAXIMUM_SIZE
+#define KMER_BYTES(aKMerSize)					KMER_PACKED_BYTES(aKMerSize)
+#define KMER_BYTES_EXTRA(aKMerSize, aExtra)		KMER_PACKED_BYTES_EXTRA(aKMerSize, aExtra)
+
+#define _KMER			_KMER_PACKED
+#define KMER			KMER_PACKED
+#define PKMER			PKMER_PACKED
+
+#define kmer_get_size				kmer_packed_get_size
+#define kmer_set_size				kmer_packed_set_size
+#define kmer_get_base				kmer_packed_get_base
+#define kmer_set_base				kmer_packed_set_base
+#define kmer_get_last_base			kmer_packed_get_last_base
+#define kmer_get_number				kmer_packed_get_number
+#define kmer_set_number				kmer_packed_set_number
+
+#define	kmer_seq_init_raw				kmer_packed_seq_init_raw
+#define	kmer_seq_init_by_sequence		kmer_packed_seq_init_by_sequence
+#define	kmer_advance					kmer_packed_advance
+#define	kmer_back						kmer_packed_back
+#define	kmer_seq_equal					kmer_packed_seq_equal
+#define	kmer_print						kmer_packed_print
+#define	kmer_hash						kmer_packed_hash
+
 #endif
 
 
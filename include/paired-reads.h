@@ -3,19 +3,29 @@
 #define __PAIRED_READS_H__
 
 
-#include "khash.h"
 #include "reads.h"
 
 
-ERR_VALUE paired_reads_insert(const ONE_READ *Read);
-ERR_VALUE paired_reads_insert_array(const ONE_READ *Reads, const size_t Count);
-void paired_reads_fix_overlaps(boolean Strip);
-ERR_VALUE paired_reads_first(khiter_t *Iterator, PPOINTER_ARRAY_ONE_READ *Reads);
-ERR_VALUE paired_reads_next(khiter_t Iterator, khiter_t *NewIt, PPOINTER_ARRAY_ONE_READ *Reads);
-void paired_reads_print(FILE *Stream);
-
-ERR_VALUE paired_reads_init(void);
-void paired_reads_finit(void);
+/** Reads grouped by their templates (TemplateId of the read extensions).
+ *
+ *  Reads of template t are Reads[Members[TemplateStarts[t]]] ...
+ *  Reads[Members[TemplateStarts[t + 1] - 1]], templates are numbered from one
+ *  to TemplateCount.
+ */
+typedef struct _PAIRED_READS {
+	PONE_READ Reads;
+	size_t ReadCount;
+	size_t TemplateCount;
+	size_t *TemplateStarts;
+	/** Indices of the reads, grouped by their templates. */
+	size_t *Members;
+} PAIRED_READS, *PPAIRED_READS;
+
+
+ERR_VALUE paired_reads_init(PPAIRED_READS Paired, PONE_READ Reads, const size_t Count);
+void paired_reads_finit(PPAIRED_READS Paired);
+void paired_reads_fix_overlaps(const PAIRED_READS *Paired, boolean Strip);
+void paired_reads_print(FILE *Stream, const PAIRED_READS *Paired);
 
 
 
@@ -18,11 +18,13 @@
 		size_t AllocLength;								\
 		aDataType **Data;								\
 		size_t Ratio;									\
+		PUTILS_ARENA Arena;								\
 		aDataType *Storage[POINTER_ARRAY_STATIC_ALLOC];							\
 	} POINTER_ARRAY_TYPE(aDataType), *PPOINTER_ARRAY_##aDataType	\
 
 
 #define pointer_array_size(aArray)							((aArray)->ValidLength)
+#define pointer_array_set_arena(aArray, aArena)				((aArray)->Arena = (aArena))
 
 #define POINTER_ARRAY_IMPLEMENTATION(aDataType)									\
 	POINTER_ARRAY_ALLOC_FUNCTION(aDataType)										\
@@ -64,7 +66,7 @@
 #define POINTER_ARRAY_FINIT_FUNCTION(aDataType)												\
 	INLINE_FUNCTION void pointer_array_finit_##aDataType(POINTER_ARRAY_PTYPE(aDataType) Array)			\
 	{																					\
-		if (Array->AllocLength > 0 && Array->Data != Array->Storage)					\
+		if (Array->Arena == NULL && Array->AllocLength > 0 && Array->Data != Array->Storage)	\
 			utils_free(Array->Data);													\
 																						\
 		Array->Data = NULL;																\
@@ -80,10 +82,12 @@
 		if (Count <= Array->AllocLength)														\
 			return ERR_SUCCESS;																	\
 																								\
-		ret = pointer_array_alloc_data_##aDataType(Count, &newData);						\
+		if (Array->Arena != NULL)																\
+			ret = utils_arena_calloc(Array->Arena, Count, sizeof(aDataType*), (void **)&newData);	\
+		else ret = pointer_array_alloc_data_##aDataType(Count, &newData);					\
 		if (ret == ERR_SUCCESS) {																\
 			memcpy(newData, Array->Data, Array->ValidLength*sizeof(aDataType*));					\
-			if (Array->AllocLength > 0 && Array->Data != Array->Storage)						\
+			if (Array->Arena == NULL && Array->AllocLength > 0 && Array->Data != Array->Storage)	\
 				utils_free(Array->Data);														\
 																								\
 			Array->AllocLength = Count;															\
@@ -10,6 +10,7 @@
 #include "pointer_array.h"
 #include "khash.h"
 #include "variant-types.h"
+#include "paired-reads.h"
 
 
 typedef enum _EVariantGraphVertexColor {
@@ -93,7 +94,7 @@ typedef struct _VARIANT_GRAPH {
 
 ERR_VALUE vg_graph_init(PVARIANT_CALL Variants, const size_t VariantCount, size_t Threshold, PVARIANT_GRAPH Graph);
 void vg_graph_finit(PVARIANT_GRAPH Graph);
-ERR_VALUE vg_graph_add_paired(PVARIANT_GRAPH Graph);
+ERR_VALUE vg_graph_add_paired(PVARIANT_GRAPH Graph, const PAIRED_READS *Paired);
 ERR_VALUE vg_graph_color(PVARIANT_GRAPH Graph);
 void vg_graph_print(FILE *Stream, const VARIANT_GRAPH *Graph);
 void vg_graph_finalize(PVARIANT_GRAPH Graph);
@@ -62,6 +62,25 @@ GEN_ARRAY_IMPLEMENTATION(VARIANT_CALL)
 POINTER_ARRAY_TYPEDEF(VARIANT_CALL);
 POINTER_ARRAY_IMPLEMENTATION(VARIANT_CALL)
 
+/** Hash index of variant calls stored in an array.
+ *
+ *  Calls are identified by their chromosome, position, reference and alternate
+ *  parts (case insensitive, as in variant_call_equal()). The index stores positions
+ *  of the calls, so the array may be reallocated while the index is in use.
+ */
+typedef struct _VC_INDEX {
+	/** The indexed array. */
+	const GEN_ARRAY_VARIANT_CALL *Array;
+	/** Open-addressing table of array positions plus one, zero marks an empty slot. */
+	size_t *Slots;
+	/** Number of slots, always a power of two. */
+	size_t Size;
+	/** Number of indexed calls. */
+	size_t Count;
+	/** Number of leading calls of the array already looked at, see vc_index_update(). */
+	size_t Covered;
+} VC_INDEX, *PVC_INDEX;
+
 
 
 
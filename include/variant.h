@@ -15,14 +15,21 @@ ERR_VALUE variant_call_init(const char *Chrom, uint64_t Pos, const char *ID, con
 void variant_call_finit(PVARIANT_CALL VC);
 boolean variant_call_equal(const VARIANT_CALL *VC1, const VARIANT_CALL *VC2);
 ERR_VALUE vc_array_add(PGEN_ARRAY_VARIANT_CALL Array, const VARIANT_CALL *VC, PVARIANT_CALL *Existing);
+ERR_VALUE vc_array_add_indexed(PGEN_ARRAY_VARIANT_CALL Array, PVC_INDEX Index, const VARIANT_CALL *VC, PVARIANT_CALL *Existing);
 void vc_array_clear(PGEN_ARRAY_VARIANT_CALL Array);
 void vc_array_finit(PGEN_ARRAY_VARIANT_CALL Array);
 void vc_array_print(FILE *Stream, const char *ReferenceFile, const GEN_ARRAY_VARIANT_CALL *Array);
 void vc_array_sort(PGEN_ARRAY_VARIANT_CALL Array);
 ERR_VALUE vc_array_merge(PGEN_ARRAY_VARIANT_CALL Dest, PGEN_ARRAY_VARIANT_CALL Sources, const size_t SourceCount);
 void vc_array_map_to_edges(PGEN_ARRAY_VARIANT_CALL VCArray);
-ERR_VALUE vc_array_intersection(GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIANT_CALL *A2, PGEN_ARRAY_VARIANT_CALL Intersection);
+ERR_VALUE vc_array_intersection(GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIANT_CALL *A2, PGEN_ARRAY_VARIANT_CALL Intersection, PVC_INDEX IntersectionIndex);
 ERR_VALUE vc_array_union(const GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIANT_CALL *A2, PGEN_ARRAY_VARIANT_CALL Union);
 
+ERR_VALUE vc_index_init(const GEN_ARRAY_VARIANT_CALL *Array, const size_t CountHint, PVC_INDEX Index);
+void vc_index_finit(PVC_INDEX Index);
+ERR_VALUE vc_index_insert(PVC_INDEX Index, const size_t Position);
+ERR_VALUE vc_index_update(PVC_INDEX Index);
+ERR_VALUE vc_index_find(const VC_INDEX *Index, const VARIANT_CALL *VC, size_t *Position);
+
 
 #endif 
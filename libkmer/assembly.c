@@ -39,6 +39,7 @@ GEN_ARRAY_IMPLEMENTATION(DISTANCE_RECORD)
 
 UTILS_TYPED_CALLOC_FUNCTION(PPOINTER_ARRAY_KMER_VERTEX)
 UTILS_TYPED_CALLOC_FUNCTION(GEN_ARRAY_DISTANCE_RECORD)
+UTILS_TYPED_CALLOC_FUNCTION(READ_VIEW)
 
 
 /** @brief
@@ -129,7 +130,7 @@ static size_t _missing_edge_price(const PARSE_OPTIONS *Options, PKMER_GRAPH Grap
 	size_t ret = Options->MissingEdgePenalty;
 	const KMER_EDGE *e = NULL;
 
-	e = kmer_graph_get_edge(Graph, &Source->KMer, &Dest->KMer);
+	e = kmer_graph_get_edge(Graph, Source, Dest);
 	if (e != NULL) {
 		if (e->Type == kmetReference || read_info_weight(&e->ReadInfo, Graph->QualityTable) > 100*Options->ReadThreshold)
 			ret = 0;
@@ -277,8 +278,9 @@ static ERR_VALUE _find_best_path(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph
 			PKMER_VERTEX *tmpResult = NULL;
 
 			_helper_graph_build(Options, Graph, distances, rsVertexCount, Vertices, NumberOfVertices);
-			ret = utils_calloc_PKMER_VERTEX(NumberOfVertices, &tmpResult);
+			ret = kmer_graph_alloc(Graph, NumberOfVertices*sizeof(PKMER_VERTEX), (void **)&tmpResult);
 			if (ret == ERR_SUCCESS) {
+				memset(tmpResult, 0, NumberOfVertices*sizeof(PKMER_VERTEX));
 				_shortest_path(Vertices, NumberOfVertices, distances, rsVertexCount, tmpResult);
 				*Result = tmpResult;
 				*ResultLength = NumberOfVertices;
@@ -289,7 +291,7 @@ static ERR_VALUE _find_best_path(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph
 	} else {
 		PKMER_VERTEX *tmpResult = NULL;
 
-		ret = utils_calloc_PKMER_VERTEX(NumberOfVertices, &tmpResult);
+		ret = kmer_graph_alloc(Graph, NumberOfVertices*sizeof(PKMER_VERTEX), (void **)&tmpResult);
 		if (ret == ERR_SUCCESS) {
 			for (size_t i = 0; i < NumberOfVertices; ++i)
 				tmpResult[i] = Vertices[i]->Data[0];
@@ -329,7 +331,7 @@ static ERR_VALUE _assign_vertice_set_to_kmer(PKMER_GRAPH Graph, const KMER *KMer
 }
 
 
-static ERR_VALUE _assign_vertice_sets_to_kmers(PKMER_GRAPH Graph, const ONE_READ *Read, PPOINTER_ARRAY_KMER_VERTEX *Vertices, const size_t NumberOfSets, const PARSE_OPTIONS *Options, boolean *Linear)
+static ERR_VALUE _assign_vertice_sets_to_kmers(PKMER_GRAPH Graph, const READ_VIEW *Read, PPOINTER_ARRAY_KMER_VERTEX *Vertices, const size_t NumberOfSets, const PARSE_OPTIONS *Options, boolean *Linear)
 {
 	size_t count = 0;
 	PKMER kmer = NULL;
@@ -486,7 +488,7 @@ static ERR_VALUE _create_short_edge(PKMER_GRAPH Graph, PKMER_VERTEX U, PKMER_VER
 }
 
 
-static ERR_VALUE _create_long_edge(PKMER_GRAPH Graph, PKMER_VERTEX U, PKMER_VERTEX V, const size_t StartIndex, const size_t EndIndex, const ONE_READ *Read, const size_t ReadIndex, const EKMerEdgeType Type, PKMER_EDGE *NewEdge)
+static ERR_VALUE _create_long_edge(PKMER_GRAPH Graph, PKMER_VERTEX U, PKMER_VERTEX V, const size_t StartIndex, const size_t EndIndex, const READ_VIEW *Read, const size_t ReadIndex, const EKMerEdgeType Type, PKMER_EDGE *NewEdge)
 {
 	PKMER_EDGE e = NULL;
 	size_t rsLen = EndIndex - StartIndex - 1;
@@ -498,7 +500,7 @@ static ERR_VALUE _create_long_edge(PKMER_GRAPH Graph, PKMER_VERTEX U, PKMER_VERT
 	if (ret == ERR_SUCCESS) {
 		char *rs = NULL;
 
-		ret = utils_calloc_char(rsLen + 1, &rs);
+		ret = kmer_graph_alloc(Graph, (rsLen + 1)*sizeof(char), (void **)&rs);
 		if (ret == ERR_SUCCESS) {
 			memcpy(rs, Read->ReadSequence + StartIndex, rsLen*sizeof(char));
 			rs[rsLen] = '\0';
@@ -523,7 +525,7 @@ static ERR_VALUE _create_long_edge(PKMER_GRAPH Graph, PKMER_VERTEX U, PKMER_VERT
 }
 
 
-static ERR_VALUE _create_short_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Vertices, const size_t NumberOfVertices, const ONE_READ *Read, const size_t ReadIndex, PKMER_EDGE **EdgePath)
+static ERR_VALUE _create_short_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Vertices, const size_t NumberOfVertices, const READ_VIEW *Read, const size_t ReadIndex, PKMER_EDGE **EdgePath)
 {
 	PKMER_EDGE *tmpEdgePath = NULL;
 	const size_t kmerSize = kmer_graph_get_kmer_size(Graph);
@@ -532,7 +534,7 @@ static ERR_VALUE _create_short_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Verti
 
 	ret = ERR_SUCCESS;
 	if (NumberOfVertices > 1) {
-		ret = utils_calloc_PKMER_EDGE(NumberOfVertices - 1, &tmpEdgePath);
+		ret = kmer_graph_alloc(Graph, (NumberOfVertices - 1)*sizeof(PKMER_EDGE), (void **)&tmpEdgePath);
 		if (ret == ERR_SUCCESS) {
 			for (size_t i = 0; i < NumberOfVertices - 1; ++i) {
 				PKMER_VERTEX v = Vertices[i];
@@ -549,7 +551,7 @@ static ERR_VALUE _create_short_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Verti
 				*EdgePath = tmpEdgePath;
 
 			if (ret != ERR_SUCCESS)
-				utils_free(tmpEdgePath);
+				kmer_graph_free(Graph, tmpEdgePath);
 		}
 	}
 
@@ -578,7 +580,7 @@ static boolean _edge_pair_exists(const GEN_ARRAY_KMER_EDGE_PAIR *Array, const KM
 #define READ_EDGE_FLAG_LONG_END			0x2
 #define READ_EDGE_FLAG_LONG_REFSEQ		0x4
 
-static ERR_VALUE _mark_long_edge_flags(const PARSE_OPTIONS *Options, const PKMER_VERTEX *Vertices, const size_t NumberOfVertices, uint8_t **Flags)
+static ERR_VALUE _mark_long_edge_flags(const KMER_GRAPH *Graph, const PARSE_OPTIONS *Options, const PKMER_VERTEX *Vertices, const size_t NumberOfVertices, uint8_t **Flags)
 {
 	size_t edgeStartIndex = (size_t)-1;
 	uint8_t *tmpFlags = NULL;
@@ -586,7 +588,7 @@ static ERR_VALUE _mark_long_edge_flags(const PARSE_OPTIONS *Options, const PKMER
 
 	ret = ERR_SUCCESS;
 	if (NumberOfVertices >= 2) {
-		ret = utils_calloc_uint8_t(NumberOfVertices, &tmpFlags);
+		ret = kmer_graph_alloc(Graph, NumberOfVertices*sizeof(uint8_t), (void **)&tmpFlags);
 		if (ret == ERR_SUCCESS) {
 			memset(tmpFlags, 0, NumberOfVertices*sizeof(uint8_t));
 			for (size_t i = 0; i < NumberOfVertices - 1; ++i) {
@@ -638,7 +640,7 @@ static ERR_VALUE _mark_long_edge_flags(const PARSE_OPTIONS *Options, const PKMER
 			}
 
 			if (ret != ERR_SUCCESS)
-				utils_free(tmpFlags);
+				kmer_graph_free(Graph, tmpFlags);
 		}
 	}
 
@@ -662,7 +664,7 @@ static ERR_VALUE _mark_long_edge_flags(const PARSE_OPTIONS *Options, const PKMER
  *  @remark
  *  The LongFlags data are initialized by the _mark_long_edge_flags routine.
  */
-static ERR_VALUE _create_long_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Vertices, PKMER_EDGE *Edges, const uint8_t *LongFlags, const size_t NumberOfVertices, const ONE_READ *Read, const size_t ReadIndex, PGEN_ARRAY_KMER_EDGE_PAIR PairArray)
+static ERR_VALUE _create_long_read_edges(PKMER_GRAPH Graph, PKMER_VERTEX *Vertices, PKMER_EDGE *Edges, const uint8_t *LongFlags, const size_t NumberOfVertices, const READ_VIEW *Read, const size_t ReadIndex, PGEN_ARRAY_KMER_EDGE_PAIR PairArray)
 {
 	PKMER_EDGE e = NULL;
 	size_t readGapStart = (size_t)-1;
@@ -776,7 +778,7 @@ static ERR_VALUE _add_read_helper_vertices(PKMER_GRAPH Graph, PKMER_VERTEX **pVe
 					for (size_t i = 0; i < numberOfVertices - 1; ++i) {
 						PKMER_VERTEX u = pathVertices[i];
 						PKMER_VERTEX v = pathVertices[i + 1];
-						PKMER_EDGE e = kmer_graph_get_edge(Graph, &u->KMer, &v->KMer);
+						PKMER_EDGE e = kmer_graph_get_edge(Graph, u, v);
 
 						if (!u->Helper && !v->Helper) {
 							if (u->Type == kmvtRead && v->Type == kmvtRead) {
@@ -828,27 +830,39 @@ static ERR_VALUE _add_read_helper_vertices(PKMER_GRAPH Graph, PKMER_VERTEX **pVe
 					}
 
 					if (ret == ERR_SUCCESS) {
-						*pNumberOfVertices = pointer_array_size(&va);
-						utils_free(*pVertices);
-						*pVertices = va.Data;
-						utils_free(*pEdges);
-						*pEdges = ea.Data;
+						PKMER_VERTEX *vertices = NULL;
+						PKMER_EDGE *edges = NULL;
+
+						ret = kmer_graph_alloc(Graph, pointer_array_size(&va)*sizeof(PKMER_VERTEX), (void **)&vertices);
+						if (ret == ERR_SUCCESS) {
+							ret = kmer_graph_alloc(Graph, max(pointer_array_size(&ea), 1)*sizeof(PKMER_EDGE), (void **)&edges);
+							if (ret == ERR_SUCCESS) {
+								memcpy(vertices, va.Data, pointer_array_size(&va)*sizeof(PKMER_VERTEX));
+								memcpy(edges, ea.Data, pointer_array_size(&ea)*sizeof(PKMER_EDGE));
+								*pNumberOfVertices = pointer_array_size(&va);
+								kmer_graph_free(Graph, *pVertices);
+								*pVertices = vertices;
+								kmer_graph_free(Graph, *pEdges);
+								*pEdges = edges;
+							}
+
+							if (ret != ERR_SUCCESS)
+								kmer_graph_free(Graph, vertices);
+						}
 					}
 				}
 			}
 		}
 
-		if (ret != ERR_SUCCESS) {
-			pointer_array_finit_KMER_EDGE(&ea);
-			pointer_array_finit_KMER_VERTEX(&va);
-		}
+		pointer_array_finit_KMER_EDGE(&ea);
+		pointer_array_finit_KMER_VERTEX(&va);
 	}
 
 	return ret;
 }
 
 
-static ERR_VALUE _produce_single_path(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph, const ONE_READ *Read, const size_t MaxNumberOfSets, const boolean CreateDummyVertices, PKMER_VERTEX **Path, size_t *PathLength)
+static ERR_VALUE _produce_single_path(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph, const READ_VIEW *Read, const size_t MaxNumberOfSets, const boolean CreateDummyVertices, PKMER_VERTEX **Path, size_t *PathLength)
 {
 	boolean linear = FALSE;
 	PPOINTER_ARRAY_KMER_VERTEX *vertices = NULL;
@@ -867,7 +881,7 @@ static ERR_VALUE _produce_single_path(const PARSE_OPTIONS *Options, PKMER_GRAPH
 }
 
 
-static ERR_VALUE _kmer_graph_parse_read_v2(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph, const ONE_READ *Read, const size_t ReadIndex, PKMER_VERTEX **Path, size_t *PathLength, PKMER_EDGE **EdgePath)
+static ERR_VALUE _kmer_graph_parse_read_v2(const PARSE_OPTIONS *Options, PKMER_GRAPH Graph, const READ_VIEW *Read, const size_t ReadIndex, PKMER_VERTEX **Path, size_t *PathLength, PKMER_EDGE **EdgePath)
 {
 	const size_t kmerSize = kmer_graph_get_kmer_size(Graph);
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
@@ -895,6 +909,208 @@ static ERR_VALUE _kmer_graph_parse_read_v2(const PARSE_OPTIONS *Options, PKMER_G
 }
 
 
+/** Base of the rolling hash of the k-mers counted by the solid k-mer filter. */
+#define KMER_COUNTER_HASH_BASE				0x100000001B3ULL
+
+
+/** Occurrences of k-mers of the reads and the reference of a region. K-mers are
+ *  identified by their 64-bit rolling hashes, zero marks free slots.
+ */
+typedef struct _KMER_COUNTER {
+	uint64_t *Keys;
+	uint32_t *Counts;
+	size_t Size;
+	uint32_t KMerSize;
+	/** KMER_COUNTER_HASH_BASE to the power of KMerSize - 1. */
+	uint64_t OutWeight;
+} KMER_COUNTER, *PKMER_COUNTER;
+
+
+static ERR_VALUE _kmer_counter_init(PKMER_COUNTER Counter, const uint32_t KMerSize, const size_t ExpectedCount)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	Counter->KMerSize = KMerSize;
+	Counter->OutWeight = 1;
+	for (uint32_t i = 1; i < KMerSize; ++i)
+		Counter->OutWeight *= KMER_COUNTER_HASH_BASE;
+
+	Counter->Size = 16;
+	while (Counter->Size < 2 * ExpectedCount)
+		Counter->Size <<= 1;
+
+	ret = utils_calloc_uint64_t(Counter->Size, &Counter->Keys);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_uint32_t(Counter->Size, &Counter->Counts);
+		if (ret != ERR_SUCCESS)
+			utils_free(Counter->Keys);
+	}
+
+	return ret;
+}
+
+
+static void _kmer_counter_finit(PKMER_COUNTER Counter)
+{
+	utils_free(Counter->Counts);
+	utils_free(Counter->Keys);
+
+	return;
+}
+
+
+/** Returns the slot of a k-mer hash, or the free slot where it belongs. */
+static size_t _kmer_counter_slot(const KMER_COUNTER *Counter, uint64_t *Key)
+{
+	size_t ret = 0;
+
+	if (*Key == 0)
+		*Key = 1;
+
+	ret = (size_t)(((*Key ^ (*Key >> 29)) * 0x9E3779B97F4A7C15ULL) >> 7) & (Counter->Size - 1);
+	while (Counter->Keys[ret] != 0 && Counter->Keys[ret] != *Key)
+		ret = (ret + 1) & (Counter->Size - 1);
+
+	return ret;
+}
+
+
+/** Computes hashes of all k-mers of a sequence, Hashes must have room for Length - KMerSize + 1 of them. */
+static void _kmer_counter_hashes(const KMER_COUNTER *Counter, const char *Sequence, const size_t Length, uint64_t *Hashes)
+{
+	uint64_t h = 0;
+
+	for (size_t i = 0; i < Length; ++i) {
+		if (i >= Counter->KMerSize)
+			h -= (unsigned char)Sequence[i - Counter->KMerSize] * Counter->OutWeight;
+
+		h = h*KMER_COUNTER_HASH_BASE + (unsigned char)Sequence[i];
+		if (i + 1 >= Counter->KMerSize)
+			Hashes[i + 1 - Counter->KMerSize] = h;
+	}
+
+	return;
+}
+
+
+static void _kmer_counter_add(PKMER_COUNTER Counter, const char *Sequence, const size_t Length, const uint32_t Increment, uint64_t *Hashes)
+{
+	if (Length >= Counter->KMerSize) {
+		_kmer_counter_hashes(Counter, Sequence, Length, Hashes);
+		for (size_t i = 0; i + Counter->KMerSize <= Length; ++i) {
+			const size_t slot = _kmer_counter_slot(Counter, Hashes + i);
+
+			Counter->Keys[slot] = Hashes[i];
+			if (Counter->Counts[slot] < UINT32_MAX - Increment)
+				Counter->Counts[slot] += Increment;
+		}
+	}
+
+	return;
+}
+
+
+/** @brief
+ *  Trims a read to its longest run of k-mers occurring at least Threshold times.
+ *
+ *  @remark
+ *  The trimmed view shares bases and qualities with the read. If the read has
+ *  no solid k-mer, the view gets too short to be parsed.
+ */
+static void _solid_read_view(const KMER_COUNTER *Counter, const READ_VIEW *Read, const uint32_t Threshold, uint64_t *Hashes, PREAD_VIEW Result)
+{
+	const uint32_t k = Counter->KMerSize;
+	size_t bestStart = 0;
+	size_t bestLength = 0;
+	size_t runStart = 0;
+
+	*Result = *Read;
+	if (Read->ReadSequenceLen >= k) {
+		const size_t kmerCount = Read->ReadSequenceLen - k + 1;
+
+		_kmer_counter_hashes(Counter, Read->ReadSequence, Read->ReadSequenceLen, Hashes);
+		for (size_t i = 0; i <= kmerCount; ++i) {
+			boolean solid = FALSE;
+
+			if (i < kmerCount) {
+				const size_t slot = _kmer_counter_slot(Counter, Hashes + i);
+
+				solid = (Counter->Counts[slot] >= Threshold);
+			}
+
+			if (!solid) {
+				if (i - runStart > bestLength) {
+					bestStart = runStart;
+					bestLength = i - runStart;
+				}
+
+				runStart = i + 1;
+			}
+		}
+
+		Result->ReadSequence += bestStart;
+		Result->Quality += bestStart;
+		Result->Offset += (uint32_t)bestStart;
+		Result->RegionPos += (uint32_t)bestStart;
+		Result->ReadSequenceLen = (bestLength > 0) ? (uint32_t)(bestLength + k - 1) : 0;
+	}
+
+	return;
+}
+
+
+/** Reads the assembly works with, trimmed to their solid k-mers if the filter is on. */
+static const READ_VIEW *_state_reads(const ASSEMBLY_STATE *State)
+{
+	return (State->SolidReads != NULL) ? State->SolidReads : State->Reads;
+}
+
+
+/** @brief
+ *  Trims the reads to their solid k-mers, so k-mers occurring too few times in the
+ *  region never become vertices.
+ *
+ *  @remark
+ *  K-mers of the reference count as solid, they are already in the graph. Alternative
+ *  k-mers of a variant supported by few reads may fall below the threshold, so the
+ *  filter can drop calls of variants with low coverage.
+ */
+static ERR_VALUE _solid_reads_compute(PASSEMBLY_STATE State)
+{
+	KMER_COUNTER counter;
+	uint64_t *hashes = NULL;
+	size_t kmerCount = State->ParseOptions.RegionLength;
+	size_t maxLength = State->ParseOptions.RegionLength;
+	const uint32_t threshold = State->ParseOptions.SolidKMerThreshold;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	for (size_t i = 0; i < State->ReadCount; ++i) {
+		kmerCount += State->Reads[i].ReadSequenceLen;
+		maxLength = max(maxLength, State->Reads[i].ReadSequenceLen);
+	}
+
+	ret = _kmer_counter_init(&counter, kmer_graph_get_kmer_size(State->Graph), kmerCount);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_uint64_t(maxLength + 1, &hashes);
+		if (ret == ERR_SUCCESS) {
+			_kmer_counter_add(&counter, State->ParseOptions.Reference, State->ParseOptions.RegionLength, threshold, hashes);
+			for (size_t i = 0; i < State->ReadCount; ++i)
+				_kmer_counter_add(&counter, State->Reads[i].ReadSequence, State->Reads[i].ReadSequenceLen, 1, hashes);
+
+			for (size_t i = 0; i < State->ReadCount; ++i)
+				_solid_read_view(&counter, State->Reads + i, threshold, hashes, State->SolidReads + i);
+
+			utils_free(hashes);
+		}
+
+		_kmer_counter_finit(&counter);
+	}
+
+	return ret;
+}
+
+
+
 /************************************************************************/
 /*                      PUBLIC FUNCTIONS                                */
 /************************************************************************/
@@ -994,25 +1210,32 @@ ERR_VALUE assembly_parse_reference(PASSEMBLY_STATE State)
 ERR_VALUE assembly_parse_reads(PASSEMBLY_STATE State)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	PONE_READ currentRead = NULL;
+	const READ_VIEW *currentRead = NULL;
 	PKMER_GRAPH Graph = State->Graph;
 	const size_t kmerSize = kmer_graph_get_kmer_size(Graph);
 	const PARSE_OPTIONS *Options = &State->ParseOptions;
 	const size_t ReadCount = State->ReadCount;
-	PONE_READ Reads = State->Reads;
+	const READ_VIEW *Reads = NULL;
 	PKMER_VERTEX **paths = State->Paths;
 	PKMER_EDGE **edgePaths = State->EdgePaths;
 	uint8_t **flagPaths = State->FlagPaths;
 	size_t *pathLengths = State->PathLengths;
 
-//	_sort_reads(Graph, Reads, ReadCount);
-	currentRead = Reads;
-	for (size_t i = 0; i < ReadCount; ++i) {
-		ret = _kmer_graph_parse_read_v2(Options, Graph, currentRead, currentRead->ReadIndex, paths + i, pathLengths + i, edgePaths + i);
-		if (ret != ERR_SUCCESS)
-			break;
-						
-		++currentRead;
+	ret = ERR_SUCCESS;
+	if (State->SolidReads != NULL)
+		ret = _solid_reads_compute(State);
+
+	if (ret == ERR_SUCCESS) {
+		Reads = _state_reads(State);
+//		_sort_reads(Graph, Reads, ReadCount);
+		currentRead = Reads;
+		for (size_t i = 0; i < ReadCount; ++i) {
+			ret = _kmer_graph_parse_read_v2(Options, Graph, currentRead, currentRead->ReadIndex, paths + i, pathLengths + i, edgePaths + i);
+			if (ret != ERR_SUCCESS)
+				break;
+
+			++currentRead;
+		}
 	}
 
 	return ret;
@@ -1022,7 +1245,7 @@ ERR_VALUE assembly_parse_reads(PASSEMBLY_STATE State)
 ERR_VALUE assembly_add_helper_vertices(PASSEMBLY_STATE State)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	PONE_READ currentRead;
+	const READ_VIEW *currentRead;
 	const size_t ReadCount = State->ReadCount;
 	PKMER_GRAPH Graph = State->Graph;
 	PKMER_VERTEX **paths = State->Paths;
@@ -1030,7 +1253,7 @@ ERR_VALUE assembly_add_helper_vertices(PASSEMBLY_STATE State)
 	size_t *pathLengths = State->PathLengths;
 
 	if (State->ParseOptions.HelperVertices) {
-		currentRead = State->Reads;
+		currentRead = _state_reads(State);
 		for (size_t i = 0; i < ReadCount; ++i) {
 			ret = _add_read_helper_vertices(Graph, paths + i, edgePaths + i, pathLengths + i);
 			if (ret != ERR_SUCCESS)
@@ -1047,7 +1270,7 @@ ERR_VALUE assembly_add_helper_vertices(PASSEMBLY_STATE State)
 ERR_VALUE assembly_create_long_edges(PASSEMBLY_STATE State, PGEN_ARRAY_KMER_EDGE_PAIR PairArray)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	PONE_READ currentRead;
+	const READ_VIEW *currentRead;
 	const size_t ReadCount = State->ReadCount;
 	PKMER_GRAPH Graph = State->Graph;
 	PKMER_VERTEX **paths = State->Paths;
@@ -1055,9 +1278,9 @@ ERR_VALUE assembly_create_long_edges(PASSEMBLY_STATE State, PGEN_ARRAY_KMER_EDGE
 	size_t *pathLengths = State->PathLengths;
 	uint8_t **flagPaths = State->FlagPaths;
 
-	currentRead = State->Reads;
+	currentRead = _state_reads(State);
 	for (size_t i = 0; i < ReadCount; ++i) {
-		ret = _mark_long_edge_flags(&State->ParseOptions, paths[i], pathLengths[i], flagPaths + i);
+		ret = _mark_long_edge_flags(Graph, &State->ParseOptions, paths[i], pathLengths[i], flagPaths + i);
 		if (ret != ERR_SUCCESS)
 			break;
 
@@ -1065,7 +1288,7 @@ ERR_VALUE assembly_create_long_edges(PASSEMBLY_STATE State, PGEN_ARRAY_KMER_EDGE
 	}
 
 	if (ret == ERR_SUCCESS) {
-		currentRead = State->Reads;
+		currentRead = _state_reads(State);
 		for (size_t i = 0; i < ReadCount; ++i) {
 			ret = _create_long_read_edges(Graph, paths[i], edgePaths[i], flagPaths[i], pathLengths[i], currentRead, currentRead->ReadIndex, PairArray);
 			if (ret != ERR_SUCCESS)
@@ -1111,7 +1334,7 @@ ERR_VALUE assembly_variants_to_edges(PASSEMBLY_STATE State, const GEN_ARRAY_VARI
 
 
 
-ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptions, PONE_READ Reads, size_t ReadCount, PASSEMBLY_STATE State)
+ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptions, const READ_VIEW *Reads, size_t ReadCount, PASSEMBLY_STATE State)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
@@ -1133,6 +1356,13 @@ ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptio
 						State->EdgePaths[i] = NULL;
 						State->FlagPaths[i] = NULL;
 					}
+
+					State->SolidReads = NULL;
+					if (ParseOptions->SolidKMerThreshold > 0)
+						ret = utils_calloc_READ_VIEW(max(ReadCount, 1), &State->SolidReads);
+
+					if (ret != ERR_SUCCESS)
+						utils_free(State->FlagPaths);
 				}
 
 				if (ret != ERR_SUCCESS) {
@@ -1163,28 +1393,48 @@ ERR_VALUE assembly_state_init(PKMER_GRAPH Graph, const PARSE_OPTIONS *ParseOptio
 }
 
 
-void assembly_state_finit(PASSEMBLY_STATE State)
+/** @brief
+ *  Releases paths of the reads through the graph, so the reads can be parsed again.
+ *
+ *  @param State The assembly state.
+ *
+ *  @remark
+ *  Arrays indexed by the reads are kept. Call this before the graph is reset,
+ *  the paths live in the graph memory.
+ */
+void assembly_state_reset(PASSEMBLY_STATE State)
 {
+	const KMER_GRAPH *g = State->Graph;
 
 	for (size_t i = 0; i < State->ReadCount; ++i) {
 		if (State->FlagPaths[i] != NULL)
-			utils_free(State->FlagPaths[i]);
-	}
+			kmer_graph_free(g, State->FlagPaths[i]);
 
-	utils_free(State->FlagPaths);
-	for (size_t i = 0; i < State->ReadCount; ++i) {
 		if (State->EdgePaths[i] != NULL)
-			utils_free(State->EdgePaths[i]);
-	}
+			kmer_graph_free(g, State->EdgePaths[i]);
 
-	utils_free(State->EdgePaths);
-	utils_free(State->PathLengths);
-
-	for (size_t i = 0; i < State->ReadCount; ++i) {
 		if (State->Paths[i] != NULL)
-			utils_free(State->Paths[i]);
+			kmer_graph_free(g, State->Paths[i]);
+
+		State->FlagPaths[i] = NULL;
+		State->EdgePaths[i] = NULL;
+		State->Paths[i] = NULL;
+		State->PathLengths[i] = 0;
 	}
 
+	return;
+}
+
+
+void assembly_state_finit(PASSEMBLY_STATE State)
+{
+	assembly_state_reset(State);
+	if (State->SolidReads != NULL)
+		utils_free(State->SolidReads);
+
+	utils_free(State->FlagPaths);
+	utils_free(State->EdgePaths);
+	utils_free(State->PathLengths);
 	utils_free(State->Paths);
 
 	return;
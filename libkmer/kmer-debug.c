@@ -70,7 +70,7 @@ size_t kmer_debug_hash(const uint32_t Context, const KMER_DEBUG *KMer)
 	const uint32_t kmerSize = (uint32_t)Context;
 
 	assert(kmerSize == kmer_debug_get_size(KMer));
-	for (size_t i = 0 + 1; i < kmerSize; ++i)
+	for (size_t i = 0; i < kmerSize; ++i)
 		hash = (hash << 5) - hash + kmer_debug_get_base(Context, KMer, i);
 
 	return hash;
@@ -21,26 +21,14 @@
 UTILS_TYPED_MALLOC_FUNCTION(KMER_EDGE_TABLE)
 
 
-INLINE_FUNCTION boolean _kmer_edge_key_equal(const uint32_t KMerSize, const KMER_EDGE_TABLE_KEY Key1, const KMER_EDGE_TABLE_KEY Key2)
-{
-	return (
-		kmer_get_number(Key1.Source) == kmer_get_number(Key2.Source) &&
-		kmer_get_number(Key1.Dest) == kmer_get_number(Key2.Dest) &&
-		kmer_seq_equal(KMerSize, Key1.Source, Key2.Source) &&
-		kmer_seq_equal(KMerSize, Key1.Dest, Key2.Dest)
-		);
-}
+#define _kmer_edge_key_equal(aKMerSize, aKey1, aKey2)		((aKey1) == (aKey2))
 
 
-INLINE_FUNCTION size_t _kmer_edge_key_hash(const uint32_t KMerSize, const KMER_EDGE_TABLE_KEY Key)
+INLINE_FUNCTION khint_t _kmer_edge_key_hash(const uint32_t KMerSize, const KMER_EDGE_TABLE_KEY Key)
 {
-	size_t hash1 = kmer_get_number(Key.Source);
-	size_t hash2 = kmer_get_number(Key.Dest);
+	const uint64_t h = Key * 0x9E3779B97F4A7C15ULL;
 
-	hash1 = kmer_hash(KMerSize, Key.Source);
-	hash2 = kmer_hash(KMerSize, Key.Dest);
-
-	return (((kmer_get_number(Key.Source) + 1)*hash1 << 1) + (kmer_get_number(Key.Dest) + 1)*hash2);
+	return (khint_t)(h >> 32);
 }
 
 
@@ -107,9 +95,11 @@ ERR_VALUE kmer_edge_table_create(const uint32_t KMerSize, const size_t Size, con
 
 void kmer_edge_table_destroy(PKMER_EDGE_TABLE Table)
 {	
-	for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
-		if (kh_exist(Table->KHashTable, it))
-			Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
+	if (Table->Callbacks.OnDelete != NULL) {
+		for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
+			if (kh_exist(Table->KHashTable, it))
+				Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
+		}
 	}
 
 	kh_destroy(edgeTable, Table->KHashTable);
@@ -119,14 +109,39 @@ void kmer_edge_table_destroy(PKMER_EDGE_TABLE Table)
 }
 
 
-void *kmer_edge_table_get(const struct _KMER_EDGE_TABLE *Table, const struct _KMER *Source, const struct _KMER *Dest)
+/** @brief
+ *  Removes all items from the table, keeping its buckets for the next use.
+ *
+ *  @param Table The table to reset.
+ *  @param KMerSize Size of k-mers of the graph the table is used with from now on.
+ *
+ *  @remark
+ *  The OnDelete callback is invoked for every item.
+ */
+void kmer_edge_table_reset(PKMER_EDGE_TABLE Table, const uint32_t KMerSize)
+{
+	if (Table->Callbacks.OnDelete != NULL) {
+		for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
+			if (kh_exist(Table->KHashTable, it))
+				Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
+		}
+	}
+
+	kh_clear(edgeTable, Table->KHashTable);
+	Table->KMerSize = KMerSize;
+	Table->KHashTable->Context = KMerSize;
+	Table->LastOrder = 0;
+
+	return;
+}
+
+
+void *kmer_edge_table_get(const struct _KMER_EDGE_TABLE *Table, const uint32_t SourceId, const uint32_t DestId)
 {
 	khiter_t it;
 	void *ret = NULL;
-	KMER_EDGE_TABLE_KEY key;
+	const KMER_EDGE_TABLE_KEY key = kmer_edge_table_key(SourceId, DestId);
 
-	key.Source = Source;
-	key.Dest = Dest;
 	it = kh_get(edgeTable, Table->KHashTable, key);
 	if (it != kh_end(Table->KHashTable))
 		ret = kh_val(Table->KHashTable, it);
@@ -135,14 +150,12 @@ void *kmer_edge_table_get(const struct _KMER_EDGE_TABLE *Table, const struct _KM
 }
 
 
-ERR_VALUE kmer_edge_table_delete(PKMER_EDGE_TABLE Table, const PKMER Source, const PKMER Dest)
+ERR_VALUE kmer_edge_table_delete(PKMER_EDGE_TABLE Table, const uint32_t SourceId, const uint32_t DestId)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 	khiter_t it;
-	KMER_EDGE_TABLE_KEY key;
+	const KMER_EDGE_TABLE_KEY key = kmer_edge_table_key(SourceId, DestId);
 
-	key.Source = Source;
-	key.Dest = Dest;
 	it = kh_get(edgeTable, Table->KHashTable, key);
 	if (it != kh_end(Table->KHashTable)) {
 		Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
@@ -154,15 +167,13 @@ ERR_VALUE kmer_edge_table_delete(PKMER_EDGE_TABLE Table, const PKMER Source, con
 }
 
 
-ERR_VALUE kmer_edge_table_insert(PKMER_EDGE_TABLE Table, const KMER *Source, const KMER *Dest, void *Data)
+ERR_VALUE kmer_edge_table_insert(PKMER_EDGE_TABLE Table, const uint32_t SourceId, const uint32_t DestId, void *Data)
 {
 	int r;
 	khiter_t it;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	KMER_EDGE_TABLE_KEY key;
+	const KMER_EDGE_TABLE_KEY key = kmer_edge_table_key(SourceId, DestId);
 
-	key.Source = Source;
-	key.Dest = Dest;
 	it = kh_put(edgeTable, Table->KHashTable, key, &r);
 	switch (r) {
 		case 0:
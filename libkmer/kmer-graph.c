@@ -7,7 +7,6 @@
 #include <math.h>
 #include "err.h"
 #include "utils.h"
-#include "khash.h"
 #include "kmer.h"
 #include "kmer-table.h"
 #include "kmer-edge.h"
@@ -28,6 +27,8 @@
 UTILS_TYPED_MALLOC_FUNCTION(KMER_GRAPH)
 UTILS_TYPED_MALLOC_FUNCTION(KMER_VERTEX)
 UTILS_TYPED_MALLOC_FUNCTION(KMER_EDGE)
+UTILS_TYPED_CALLOC_FUNCTION(KMER_FROZEN_VERTEX)
+UTILS_TYPED_CALLOC_FUNCTION(KMER_FROZEN_EDGE)
 
 /************************************************************************/
 /*                        VERTEX BASIC ROUTINES                         */
@@ -37,7 +38,7 @@ static PKMER_VERTEX _default_vertex_allocator(struct _KMER_GRAPH *Graph, void *C
 {
 	PKMER_VERTEX ret = NULL;
 
-	utils_malloc(KMER_BYTES_EXTRA(kmer_graph_get_kmer_size(Graph), sizeof(KMER_VERTEX)), &ret);
+	kmer_graph_alloc(Graph, KMER_BYTES_EXTRA(kmer_graph_get_kmer_size(Graph), sizeof(KMER_VERTEX)), (void **)&ret);
 
 	return ret;
 }
@@ -45,7 +46,7 @@ static PKMER_VERTEX _default_vertex_allocator(struct _KMER_GRAPH *Graph, void *C
 
 static void _default_vertex_freer(struct _KMER_GRAPH *Graph, PKMER_VERTEX Vertex, void *Context)
 {
-	utils_free(Vertex);
+	kmer_graph_free(Graph, Vertex);
 
 	return;
 }
@@ -55,7 +56,7 @@ static PKMER_EDGE _default_edge_allocator(struct _KMER_GRAPH *Graph, void *Conte
 {
 	PKMER_EDGE ret = NULL;
 
-	utils_malloc(sizeof(KMER_EDGE), &ret);
+	kmer_graph_alloc(Graph, sizeof(KMER_EDGE), (void **)&ret);
 
 	return ret;
 }
@@ -63,7 +64,7 @@ static PKMER_EDGE _default_edge_allocator(struct _KMER_GRAPH *Graph, void *Conte
 
 static void _default_edge_freer(struct _KMER_GRAPH *Graph, PKMER_EDGE Edge, void *Context)
 {
-	utils_free(Edge);
+	kmer_graph_free(Graph, Edge);
 
 	return;
 }
@@ -87,6 +88,9 @@ static ERR_VALUE _vertex_create(PKMER_GRAPH Graph, const KMER *KMer, const EKMer
 
 	tmp = Graph->Allocator.VertexAllocator(Graph, Graph->Allocator.VertexAllocatorContext);
 	if (tmp != NULL) {
+		tmp->Id = Graph->NextVertexId;
+		++Graph->NextVertexId;
+		tmp->DirtyIndex = 0;
 		tmp->RefEdge = NULL;
 		tmp->RefVarEdge = NULL;
 		tmp->Unique = TRUE;
@@ -97,7 +101,9 @@ static ERR_VALUE _vertex_create(PKMER_GRAPH Graph, const KMER *KMer, const EKMer
 		tmp->Helper = FALSE;
 		tmp->ShortVariant = FALSE;
 		pointer_array_init_KMER_EDGE(&tmp->Successors, 140);
+		pointer_array_set_arena(&tmp->Successors, Graph->Allocator.Arena);
 		pointer_array_init_KMER_EDGE(&tmp->Predecessors, 140);
+		pointer_array_set_arena(&tmp->Predecessors, Graph->Allocator.Arena);
 		tmp->RefSeqPosition = 0;
 		tmp->AbsPos = 0;
 		tmp->Lists.Next = NULL;
@@ -136,6 +142,42 @@ static void _vertex_destroy(PKMER_GRAPH Graph, PKMER_VERTEX Vertex)
 }
 
 
+/** @brief
+ *  Adds a vertex to the list of vertices kmer_graph_delete_trailing_things()
+ *  needs to look at.
+ *
+ *  @remark
+ *  When the list cannot grow, the next pass visits all vertices instead.
+ */
+static void _vertex_mark_dirty(PKMER_GRAPH Graph, PKMER_VERTEX Vertex)
+{
+	if (Vertex->DirtyIndex == 0) {
+		if (pointer_array_push_back_KMER_VERTEX(&Graph->DirtyVertices, Vertex) == ERR_SUCCESS)
+			Vertex->DirtyIndex = (uint32_t)pointer_array_size(&Graph->DirtyVertices);
+		else Graph->DirtyVerticesLost = TRUE;
+	}
+
+	return;
+}
+
+
+static void _vertex_unmark_dirty(PKMER_GRAPH Graph, PKMER_VERTEX Vertex)
+{
+	if (Vertex->DirtyIndex > 0) {
+		PKMER_VERTEX last = *pointer_array_pop_back_KMER_VERTEX(&Graph->DirtyVertices);
+
+		if (last != Vertex) {
+			Graph->DirtyVertices.Data[Vertex->DirtyIndex - 1] = last;
+			last->DirtyIndex = Vertex->DirtyIndex;
+		}
+
+		Vertex->DirtyIndex = 0;
+	}
+
+	return;
+}
+
+
 static ERR_VALUE _vertex_copy(PKMER_GRAPH Graph, const KMER_VERTEX *Vertex, PKMER_VERTEX *Result)
 {
 	PKMER_VERTEX tmp = NULL;
@@ -144,12 +186,11 @@ static ERR_VALUE _vertex_copy(PKMER_GRAPH Graph, const KMER_VERTEX *Vertex, PKME
 	ret = _vertex_create(Graph, &Vertex->KMer, Vertex->Type, &tmp);
 	if (ret == ERR_SUCCESS) {
 		tmp->Helper = Vertex->Helper;
+		tmp->Id = Vertex->Id;
 		tmp->Order = Vertex->Order;
 		tmp->Lists.Graph = Vertex->Lists.Graph;
-		pointer_array_init_KMER_EDGE(&tmp->Successors, 140);
 		ret = pointer_array_clean_copy_KMER_EDGE(&tmp->Successors, &Vertex->Successors);
 		if (ret == ERR_SUCCESS) {
-			pointer_array_init_KMER_EDGE(&tmp->Predecessors, 140);
 			ret = pointer_array_clean_copy_KMER_EDGE(&tmp->Predecessors, &Vertex->Predecessors);
 			if (ret == ERR_SUCCESS)
 				*Result = tmp;
@@ -188,6 +229,8 @@ static ERR_VALUE _edge_create(PKMER_GRAPH Graph, PKMER_VERTEX Source, PKMER_VERT
 	if (tmp != NULL) {
 		tmp->Source = Source;
 		tmp->Dest = Dest;
+		tmp->Id = Graph->NextEdgeId;
+		++Graph->NextEdgeId;
 		tmp->Type = Type;
 		tmp->Order = 0;
 		tmp->Seq = NULL;
@@ -195,13 +238,17 @@ static ERR_VALUE _edge_create(PKMER_GRAPH Graph, PKMER_VERTEX Source, PKMER_VERT
 		tmp->Seq1Weight = 0;
 		tmp->SeqType = kmetNone;
 		read_info_init(&tmp->ReadInfo);
+		gen_array_set_arena(&tmp->ReadInfo.Array, Graph->Allocator.Arena);
 		tmp->MarkedForDelete = FALSE;
 		pointer_array_init_VARIANT_CALL(&tmp->VCs, 140);
+		pointer_array_set_arena(&tmp->VCs, Graph->Allocator.Arena);
 		tmp->LongData.LongEdge = FALSE;
 		tmp->LongData.RefSeqEnd = 0;
 		tmp->LongData.RefSeqStart = 0;
 		dym_array_init_size_t(&tmp->Weights, 140);
+		gen_array_set_arena(&tmp->Weights, Graph->Allocator.Arena);
 		pointer_array_init_READ_INFO(&tmp->ReadIndices, 140);
+		pointer_array_set_arena(&tmp->ReadIndices, Graph->Allocator.Arena);
 		*Edge = tmp;
 		ret = ERR_SUCCESS;
 	} else ret = ERR_OUT_OF_MEMORY;
@@ -225,7 +272,7 @@ static void _edge_destroy(PKMER_GRAPH Graph, PKMER_EDGE Edge)
 		PREAD_INFO ri = Edge->ReadIndices.Data[i];
 
 		read_info_finit(ri);
-		utils_free(ri);
+		kmer_graph_free(Graph, ri);
 	}
 
 	pointer_array_finit_READ_INFO(&Edge->ReadIndices);
@@ -233,7 +280,7 @@ static void _edge_destroy(PKMER_GRAPH Graph, PKMER_EDGE Edge)
 	pointer_array_finit_VARIANT_CALL(&Edge->VCs);
 	read_info_finit(&Edge->ReadInfo);
 	if (Edge->Seq != NULL)
-		utils_free((void *)Edge->Seq);
+		kmer_graph_free(Graph, (void *)Edge->Seq);
 
 	Graph->Allocator.EdgeFreer(Graph, Edge, Graph->Allocator.EdgeAllocatorContext);
 
@@ -260,6 +307,7 @@ static void _vertex_table_on_delete(struct _KMER_TABLE *Table, void *ItemData, v
 	PKMER_GRAPH g = (PKMER_GRAPH)Context;
 	PKMER_VERTEX v = (PKMER_VERTEX)ItemData;
 
+	_vertex_unmark_dirty(g, v);
 	_vertex_destroy(g, v);
 
 	return;
@@ -316,10 +364,11 @@ static void _kmerlist_table_on_insert(struct _KMER_TABLE *Table, void *ItemData,
 
 static void _kmerlist_table_on_delete(struct _KMER_TABLE *Table, void *ItemData, void *Context)
 {
+	PKMER_GRAPH g = (PKMER_GRAPH)Context;
 	PKMER_LIST l = (PKMER_LIST)ItemData;
 
 	pointer_array_finit_KMER_VERTEX(&l->Vertices);
-	utils_free(l);
+	kmer_graph_free(g, l);
 
 	return;
 }
@@ -556,8 +605,12 @@ static ERR_VALUE _capture_edge_sequence(const KMER_GRAPH *Graph, const KMER_EDGE
 			lastVertex->Type != kmvtRefSeqEnd)
 			rs_storage_remove(&rsStorage, 1);
 
-		ret = rs_storage_create_string(&rsStorage, Seq);
-		*SeqLen = rsStorage.ValidLength;
+		ret = kmer_graph_alloc(Graph, (rsStorage.ValidLength + 1)*sizeof(char), (void **)Seq);
+		if (ret == ERR_SUCCESS) {
+			memcpy(*Seq, rsStorage.Sequence, rsStorage.ValidLength*sizeof(char));
+			(*Seq)[rsStorage.ValidLength] = '\0';
+			*SeqLen = rsStorage.ValidLength;
+		}
 	}
 
 	rs_storage_finit(&rsStorage);
@@ -591,8 +644,11 @@ ERR_VALUE kmer_graph_create(const uint32_t KMerSize, const size_t VerticesHint,
 		tmpGraph->Allocator.EdgeFreer = _default_edge_freer;
 		tmpGraph->Allocator.VertexAllocatorContext = NULL;
 		tmpGraph->Allocator.EdgeAllocatorContext = NULL;
+		tmpGraph->Allocator.Arena = NULL;
 		tmpGraph->NumberOfEdges = 0;
 		tmpGraph->NumberOfVertices = 0;
+		tmpGraph->NextVertexId = 0;
+		tmpGraph->NextEdgeId = 0;
 		tmpGraph->KMerSize = KMerSize;
 		tmpGraph->StartingVertex = NULL;
 		tmpGraph->EndingVertex = NULL;
@@ -612,7 +668,7 @@ ERR_VALUE kmer_graph_create(const uint32_t KMerSize, const size_t VerticesHint,
 			if (ret == ERR_SUCCESS) {
 				ret = kmer_edge_table_create(KMerSize, 47, NULL, &tmpGraph->DummyVertices);
 				if (ret == ERR_SUCCESS) {
-					lCallbacks.Context = Graph;
+					lCallbacks.Context = tmpGraph;
 					lCallbacks.OnCopy = NULL;
 					lCallbacks.OnDelete = _kmerlist_table_on_delete;
 					lCallbacks.OnInsert = _kmerlist_table_on_insert;
@@ -620,6 +676,7 @@ ERR_VALUE kmer_graph_create(const uint32_t KMerSize, const size_t VerticesHint,
 					ret = kmer_table_create(KMerSize, 37, &lCallbacks, &tmpGraph->KmerListTable);
 					if (ret == ERR_SUCCESS) {
 						pointer_array_init_KMER_VERTEX(&tmpGraph->RefVertices, 140);
+						pointer_array_init_KMER_VERTEX(&tmpGraph->DirtyVertices, 140);
 						*Graph = tmpGraph;
 					}
 
@@ -650,9 +707,19 @@ ERR_VALUE kmer_graph_create(const uint32_t KMerSize, const size_t VerticesHint,
  *
  *  @remark
  *  The graph may be in any state.
+ *  When the graph memory comes from an arena, its vertices and edges are not
+ *  visited at all, the caller resets the arena (and the vertex and edge allocators)
+ *  instead.
  */
 void kmer_graph_destroy(PKMER_GRAPH Graph)
 {
+	if (Graph->Allocator.Arena != NULL) {
+		Graph->KmerListTable->Callbacks.OnDelete = NULL;
+		Graph->EdgeTable->Callbacks.OnDelete = NULL;
+		Graph->VertexTable->Callbacks.OnDelete = NULL;
+		Graph->VerticesToDeleteList = NULL;
+	}
+
 	pointer_array_finit_KMER_VERTEX(&Graph->RefVertices);
 	kmer_table_destroy(Graph->KmerListTable);
 	kmer_edge_table_destroy(Graph->DummyVertices);
@@ -669,12 +736,113 @@ void kmer_graph_destroy(PKMER_GRAPH Graph)
 		_vertex_destroy(Graph, old);
 	}
 
+	pointer_array_finit_KMER_VERTEX(&Graph->DirtyVertices);
 	utils_free(Graph);
 
 	return;
 }
 
 
+/** @brief
+ *  Removes all vertices and edges of a graph and prepares it for a different
+ *  k-mer size.
+ *
+ *  @param Graph The graph to reset.
+ *  @param KMerSize The new k-mer size.
+ *
+ *  @remark
+ *  The hash tables keep their capacity and the allocator stays attached, so
+ *  the graph can be built again without allocating everything from scratch.
+ *  As with kmer_graph_destroy(), the caller resets the arena (and the vertex
+ *  and edge allocators) when the graph memory comes from one.
+ */
+ERR_VALUE kmer_graph_reset(PKMER_GRAPH Graph, const uint32_t KMerSize)
+{
+	KMER_TABLE_ON_DELETE_CALLBACK *listOnDelete = Graph->KmerListTable->Callbacks.OnDelete;
+	KMER_EDGE_TABLE_ON_DELETE_CALLBACK *edgeOnDelete = Graph->EdgeTable->Callbacks.OnDelete;
+	KMER_TABLE_ON_DELETE_CALLBACK *vertexOnDelete = Graph->VertexTable->Callbacks.OnDelete;
+	ERR_VALUE vertexRet = ERR_INTERNAL_ERROR;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Graph->Allocator.Arena != NULL) {
+		Graph->KmerListTable->Callbacks.OnDelete = NULL;
+		Graph->EdgeTable->Callbacks.OnDelete = NULL;
+		Graph->VertexTable->Callbacks.OnDelete = NULL;
+		Graph->VerticesToDeleteList = NULL;
+	}
+
+	pointer_array_clear_KMER_VERTEX(&Graph->RefVertices);
+	ret = kmer_table_reset(Graph->KmerListTable, KMerSize);
+	kmer_edge_table_reset(Graph->DummyVertices, KMerSize);
+	kmer_edge_table_reset(Graph->EdgeTable, KMerSize);
+	vertexRet = kmer_table_reset(Graph->VertexTable, KMerSize);
+	pointer_array_clear_KMER_VERTEX(&Graph->DirtyVertices);
+	Graph->DirtyVerticesLost = FALSE;
+	if (ret == ERR_SUCCESS)
+		ret = vertexRet;
+
+	Graph->KmerListTable->Callbacks.OnDelete = listOnDelete;
+	Graph->EdgeTable->Callbacks.OnDelete = edgeOnDelete;
+	Graph->VertexTable->Callbacks.OnDelete = vertexOnDelete;
+
+	PKMER_VERTEX del = Graph->VerticesToDeleteList;
+	PKMER_VERTEX old = Graph->VerticesToDeleteList;
+
+	while (del != NULL) {
+		old = del;
+		del = del->Lists.Next;
+		old->Lists.Graph = NULL;
+		_vertex_destroy(Graph, old);
+	}
+
+	Graph->VerticesToDeleteList = NULL;
+	Graph->KMerSize = KMerSize;
+	Graph->NumberOfVertices = 0;
+	Graph->NumberOfEdges = 0;
+	Graph->NextVertexId = 0;
+	Graph->NextEdgeId = 0;
+	memset(Graph->TypedEdgeCount, 0, sizeof(Graph->TypedEdgeCount));
+	Graph->StartingVertex = NULL;
+	Graph->EndingVertex = NULL;
+	Graph->DeleteEdgeCallback = NULL;
+	Graph->DeleteEdgeCallbackContext = NULL;
+
+	return ret;
+}
+
+
+/** @brief
+ *  Allocates memory owned by the graph.
+ *
+ *  @param Graph The graph.
+ *  @param Size Size of the block, in bytes.
+ *  @param Address Receives address of the block.
+ *
+ *  @remark
+ *  If the graph has an arena, the block is taken from it and released by resetting
+ *  the arena after the graph is destroyed. Otherwise, the heap is used.
+ */
+ERR_VALUE kmer_graph_alloc(const KMER_GRAPH *Graph, const size_t Size, void **Address)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Graph->Allocator.Arena != NULL)
+		ret = utils_arena_alloc(Graph->Allocator.Arena, Size, Address);
+	else ret = utils_malloc(Size, Address);
+
+	return ret;
+}
+
+
+void kmer_graph_free(const KMER_GRAPH *Graph, void *Address)
+{
+	if (Graph->Allocator.Arena == NULL)
+		utils_free(Address);
+
+	return;
+}
+
+
 /** @brief
  *  Prints the graph in format suitable for dot (Graphwiz).
  *
@@ -818,6 +986,11 @@ void kmer_graph_set_ending_vertex(PKMER_GRAPH Graph, const KMER *KMer)
  *
  *  @param Graph The graph.
  *  @param DeletedThings Receives the number of deleted edges.
+ *
+ *  @remark
+ *  The search starts from the dirty vertex list only, since every vertex
+ *  without incoming or outgoing edges has been put there when it was added
+ *  or when it lost its last edge.
  */
 void kmer_graph_delete_trailing_things(PKMER_GRAPH Graph, size_t *DeletedThings)
 {
@@ -828,16 +1001,34 @@ void kmer_graph_delete_trailing_things(PKMER_GRAPH Graph, size_t *DeletedThings)
 	PKMER_EDGE e = NULL;
 
 	pointer_array_init_KMER_VERTEX(&stack, 140);
-	ret = kmer_table_first(Graph->VertexTable, &iter, (void **)&v);
-	while (ret == ERR_SUCCESS) {
-		if (v->Type != kmvtRefSeqStart && v->Type != kmvtRefSeqEnd) {
-			if (kmer_vertex_in_degree(v) == 0 ||
-				kmer_vertex_out_degree(v) == 0) {
-				ret = pointer_array_push_back_KMER_VERTEX(&stack, v);
+	if (Graph->DirtyVerticesLost) {
+		while (pointer_array_size(&Graph->DirtyVertices) > 0)
+			(*pointer_array_pop_back_KMER_VERTEX(&Graph->DirtyVertices))->DirtyIndex = 0;
+
+		Graph->DirtyVerticesLost = FALSE;
+		ret = kmer_table_first(Graph->VertexTable, &iter, (void **)&v);
+		while (ret == ERR_SUCCESS) {
+			if (v->Type != kmvtRefSeqStart && v->Type != kmvtRefSeqEnd) {
+				if (kmer_vertex_in_degree(v) == 0 ||
+					kmer_vertex_out_degree(v) == 0) {
+					ret = pointer_array_push_back_KMER_VERTEX(&stack, v);
+				}
 			}
-		}
 
-		ret = kmer_table_next(Graph->VertexTable, iter, &iter, (void **)&v);
+			ret = kmer_table_next(Graph->VertexTable, iter, &iter, (void **)&v);
+		}
+	} else {
+		// Only vertices that lost edges since the last pass may be dead-ends
+		while (pointer_array_size(&Graph->DirtyVertices) > 0) {
+			v = *pointer_array_pop_back_KMER_VERTEX(&Graph->DirtyVertices);
+			v->DirtyIndex = 0;
+			if (v->Type != kmvtRefSeqStart && v->Type != kmvtRefSeqEnd) {
+				if (kmer_vertex_in_degree(v) == 0 ||
+					kmer_vertex_out_degree(v) == 0) {
+					ret = pointer_array_push_back_KMER_VERTEX(&stack, v);
+				}
+			}
+		}
 	}
 
 	while (pointer_array_size(&stack) > 0) {
@@ -903,13 +1094,14 @@ ERR_VALUE kmer_graph_add_vertex_ex(PKMER_GRAPH Graph, const KMER *KMer, const EK
 				kmer_set_number(lk, 0);
 				list = (PKMER_LIST)kmer_table_get(Graph->KmerListTable, lk);
 				if (list == NULL) {
-					ret = utils_malloc(sizeof(KMER_LIST) + kmer_graph_get_kmer_size(Graph)*sizeof(char), &list);
+					ret = kmer_graph_alloc(Graph, KMER_BYTES_EXTRA(kmer_graph_get_kmer_size(Graph), sizeof(KMER_LIST)), (void **)&list);
 					if (ret == ERR_SUCCESS) {
 						pointer_array_init_KMER_VERTEX(&list->Vertices, 140);
+						pointer_array_set_arena(&list->Vertices, Graph->Allocator.Arena);
 						kmer_init_from_kmer(&list->Kmer, kmer_graph_get_kmer_size(Graph), lk);
 						ret = kmer_table_insert(Graph->KmerListTable, &list->Kmer, list);
 						if (ret != ERR_SUCCESS)
-							utils_free(list);
+							kmer_graph_free(Graph, list);
 					}
 				}
 				
@@ -920,6 +1112,7 @@ ERR_VALUE kmer_graph_add_vertex_ex(PKMER_GRAPH Graph, const KMER *KMer, const EK
 				if (ret == ERR_SUCCESS) {
 					Graph->NumberOfVertices++;
 					v->Lists.Graph = Graph;
+					_vertex_mark_dirty(Graph, v);
 					*Vertex = v;
 				}
 
@@ -940,12 +1133,12 @@ ERR_VALUE kmer_graph_add_vertex_ex(PKMER_GRAPH Graph, const KMER *KMer, const EK
 
 
 /** @brief
- *  Inserts a helper vertex into the graph. K-mers defining the edge the new vertex
+ *  Inserts a helper vertex into the graph. Vertices defining the edge the new vertex
  *  should divide need to be given.
  *
  *  @param Graph
- *  @param KMer1 k-mer represented by the edge source.
- *  @param KMer2 k-mer represented by the edge destination.
+ *  @param Source The edge source.
+ *  @param Dest The edge destination.
  *  @param Vertex Receives either the new, or existing helper vertex.
  *
  *  @return
@@ -956,7 +1149,7 @@ ERR_VALUE kmer_graph_add_vertex_ex(PKMER_GRAPH Graph, const KMER *KMer, const EK
  *  The routine does not divide the target edge. The target edge actually may be non-existent
  *  at a time the routine is called. The vertex is just added into the table of helper vertices.
  */
-ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER *KMer1, const KMER *KMer2, PKMER_VERTEX *Vertex)
+ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER_VERTEX *Source, const KMER_VERTEX *Dest, PKMER_VERTEX *Vertex)
 {
 	PKMER_VERTEX v = NULL;
 	const uint32_t kmerSize = kmer_graph_get_kmer_size(Graph);
@@ -967,7 +1160,7 @@ ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER *KMer1, con
 	ret = ERR_SUCCESS;
 	memset(dummySeq, 'D', kmerSize*sizeof(char));
 	KMER_STACK_ALLOC(kmer, 0, kmerSize, dummySeq);
-	v = (PKMER_VERTEX)kmer_edge_table_get(Graph->DummyVertices, KMer1, KMer2);
+	v = (PKMER_VERTEX)kmer_edge_table_get(Graph->DummyVertices, Source->Id, Dest->Id);
 	if (v == NULL) {
 		do {
 			ret = kmer_graph_add_vertex_ex(Graph, kmer, kmvtRead, &v);
@@ -977,7 +1170,7 @@ ERR_VALUE kmer_graph_add_helper_vertex(PKMER_GRAPH Graph, const KMER *KMer1, con
 	
 		if (ret == ERR_SUCCESS) {
 			v->Helper = TRUE;
-			ret = kmer_edge_table_insert(Graph->DummyVertices, KMer1, KMer2, v);
+			ret = kmer_edge_table_insert(Graph->DummyVertices, Source->Id, Dest->Id, v);
 			if (ret == ERR_SUCCESS)
 				*Vertex = v;
 
@@ -1012,11 +1205,11 @@ ERR_VALUE kmer_graph_add_edge_ex(PKMER_GRAPH Graph, PKMER_VERTEX Source, PKMER_V
 	PKMER_EDGE edge = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	edge = (PKMER_EDGE)kmer_edge_table_get(Graph->EdgeTable, &Source->KMer, &Dest->KMer);
+	edge = (PKMER_EDGE)kmer_edge_table_get(Graph->EdgeTable, Source->Id, Dest->Id);
 	if (edge == NULL) {
 		ret = _edge_create(Graph, Source, Dest, Type, &edge);
 		if (ret == ERR_SUCCESS) {
-			ret = kmer_edge_table_insert(Graph->EdgeTable, &Source->KMer, &Dest->KMer, edge);
+			ret = kmer_edge_table_insert(Graph->EdgeTable, Source->Id, Dest->Id, edge);
 			if (ret == ERR_SUCCESS) {
 				ret = pointer_array_reserve_KMER_EDGE(&Source->Successors, pointer_array_size(&Source->Successors) + 1);
 				if (ret == ERR_SUCCESS) {
@@ -1044,19 +1237,19 @@ ERR_VALUE kmer_graph_add_edge_ex(PKMER_GRAPH Graph, PKMER_VERTEX Source, PKMER_V
 
 
 /** @brief
- *  Retrieves an edge, given k-mers represented by its source and destination vertices.
+ *  Retrieves an edge, given its source and destination vertices.
  *
  *  @param Graph
- *  @param Source K-mer representing the source vertex.
- *  @param Dest K-mer representing the destination vertex.
+ *  @param Source The source vertex.
+ *  @param Dest The destination vertex.
  *
  *  @return
- *  Returns the edge connecting the source and destination k-mers. If no such
+ *  Returns the edge connecting the source and destination vertices. If no such
  *  edge exists, NULL is returned.
  */
-PKMER_EDGE kmer_graph_get_edge(const struct _KMER_GRAPH *Graph, const struct _KMER *Source, const struct _KMER *Dest)
+PKMER_EDGE kmer_graph_get_edge(const struct _KMER_GRAPH *Graph, const struct _KMER_VERTEX *Source, const struct _KMER_VERTEX *Dest)
 {
-	return (PKMER_EDGE)kmer_edge_table_get(Graph->EdgeTable, Source, Dest);
+	return (PKMER_EDGE)kmer_edge_table_get(Graph->EdgeTable, Source->Id, Dest->Id);
 }
 
 
@@ -1171,7 +1364,7 @@ void kmer_graph_delete_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge)
 	if (Graph->DeleteEdgeCallback != NULL)
 		Graph->DeleteEdgeCallback(Graph, Edge, Graph->DeleteEdgeCallbackContext);
 
-	err = kmer_edge_table_delete(Graph->EdgeTable, &source->KMer, &dest->KMer);
+	err = kmer_edge_table_delete(Graph->EdgeTable, source->Id, dest->Id);
 	if (err == ERR_SUCCESS) {
 		if (source->RefEdge == Edge)
 			source->RefEdge = NULL;
@@ -1181,6 +1374,12 @@ void kmer_graph_delete_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge)
 
 		pointer_array_remove_by_item_fast_KMER_EDGE(&source->Successors, Edge);
 		pointer_array_remove_by_item_fast_KMER_EDGE(&dest->Predecessors, Edge);
+		if (kmer_vertex_out_degree(source) == 0)
+			_vertex_mark_dirty(Graph, source);
+
+		if (kmer_vertex_in_degree(dest) == 0)
+			_vertex_mark_dirty(Graph, dest);
+
 		--Graph->TypedEdgeCount[edgeType];
 		--Graph->NumberOfEdges;
 	}
@@ -1212,7 +1411,7 @@ ERR_VALUE kmer_graph_merge_edges(PKMER_GRAPH Graph, PKMER_EDGE Source, PKMER_EDG
 	v = Source->Dest;
 	w = Dest->Dest;
 	if (v == Dest->Source && u != w) {
-		if (kmer_graph_get_edge(Graph, &u->KMer, &w->KMer) == NULL) {
+		if (kmer_graph_get_edge(Graph, u, w) == NULL) {
 			boolean mfd = (Source->MarkedForDelete || Dest->MarkedForDelete);
 			EKMerEdgeType type = (Source->Type == kmetReference && Dest->Type == kmetReference) ? kmetReference : kmetRead;
 			PKMER_EDGE newEdge = NULL;
@@ -1274,10 +1473,10 @@ ERR_VALUE kmer_graph_get_splitted_edge(PKMER_GRAPH Graph, const KMER_VERTEX *Sou
 	PKMER_EDGE es = NULL;
 	PKMER_EDGE ed = NULL;
 
-	helperVertex = (PKMER_VERTEX)kmer_edge_table_get(Graph->DummyVertices, &Source->KMer, &Dest->KMer);
+	helperVertex = (PKMER_VERTEX)kmer_edge_table_get(Graph->DummyVertices, Source->Id, Dest->Id);
 	if (helperVertex != NULL) {
-		es = kmer_graph_get_edge(Graph, &Source->KMer, &helperVertex->KMer);
-		ed = kmer_graph_get_edge(Graph, &helperVertex->KMer, &Dest->KMer);
+		es = kmer_graph_get_edge(Graph, Source, helperVertex);
+		ed = kmer_graph_get_edge(Graph, helperVertex, Dest);
 		ret = ERR_SUCCESS;
 		if (SplitVertex != NULL)
 			*SplitVertex = helperVertex;
@@ -1314,7 +1513,7 @@ ERR_VALUE kmer_graph_split_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge, PKMER_EDGE *
 	PKMER_VERTEX helperVertex = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	ret = kmer_graph_add_helper_vertex(Graph, &Edge->Source->KMer, &Edge->Dest->KMer, &helperVertex);
+	ret = kmer_graph_add_helper_vertex(Graph, Edge->Source, Edge->Dest, &helperVertex);
 	if (ret == ERR_SUCCESS) {
 		ret = kmer_graph_add_edge_ex(Graph, Edge->Source, helperVertex, Edge->Type, &es);
 		if (ret == ERR_SUCCESS) {
@@ -1328,7 +1527,7 @@ ERR_VALUE kmer_graph_split_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge, PKMER_EDGE *
 				size_t seqLen = Edge->SeqLen;
 
 				if (seqLen > 0) {
-					ret = utils_calloc_char(seqLen + 1, &seq);
+					ret = kmer_graph_alloc(Graph, (seqLen + 1)*sizeof(char), (void **)&seq);
 					if (ret == ERR_SUCCESS) {
 						memcpy(seq, Edge->Seq, seqLen*sizeof(char));
 						seq[seqLen] = '\0';
@@ -1372,10 +1571,10 @@ ERR_VALUE kmer_graph_split_edge(PKMER_GRAPH Graph, PKMER_EDGE Edge, PKMER_EDGE *
 			*SplitVertex = helperVertex;
 
 		if (SourceEdge != NULL)
-			*SourceEdge = kmer_graph_get_edge(Graph, &Edge->Source->KMer, &helperVertex->KMer);
+			*SourceEdge = kmer_graph_get_edge(Graph, Edge->Source, helperVertex);
 
 		if (DestEdge != NULL)
-			*DestEdge = kmer_graph_get_edge(Graph, &helperVertex->KMer, &Edge->Dest->KMer);
+			*DestEdge = kmer_graph_get_edge(Graph, helperVertex, Edge->Dest);
 	}
 
 	assert(*SourceEdge != NULL);
@@ -1554,7 +1753,7 @@ ERR_VALUE kmer_graph_connect_reads_by_pairs(PKMER_GRAPH Graph, const size_t Thre
 						
 						ret = ERR_SUCCESS;
 					} else if (ret == ERR_SUCCESS) {
-						PKMER_EDGE e = kmer_graph_get_edge(Graph, &eIn->Source->KMer, &eOut->Dest->KMer);
+						PKMER_EDGE e = kmer_graph_get_edge(Graph, eIn->Source, eOut->Dest);
 
 						if (e != NULL)
 							kmer_graph_delete_edge(Graph, e);
@@ -1632,13 +1831,11 @@ ERR_VALUE kmer_graph_connect_reads_by_pairs(PKMER_GRAPH Graph, const size_t Thre
 }
 
 
-KHASH_SET_INIT_INT(es);
-
-
 /** @brief
  *  Given a starting edge for an alternate sequence and a reference vertex, performs a DFS to
  *  find a path from that starting edge to that vertex, covered only by read vertices.
  *
+ *  @param Frozen Read-only snapshot of the graph.
  *  @param Start The starting edge.
  *  @param RefDest The target reference vertex.
  *  @param Edges The recorded path.
@@ -1646,91 +1843,106 @@ KHASH_SET_INIT_INT(es);
  *  @remark
  *  The routine is capable of detecting loops.
  *  The recored path is than used as an alternate sequence for variant calling.
+ *  The search walks only the CSR arrays of the snapshot, visited edges are marked
+ *  in its @EdgeMarks array that is cleared again before returning.
  */
-static ERR_VALUE _capture_alternate_edges(const KMER_EDGE *Start, const KMER_VERTEX *RefDest, PPOINTER_ARRAY_KMER_EDGE Edges)
+static ERR_VALUE _capture_alternate_edges(PKMER_GRAPH_FROZEN Frozen, const KMER_EDGE *Start, const KMER_VERTEX *RefDest, PPOINTER_ARRAY_KMER_EDGE Edges)
 {
-	int r;
-	PKMER_EDGE e = NULL;
+	uint32_t e = 0;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	khash_t(es)	*table = kh_init(es);
-	const KMER_VERTEX *destVertex = Start->Dest;
+	uint8_t *marks = Frozen->EdgeMarks;
+	const KMER_FROZEN_EDGE *fes = Frozen->Edges;
+	const KMER_FROZEN_VERTEX *fvs = Frozen->Vertices;
+	const uint32_t refDest = kmer_frozen_vertex_index(Frozen, RefDest);
+	uint32_t destVertex = 0;
 	GEN_ARRAY_size_t indices;
+	GEN_ARRAY_uint32_t path;
 
 	dym_array_init_size_t(&indices, 140);
-	pointer_array_push_back_KMER_EDGE(Edges, Start);
+	dym_array_init_uint32_t(&path, 140);
+	e = kmer_frozen_edge_index(Frozen, Start);
+	destVertex = fes[e].Dest;
+	dym_array_push_back_uint32_t(&path, e);
 	do {
 		ret = ERR_SUCCESS;
-		while (kmer_vertex_out_degree(destVertex) == 1 && destVertex->Type == kmvtRead) {
-			e = kmer_vertex_get_succ_edge(destVertex, 0);
-			if (kh_get(es, table, e->Order) != kh_end(table)) {
+		while (kmer_frozen_vertex_out_degree(Frozen, destVertex) == 1 && fvs[destVertex].Type == kmvtRead) {
+			e = kmer_frozen_succ_edge_index(Frozen, destVertex, 0);
+			if (marks[e]) {
 				ret = ERR_ALREADY_EXISTS;
 				break;
 			}
 
-			destVertex = e->Dest;
-			pointer_array_push_back_KMER_EDGE(Edges, e);
-			kh_put(es, table, e->Order, &r);
+			destVertex = fes[e].Dest;
+			dym_array_push_back_uint32_t(&path, e);
+			marks[e] = 1;
 		}
 
-		if (destVertex == RefDest) {
+		if (destVertex == refDest) {
 			ret = ERR_SUCCESS;
 			break;
-		} else if (ret == ERR_ALREADY_EXISTS || destVertex->Type == kmvtRefSeqMiddle) {
+		} else if (ret == ERR_ALREADY_EXISTS || fvs[destVertex].Type == kmvtRefSeqMiddle) {
 			size_t index = 0;
 			
-			while (pointer_array_size(&indices) > 0) {
-				khiter_t it;
-
+			while (gen_array_size(&indices) > 0) {
 				index = *dym_array_pop_back_size_t(&indices);
-				e = *pointer_array_pop_back_KMER_EDGE(Edges);
-				it = kh_get(es, table, e->Order);
-				kh_del(es, table, it);
-				while (pointer_array_size(Edges) > 1 && kmer_vertex_out_degree(e->Source) == 1) {					
-					e = *pointer_array_pop_back_KMER_EDGE(Edges);
-					it = kh_get(es, table, e->Order);
-					kh_del(es, table, it);
+				e = *dym_array_pop_back_uint32_t(&path);
+				marks[e] = 0;
+				while (gen_array_size(&path) > 1 && kmer_frozen_vertex_out_degree(Frozen, fes[e].Source) == 1) {					
+					e = *dym_array_pop_back_uint32_t(&path);
+					marks[e] = 0;
 				}
 
-				if (kmer_vertex_out_degree(e->Source) > index + 1) {
+				if (kmer_frozen_vertex_out_degree(Frozen, fes[e].Source) > index + 1) {
 					++index;
-					e = kmer_vertex_get_succ_edge(e->Source, index);
-					while (kh_get(es, table, e->Order) != kh_end(table) &&
-						kmer_vertex_out_degree(e->Source) > index + 1) {
+					e = kmer_frozen_succ_edge_index(Frozen, fes[e].Source, index);
+					while (marks[e] &&
+						kmer_frozen_vertex_out_degree(Frozen, fes[e].Source) > index + 1) {
 						++index;
-						e = kmer_vertex_get_succ_edge(e->Source, index);
+						e = kmer_frozen_succ_edge_index(Frozen, fes[e].Source, index);
 					}
 
-					if (kh_get(es, table, e->Order) == kh_end(table) &&
-						kmer_vertex_out_degree(e->Source) > index) {
-						pointer_array_push_back_KMER_EDGE(Edges, e);
+					if (!marks[e] &&
+						kmer_frozen_vertex_out_degree(Frozen, fes[e].Source) > index) {
+						dym_array_push_back_uint32_t(&path, e);
 						dym_array_push_back_size_t(&indices, index);
-						destVertex = e->Dest;
-						kh_put(es, table, e->Order, &r);
+						destVertex = fes[e].Dest;
+						marks[e] = 1;
 						break;
 					}
 				}
 			}
 
-			if (pointer_array_size(&indices) == 0) {
+			if (gen_array_size(&indices) == 0) {
 				ret = ERR_TOO_COMPLEX;
 				break;
 			}
 		} else {
-			e = kmer_vertex_get_succ_edge(destVertex, 0);
-			pointer_array_push_back_KMER_EDGE(Edges, e);
+			e = kmer_frozen_succ_edge_index(Frozen, destVertex, 0);
+			dym_array_push_back_uint32_t(&path, e);
 			dym_array_push_back_size_t(&indices, 0);
-			destVertex = e->Dest;
-			if (kh_get(es, table, e->Order) != kh_end(table)) {
+			destVertex = fes[e].Dest;
+			if (marks[e]) {
 				ret = ERR_ALREADY_EXISTS;
 				break;
 			}
 
-			kh_put(es, table, e->Order, &r);
+			marks[e] = 1;
 		}
 	} while (TRUE);
 
+	for (size_t i = 0; i < gen_array_size(&path); ++i)
+		marks[path.Data[i]] = 0;
+
+	if (ret == ERR_SUCCESS) {
+		ret = pointer_array_reserve_KMER_EDGE(Edges, pointer_array_size(Edges) + gen_array_size(&path));
+		if (ret == ERR_SUCCESS) {
+			for (size_t i = 0; i < gen_array_size(&path); ++i)
+				pointer_array_push_back_no_alloc_KMER_EDGE(Edges, fes[path.Data[i]].Edge);
+		}
+	}
+
+	dym_array_finit_uint32_t(&path);
 	dym_array_finit_size_t(&indices);
-	kh_destroy(es, table);
 	if (ret != ERR_SUCCESS)
 		pointer_array_clear_KMER_EDGE(Edges);
 
@@ -2018,6 +2230,8 @@ static ERR_VALUE _create_variants(const uint32_t KMerSize, const char *Chrom, ui
 ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL VCArray, const char *CHrom, const PARSE_OPTIONS *Options, boolean *Changed)
 {
 	boolean edgeCreated = FALSE;
+	boolean frozenValid = FALSE;
+	KMER_GRAPH_FROZEN frozen;
 	REFSEQ_STORAGE s1;
 	REFSEQ_STORAGE s2;
 	GEN_ARRAY_size_t w1;
@@ -2031,6 +2245,7 @@ ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL V
 	POINTER_ARRAY_KMER_EDGE es2;
 
 	ret = ERR_SUCCESS;
+	memset(&frozen, 0, sizeof(frozen));
 	pointer_array_init_KMER_EDGE(&es1, 140);
 	pointer_array_init_KMER_EDGE(&es2, 140);
 	rs_storage_init(&s1, kmer_graph_get_kmer_size(Graph));
@@ -2083,14 +2298,21 @@ ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL V
 					rs_storage_remove(&s1, 1);
 
 				{
-					khash_t(es)	*table = kh_init(es);
-
 					pointer_array_clear_KMER_EDGE(&es2);
 					pointer_array_clear_READ_INFO(&rp2);
 					dym_array_clear_size_t(&w2);
 					rs_storage_reset(&s2);
 					rs_storage_add_vertex(&s2, path2Start->Source);
-					ret = _capture_alternate_edges(path2Start, path1Vertex, &es2);
+					if (!frozenValid) {
+						kmer_graph_frozen_finit(&frozen);
+						ret = kmer_graph_freeze(Graph, &frozen);
+						if (ret != ERR_SUCCESS)
+							break;
+
+						frozenValid = TRUE;
+					}
+
+					ret = _capture_alternate_edges(&frozen, path2Start, path1Vertex, &es2);
 					if (ret == ERR_SUCCESS) {
 						size_t narrowCount = 0;
 						size_t disperseCount = 0;
@@ -2129,22 +2351,32 @@ ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL V
 					ret = ERR_SUCCESS;
 					if (path2Vertex != NULL && path2Vertex->Type == kmvtRefSeqMiddle && !path2Vertex->Helper)
 						rs_storage_remove(&s2, 1);
-
-					kh_destroy(es, table);
 				}
 
 				if (path2Vertex != NULL && path2Vertex->Type == kmvtRefSeqMiddle) {
 					if (ret == ERR_SUCCESS && path1Vertex == path2Vertex) {
-						PKMER_EDGE e = kmer_graph_get_edge(Graph, &v->KMer, &path1Vertex->KMer);
+						PKMER_EDGE e = kmer_graph_get_edge(Graph, v, path1Vertex);
 
 						if (e == NULL || e == path1Start || e == path2Start) {
 							for (size_t i = 0; i < pointer_array_size(&es1); ++i)
 								pointer_array_clear_READ_INFO(&(es1.Data[i]->ReadIndices));
 							
 							_create_variants(kmer_graph_get_kmer_size(Graph), CHrom, v->AbsPos, s1.Sequence, s1.ValidLength, s2.Sequence, s2.ValidLength, &w1, &w2, &rp1, &rp2, NULL, Options, VCArray);
+							// Keep the snapshot in sync instead of building it again
+							if (frozenValid && kmer_graph_frozen_delete_edge(&frozen, path1Start) != ERR_SUCCESS)
+								frozenValid = FALSE;
+
 							kmer_graph_delete_edge(Graph, path1Start);
+							if (frozenValid && kmer_graph_frozen_delete_edge(&frozen, path2Start) != ERR_SUCCESS)
+								frozenValid = FALSE;
+
 							kmer_graph_delete_edge(Graph, path2Start);
+
 							ret = kmer_graph_add_edge_ex(Graph, v, path1Vertex, kmetVariant, &e);
+							if (ret == ERR_SUCCESS && frozenValid &&
+								kmer_graph_frozen_add_edge(&frozen, e) != ERR_SUCCESS)
+								frozenValid = FALSE;
+
 							if (ret == ERR_SUCCESS) {
 								char *tmpSeq = NULL;
 
@@ -2152,8 +2384,10 @@ ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL V
 								v->RefVarEdge = e;
 								v = _get_refseq_or_variant_edge(path1Vertex)->Dest;
 								edgeCreated = TRUE;
-								ret = rs_storage_create_string_with_offset(&s1, 1, &tmpSeq);
+								ret = kmer_graph_alloc(Graph, s1.ValidLength*sizeof(char), (void **)&tmpSeq);
 								if (ret == ERR_SUCCESS) {
+									memcpy(tmpSeq, s1.Sequence + 1, (s1.ValidLength - 1)*sizeof(char));
+									tmpSeq[s1.ValidLength - 1] = '\0';
 									kmer_edge_add_seq(e, kmetReference, tmpSeq, s1.ValidLength - 1);
 									e->Seq1Weight = weight1;
 									ret = dym_array_push_back_array_size_t(&e->Weights,  &w1);
@@ -2186,6 +2420,7 @@ ERR_VALUE kmer_graph_detect_variant(PKMER_GRAPH Graph, PGEN_ARRAY_VARIANT_CALL V
 	}
 
 	size_t dummy = 0;
+	kmer_graph_frozen_finit(&frozen);
 	pointer_array_finit_READ_INFO(&rp2);
 	pointer_array_finit_READ_INFO(&rp1);
 	dym_array_finit_size_t(&w2);
@@ -2228,9 +2463,10 @@ ERR_VALUE kmer_graph_compute_weights(PKMER_GRAPH Graph)
 					for (size_t i = 0; i < wLen; ++i) {
 						PREAD_INFO ri = NULL;
 
-						ret = utils_malloc(sizeof(READ_INFO), &ri);
+						ret = kmer_graph_alloc(Graph, sizeof(READ_INFO), (void **)&ri);
 						if (ret == ERR_SUCCESS) {
 							read_info_init(ri);
+							gen_array_set_arena(&ri->Array, Graph->Allocator.Arena);
 							pointer_array_push_back_no_alloc_READ_INFO(&e->ReadIndices, ri);
 							ret = read_info_assign(ri, &e->ReadInfo.Array);
 						}
@@ -2255,3 +2491,220 @@ ERR_VALUE kmer_edge_add_read(PKMER_EDGE Edge, size_t ReadIndex, size_t ReadPosit
 
 	return ret;
 }
+
+
+/************************************************************************/
+/*                      FROZEN GRAPH                                    */
+/************************************************************************/
+
+
+/** @brief
+ *  Builds a snapshot of the graph adjacency in the CSR form.
+ *
+ *  @param Graph The graph to freeze.
+ *  @param Frozen Structure to fill. Must be released by kmer_graph_frozen_finit().
+ *
+ *  @remark
+ *  The snapshot refers to the vertices and edges of the graph. It must be
+ *  rebuilt after each change of the graph structure that is not repeated
+ *  on the snapshot itself.
+ */
+ERR_VALUE kmer_graph_freeze(const KMER_GRAPH *Graph, PKMER_GRAPH_FROZEN Frozen)
+{
+	void *iter = NULL;
+	PKMER_VERTEX v = NULL;
+	uint32_t vertexCount = 0;
+	uint32_t edgeCount = 0;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Frozen, 0, sizeof(KMER_GRAPH_FROZEN));
+	ret = kmer_table_first(Graph->VertexTable, &iter, (void **)&v);
+	while (ret == ERR_SUCCESS) {
+		++vertexCount;
+		edgeCount += (uint32_t)kmer_vertex_out_degree(v);
+		ret = kmer_table_next(Graph->VertexTable, iter, &iter, (void **)&v);
+	}
+
+	ret = utils_calloc_KMER_FROZEN_VERTEX(vertexCount + 1, &Frozen->Vertices);
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_KMER_FROZEN_EDGE(edgeCount + 1, &Frozen->Edges);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint32_t(vertexCount + 1, &Frozen->SuccOffsets);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint32_t(vertexCount + 1, &Frozen->SuccCounts);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint32_t(Graph->NextVertexId + 1, &Frozen->IdToIndex);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint32_t(Graph->NextEdgeId + 1, &Frozen->EdgeIdToIndex);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint8_t(edgeCount + 1, &Frozen->EdgeMarks);
+
+	if (ret == ERR_SUCCESS) {
+		uint32_t index = 0;
+		uint32_t offset = 0;
+
+		Frozen->VertexCount = vertexCount;
+		Frozen->EdgeCount = edgeCount;
+		Frozen->IdCount = Graph->NextVertexId;
+		Frozen->EdgeIdCount = Graph->NextEdgeId + 1;
+		ret = kmer_table_first(Graph->VertexTable, &iter, (void **)&v);
+		while (ret == ERR_SUCCESS) {
+			PKMER_FROZEN_VERTEX fv = Frozen->Vertices + index;
+
+			fv->Type = v->Type;
+			fv->Helper = v->Helper;
+			fv->Vertex = v;
+			Frozen->IdToIndex[v->Id] = index;
+			Frozen->SuccOffsets[index] = offset;
+			Frozen->SuccCounts[index] = (uint32_t)kmer_vertex_out_degree(v);
+			offset += Frozen->SuccCounts[index];
+			++index;
+			ret = kmer_table_next(Graph->VertexTable, iter, &iter, (void **)&v);
+		}
+
+		Frozen->SuccOffsets[vertexCount] = offset;
+		ret = ERR_SUCCESS;
+		for (uint32_t i = 0; i < vertexCount; ++i) {
+			const KMER_VERTEX *u = Frozen->Vertices[i].Vertex;
+			PKMER_FROZEN_EDGE fe = Frozen->Edges + Frozen->SuccOffsets[i];
+
+			for (size_t j = 0; j < kmer_vertex_out_degree(u); ++j) {
+				fe->Edge = kmer_vertex_get_succ_edge(u, j);
+				fe->Source = i;
+				fe->Dest = Frozen->IdToIndex[fe->Edge->Dest->Id];
+				Frozen->EdgeIdToIndex[fe->Edge->Id] = (uint32_t)(fe - Frozen->Edges);
+				++fe;
+			}
+		}
+	}
+
+	if (ret != ERR_SUCCESS)
+		kmer_graph_frozen_finit(Frozen);
+
+	return ret;
+}
+
+
+/** @brief
+ *  Releases memory occupied by a frozen graph.
+ *
+ *  @param Frozen The frozen graph.
+ */
+void kmer_graph_frozen_finit(PKMER_GRAPH_FROZEN Frozen)
+{
+	if (Frozen->EdgeMarks != NULL)
+		utils_free(Frozen->EdgeMarks);
+
+	if (Frozen->EdgeIdToIndex != NULL)
+		utils_free(Frozen->EdgeIdToIndex);
+
+	if (Frozen->IdToIndex != NULL)
+		utils_free(Frozen->IdToIndex);
+
+	if (Frozen->SuccCounts != NULL)
+		utils_free(Frozen->SuccCounts);
+
+	if (Frozen->SuccOffsets != NULL)
+		utils_free(Frozen->SuccOffsets);
+
+	if (Frozen->Edges != NULL)
+		utils_free(Frozen->Edges);
+
+	if (Frozen->Vertices != NULL)
+		utils_free(Frozen->Vertices);
+
+	memset(Frozen, 0, sizeof(KMER_GRAPH_FROZEN));
+
+	return;
+}
+
+
+/** @brief
+ *  Removes an edge from the snapshot in the same way kmer_graph_delete_edge()
+ *  removes it from the graph.
+ *
+ *  @param Frozen The frozen graph.
+ *  @param Edge The edge, must be called before the edge is deleted from the graph.
+ *
+ *  @remark
+ *  The last outgoing edge of the source vertex takes place of the removed one,
+ *  as within the Successors array of the vertex.
+ */
+ERR_VALUE kmer_graph_frozen_delete_edge(PKMER_GRAPH_FROZEN Frozen, const KMER_EDGE *Edge)
+{
+	ERR_VALUE ret = ERR_NOT_FOUND;
+
+	if (Edge->Id < Frozen->EdgeIdCount) {
+		const uint32_t index = kmer_frozen_edge_index(Frozen, Edge);
+
+		if (index < Frozen->EdgeCount && Frozen->Edges[index].Edge == Edge) {
+			const uint32_t source = Frozen->Edges[index].Source;
+			const uint32_t last = Frozen->SuccOffsets[source] + Frozen->SuccCounts[source] - 1;
+
+			if (index != last) {
+				Frozen->Edges[index] = Frozen->Edges[last];
+				Frozen->EdgeIdToIndex[Frozen->Edges[index].Edge->Id] = index;
+			}
+
+			memset(Frozen->Edges + last, 0, sizeof(KMER_FROZEN_EDGE));
+			--Frozen->SuccCounts[source];
+			ret = ERR_SUCCESS;
+		}
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Appends a new edge to the outgoing edges of its source within the snapshot.
+ *
+ *  @param Frozen The frozen graph.
+ *  @param Edge The edge, already added to the graph.
+ *
+ *  @remark
+ *  The source vertex must have lost an outgoing edge since the snapshot was
+ *  created, so its range of the @Edges array has room for the new one.
+ */
+ERR_VALUE kmer_graph_frozen_add_edge(PKMER_GRAPH_FROZEN Frozen, const KMER_EDGE *Edge)
+{
+	uint32_t source = 0;
+	ERR_VALUE ret = ERR_NO_MORE_ENTRIES;
+
+	if (Edge->Source->Id < Frozen->IdCount && Edge->Dest->Id < Frozen->IdCount) {
+		source = kmer_frozen_vertex_index(Frozen, Edge->Source);
+		if (Frozen->SuccOffsets[source] + Frozen->SuccCounts[source] < Frozen->SuccOffsets[source + 1])
+			ret = ERR_SUCCESS;
+	}
+
+	if (ret == ERR_SUCCESS && Edge->Id >= Frozen->EdgeIdCount) {
+		uint32_t *tmp = NULL;
+		const uint32_t count = max(2 * Frozen->EdgeIdCount, Edge->Id + 1);
+
+		ret = utils_calloc_uint32_t(count, &tmp);
+		if (ret == ERR_SUCCESS) {
+			memcpy(tmp, Frozen->EdgeIdToIndex, Frozen->EdgeIdCount*sizeof(uint32_t));
+			utils_free(Frozen->EdgeIdToIndex);
+			Frozen->EdgeIdToIndex = tmp;
+			Frozen->EdgeIdCount = count;
+		}
+	}
+
+	if (ret == ERR_SUCCESS) {
+		const uint32_t index = Frozen->SuccOffsets[source] + Frozen->SuccCounts[source];
+		PKMER_FROZEN_EDGE fe = Frozen->Edges + index;
+
+		fe->Edge = (PKMER_EDGE)Edge;
+		fe->Source = source;
+		fe->Dest = kmer_frozen_vertex_index(Frozen, Edge->Dest);
+		Frozen->EdgeIdToIndex[Edge->Id] = index;
+		++Frozen->SuccCounts[source];
+	}
+
+	return ret;
+}
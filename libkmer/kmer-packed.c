@@ -0,0 +1,280 @@
+
+#include <stdint.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <assert.h>
+#ifndef _MSC_VER
+#include <alloca.h>
+#endif
+#include "err.h"
+#include "utils.h"
+#include "kmer-packed.h"
+
+
+/************************************************************************/
+/*                        HELPER FUNCTIONS                              */
+/************************************************************************/
+
+/** Bits 0 and 1 store the 2-bit code, bit 2 is set for symbols that need the exception mask.
+ *  Unknown characters are stored as N.
+ */
+static unsigned char _baseToPackedBaseTable[256] = {
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 0, 4, 1, 6, 7, 7, 2, 5, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 3, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 0, 4, 1, 6, 7, 7, 2, 5, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 3, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7
+};
+
+static char _packedBaseToBaseTable[8] = {
+	'A', 'C', 'G', 'T', 'B', 'H', 'D', 'N'
+};
+
+
+/** Seeds of the rolling hash, indexed by the 3-bit codes from the table above. They
+ *  are the ntHash seeds xored with the seed of A, so a zeroed k-mer (all As) has
+ *  a zero hash.
+ */
+static const uint64_t _packedBaseSeeds[8] = {
+	0x0000000000000000ULL,
+	0x0d183a36f7662f38ULL,
+	0x1cb9c56317912750ULL,
+	0x15deb246de244022ULL,
+	0xb7e1a4ae76ea0ee3ULL,
+	0xed7b3817fb54b329ULL,
+	0x66a580ab513f024fULL,
+	0xd8f76698866e5b15ULL,
+};
+
+
+static uint64_t _rol(const uint64_t Value, const uint32_t Count)
+{
+	const uint32_t c = Count % 64;
+
+	return (c == 0) ? Value : ((Value << c) | (Value >> (64 - c)));
+}
+
+
+static uint64_t _ror(const uint64_t Value, const uint32_t Count)
+{
+	const uint32_t c = Count % 64;
+
+	return (c == 0) ? Value : ((Value >> c) | (Value << (64 - c)));
+}
+
+
+static unsigned int _kmer_packed_get_code(const uint32_t KMerSize, const KMER_PACKED *KMer, const uint32_t Pos)
+{
+	unsigned int c = 0;
+	const uint32_t d = KMerSize - Pos - 1;
+	const uint64_t *x = KMer->Bases;
+
+	assert(Pos < KMerSize);
+	c = (x[d / 32] >> (2 * (d % 32))) & 3;
+	c |= ((x[KMER_PACKED_BASE_WORDS(KMerSize) + d / 64] >> (d % 64)) & 1) << 2;
+
+	return c;
+}
+
+
+static uint64_t _top_word_mask(const uint32_t UsedBits)
+{
+	return (UsedBits >= 64) ? (0ULL - 1ULL) : ((1ULL << UsedBits) - 1);
+}
+
+
+/** Shifts a multi-word value towards its most significant bit and places
+ *  the @In bits to the freed positions. Bits exceeding the k-mer are cleared.
+ */
+static void _words_shift_left(uint64_t *Words, const uint32_t Count, const uint32_t UsedBits, const uint32_t Shift, const uint64_t In)
+{
+	uint64_t carry = In;
+
+	for (uint32_t i = 0; i < Count; ++i) {
+		const uint64_t w = Words[i];
+
+		Words[i] = (w << Shift) | carry;
+		carry = w >> (64 - Shift);
+	}
+
+	Words[Count - 1] &= _top_word_mask(UsedBits);
+
+	return;
+}
+
+
+/** Shifts a multi-word value towards its least significant bit and places
+ *  the @In bits to the most significant positions of the k-mer.
+ */
+static void _words_shift_right(uint64_t *Words, const uint32_t Count, const uint32_t UsedBits, const uint32_t Shift, const uint64_t In)
+{
+	uint64_t carry = 0;
+
+	for (uint32_t i = Count; i > 0; --i) {
+		const uint64_t w = Words[i - 1];
+
+		Words[i - 1] = (w >> Shift) | carry;
+		carry = w << (64 - Shift);
+	}
+
+	Words[Count - 1] |= (In << (UsedBits - Shift));
+
+	return;
+}
+
+
+static void _kmer_packed_to_buffer(const uint32_t KMerSize, const KMER_PACKED *KMer, char *Buffer)
+{
+	for (uint32_t i = 0; i < KMerSize; ++i)
+		Buffer[i] = kmer_packed_get_base(KMerSize, KMer, i);
+
+	Buffer[KMerSize] = '\0';
+
+	return;
+}
+
+
+/************************************************************************/
+/*                     PUBLIC FUNCTIONS                                 */
+/************************************************************************/
+
+
+void kmer_packed_seq_init_by_sequence(PKMER_PACKED KMer, const uint32_t KMerSize, const char *Sequence)
+{
+	memset(KMer->Bases, 0, KMER_PACKED_WORDS(KMerSize)*sizeof(uint64_t));
+	if (Sequence != NULL) {
+		for (uint32_t i = 0; i < KMerSize; ++i)
+			kmer_packed_set_base(KMerSize, KMer, i, Sequence[i]);
+	}
+
+	return;
+}
+
+
+void kmer_packed_seq_init_raw(PKMER_PACKED KMer, const uint32_t KMerSize, const uint64_t *Data)
+{
+	memcpy(KMer->Bases, Data, KMER_PACKED_WORDS(KMerSize)*sizeof(uint64_t));
+
+	return;
+}
+
+
+void kmer_packed_advance(const uint32_t KMerSize, PKMER_PACKED KMer, const char Base)
+{
+	const uint32_t baseWords = KMER_PACKED_BASE_WORDS(KMerSize);
+	const uint32_t maskWords = KMER_PACKED_MASK_WORDS(KMerSize);
+	const unsigned int c = _baseToPackedBaseTable[(unsigned char)Base];
+	const unsigned int out = _kmer_packed_get_code(KMerSize, KMer, 0);
+	uint64_t *h = &kmer_packed_get_rolling_hash(KMerSize, KMer);
+
+	assert(KMer->Size == KMerSize);
+	*h = _rol(*h, 1) ^ _rol(_packedBaseSeeds[out], KMerSize) ^ _packedBaseSeeds[c];
+	_words_shift_left(KMer->Bases, baseWords, 2 * KMerSize - 64 * (baseWords - 1), 2, c & 3);
+	_words_shift_left(KMer->Bases + baseWords, maskWords, KMerSize - 64 * (maskWords - 1), 1, c >> 2);
+
+	return;
+}
+
+
+void kmer_packed_back(const uint32_t KMerSize, PKMER_PACKED KMer, const char Base)
+{
+	const uint32_t baseWords = KMER_PACKED_BASE_WORDS(KMerSize);
+	const uint32_t maskWords = KMER_PACKED_MASK_WORDS(KMerSize);
+	const unsigned int c = _baseToPackedBaseTable[(unsigned char)Base];
+	const unsigned int out = _kmer_packed_get_code(KMerSize, KMer, KMerSize - 1);
+	uint64_t *h = &kmer_packed_get_rolling_hash(KMerSize, KMer);
+
+	assert(KMer->Size == KMerSize);
+	*h = _ror(*h ^ _packedBaseSeeds[out], 1) ^ _rol(_packedBaseSeeds[c], KMerSize - 1);
+	_words_shift_right(KMer->Bases, baseWords, 2 * KMerSize - 64 * (baseWords - 1), 2, c & 3);
+	_words_shift_right(KMer->Bases + baseWords, maskWords, KMerSize - 64 * (maskWords - 1), 1, c >> 2);
+
+	return;
+}
+
+
+char kmer_packed_get_base(const uint32_t KMerSize, const KMER_PACKED *KMer, const uint32_t Pos)
+{
+	return _packedBaseToBaseTable[_kmer_packed_get_code(KMerSize, KMer, Pos)];
+}
+
+
+char kmer_packed_get_last_base(const uint32_t KMerSize, const KMER_PACKED *KMer)
+{
+	unsigned int c = 0;
+	const uint64_t *x = KMer->Bases;
+
+	c = (x[0] & 3) | ((x[KMER_PACKED_BASE_WORDS(KMerSize)] & 1) << 2);
+
+	return _packedBaseToBaseTable[c];
+}
+
+
+void kmer_packed_set_base(const uint32_t KMerSize, PKMER_PACKED KMer, const uint32_t Pos, const char Base)
+{
+	const uint32_t d = KMerSize - Pos - 1;
+	const unsigned int c = _baseToPackedBaseTable[(unsigned char)Base];
+	uint64_t *b = KMer->Bases + d / 32;
+	uint64_t *m = KMer->Bases + KMER_PACKED_BASE_WORDS(KMerSize) + d / 64;
+	uint64_t *h = &kmer_packed_get_rolling_hash(KMerSize, KMer);
+
+	assert(Pos < KMerSize);
+	*h ^= _rol(_packedBaseSeeds[_kmer_packed_get_code(KMerSize, KMer, Pos)] ^ _packedBaseSeeds[c], d);
+	*b = (*b & ~(3ULL << (2 * (d % 32)))) | ((uint64_t)(c & 3) << (2 * (d % 32)));
+	*m = (*m & ~(1ULL << (d % 64))) | ((uint64_t)(c >> 2) << (d % 64));
+
+	return;
+}
+
+
+size_t kmer_packed_hash(const uint32_t KMerSize, const KMER_PACKED *KMer)
+{
+	uint64_t ret = kmer_packed_get_rolling_hash(KMerSize, KMer);
+
+	// The rolling hash is linear, spread its bits before the hash table masks them
+	ret = (ret ^ (ret >> 31)) * 0x9E3779B97F4A7C15ULL;
+	ret ^= (ret >> 29);
+
+	return (size_t)ret;
+}
+
+
+void kmer_packed_print(FILE *Stream, const uint32_t KMerSize, const KMER_PACKED *KMer)
+{
+	char *buf = alloca((KMerSize + 1) * sizeof(char));
+
+	_kmer_packed_to_buffer(KMerSize, KMer, buf);
+	fputs(buf, Stream);
+	fprintf(Stream, "_%u", KMer->Number);
+
+	return;
+}
+
+
+boolean kmer_packed_seq_equal(const uint32_t KMerSize, const KMER_PACKED *K1, const KMER_PACKED *K2)
+{
+	boolean ret = TRUE;
+	const uint64_t *B1 = K1->Bases;
+	const uint64_t *B2 = K2->Bases;
+	const uint32_t count = KMER_PACKED_SEQ_WORDS(KMerSize);
+
+	ret = (B1[count] == B2[count]);
+	for (uint32_t i = 0; ret && i < count; ++i) {
+		ret = (B1[i] == B2[i]);
+		if (!ret)
+			break;
+	}
+
+	return ret;
+}
@@ -2,7 +2,6 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
-#include "khash.h"
 #include "err.h"
 #include "utils.h"
 #include "kmer.h"
@@ -13,6 +12,15 @@
 /*                      HELPER MACROS AND TYPES                         */
 /************************************************************************/
 
+/** Marks slots whose data were deleted. */
+static char _tombstone;
+
+#define KMER_TABLE_TOMBSTONE					((void *)&_tombstone)
+#define KMER_TABLE_MIN_CAPACITY					16
+
+#define _kmer_table_entry(aTable, aIndex)		((PKMER_TABLE_ENTRY)((aTable)->Entries + (aIndex)*(aTable)->EntrySize))
+#define _kmer_table_entry_valid(aEntry)			((aEntry)->Data != NULL && (aEntry)->Data != KMER_TABLE_TOMBSTONE)
+
 /************************************************************************/
 /*                   HELPER FUNCTIONS                                   */
 /************************************************************************/
@@ -21,7 +29,89 @@
 UTILS_TYPED_MALLOC_FUNCTION(KMER_TABLE)
 
 
-__KHASH_IMPL(vertexTable, INLINE_FUNCTION, const KMER *, void *, TRUE, kmer_hash, kmer_equal)
+static size_t _kmer_table_entry_size(const uint32_t KMerSize)
+{
+	return (KMER_BYTES_EXTRA(KMerSize, offsetof(KMER_TABLE_ENTRY, KMer)) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+}
+
+
+/** Computes the hash of a key. Context numbers are mixed in, since many
+ *  helper and repeat vertices share the same sequence.
+ */
+static size_t _kmer_table_hash(const KMER_TABLE *Table, const KMER *KMer)
+{
+	return kmer_hash(Table->KMerSize, KMer) ^ ((size_t)kmer_get_number(KMer) * 0x9E3779B97F4A7C15ULL);
+}
+
+
+/** Returns the slot containing a given key, or NULL if the key is not present. */
+static PKMER_TABLE_ENTRY _kmer_table_find(const KMER_TABLE *Table, const KMER *KMer, const size_t Hash)
+{
+	PKMER_TABLE_ENTRY ret = NULL;
+	const size_t mask = Table->Capacity - 1;
+	size_t index = Hash & mask;
+	PKMER_TABLE_ENTRY e = _kmer_table_entry(Table, index);
+
+	while (e->Data != NULL) {
+		if (e->Data != KMER_TABLE_TOMBSTONE && e->Hash == Hash && kmer_equal(Table->KMerSize, &e->KMer, KMer)) {
+			ret = e;
+			break;
+		}
+
+		index = (index + 1) & mask;
+		e = _kmer_table_entry(Table, index);
+	}
+
+	return ret;
+}
+
+
+/** Returns the first free (empty or deleted) slot of the probe sequence
+ *  for a given hash. The key must not be present in the table.
+ */
+static PKMER_TABLE_ENTRY _kmer_table_find_free(const KMER_TABLE *Table, const size_t Hash)
+{
+	const size_t mask = Table->Capacity - 1;
+	size_t index = Hash & mask;
+	PKMER_TABLE_ENTRY e = _kmer_table_entry(Table, index);
+
+	while (_kmer_table_entry_valid(e)) {
+		index = (index + 1) & mask;
+		e = _kmer_table_entry(Table, index);
+	}
+
+	return e;
+}
+
+
+/** Moves all valid entries into a new slot array of a given capacity.
+ *  Tombstones are dropped.
+ */
+static ERR_VALUE _kmer_table_resize(PKMER_TABLE Table, const size_t NewCapacity)
+{
+	unsigned char *newEntries = NULL;
+	unsigned char *oldEntries = Table->Entries;
+	const size_t oldCapacity = Table->Capacity;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_calloc(NewCapacity, Table->EntrySize, (void **)&newEntries);
+	if (ret == ERR_SUCCESS) {
+		Table->Entries = newEntries;
+		Table->EntriesSize = NewCapacity*Table->EntrySize;
+		Table->Capacity = NewCapacity;
+		Table->Deleted = 0;
+		for (size_t i = 0; i < oldCapacity; ++i) {
+			const KMER_TABLE_ENTRY *old = (PKMER_TABLE_ENTRY)(oldEntries + i*Table->EntrySize);
+
+			if (_kmer_table_entry_valid(old))
+				memcpy(_kmer_table_find_free(Table, old->Hash), old, Table->EntrySize);
+		}
+
+		utils_free(oldEntries);
+	}
+
+	return ret;
+}
 
 
 static void _on_insert_dummy_callback(struct _KMER_TABLE *Table, void *ItemData, const uint32_t Order)
@@ -56,14 +146,22 @@ static void _on_print_dummy_callback(struct _KMER_TABLE *Table, void *ItemData,
 
 ERR_VALUE kmer_table_create(const uint32_t KMerSize, const size_t Size, const KMER_TABLE_CALLBACKS *Callbacks, PKMER_TABLE *Table)
 {
+	size_t capacity = KMER_TABLE_MIN_CAPACITY;
 	PKMER_TABLE tmpTable = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
+	while (capacity < Size)
+		capacity *= 2;
+
 	ret = utils_malloc_KMER_TABLE(&tmpTable);
 	if (ret == ERR_SUCCESS) {
-		tmpTable->KHashTable = kh_init(vertexTable);
-		if (tmpTable != NULL) {
-			tmpTable->KHashTable->Context = KMerSize;
+		tmpTable->EntrySize = _kmer_table_entry_size(KMerSize);
+		tmpTable->Capacity = capacity;
+		tmpTable->EntriesSize = capacity*tmpTable->EntrySize;
+		tmpTable->Count = 0;
+		tmpTable->Deleted = 0;
+		ret = utils_calloc(tmpTable->Capacity, tmpTable->EntrySize, (void **)&tmpTable->Entries);
+		if (ret == ERR_SUCCESS) {
 			tmpTable->LastOrder = 0;
 			tmpTable->KMerSize = KMerSize;
 			if (Callbacks == NULL) {
@@ -75,12 +173,11 @@ ERR_VALUE kmer_table_create(const uint32_t KMerSize, const size_t Size, const KM
 			} else tmpTable->Callbacks = *Callbacks;
 
 			*Table = tmpTable;
-			ret = ERR_SUCCESS;
-		} else ret = ERR_OUT_OF_MEMORY;
+		}
 		
 		if (ret != ERR_SUCCESS)
 			utils_free(tmpTable);
-	} else ret = ERR_OUT_OF_MEMORY;
+	}
 
 	return ret;
 }
@@ -88,23 +185,79 @@ ERR_VALUE kmer_table_create(const uint32_t KMerSize, const size_t Size, const KM
 
 void kmer_table_destroy(PKMER_TABLE Table)
 {
-	for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
-		if (kh_exist(Table->KHashTable, it))
-			Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
+	if (Table->Callbacks.OnDelete != NULL) {
+		for (size_t i = 0; i < Table->Capacity; ++i) {
+			const KMER_TABLE_ENTRY *e = _kmer_table_entry(Table, i);
+
+			if (_kmer_table_entry_valid(e))
+				Table->Callbacks.OnDelete(Table, e->Data, Table->Callbacks.Context);
+		}
 	}
 
-	kh_destroy(vertexTable, Table->KHashTable);
+	utils_free(Table->Entries);
 	utils_free(Table);
 
 	return;
 }
 
 
+/** @brief
+ *  Removes all items from the table and prepares it for k-mers of a given size.
+ *
+ *  @param Table The table to reset.
+ *  @param KMerSize Size of k-mers to be inserted from now on.
+ *
+ *  @remark
+ *  The OnDelete callback is invoked for every item. The table keeps its capacity
+ *  and the slot array is reallocated only when the larger k-mers do not fit into it.
+ *  If the reallocation fails, the table stays empty with the old k-mer size.
+ */
+ERR_VALUE kmer_table_reset(PKMER_TABLE Table, const uint32_t KMerSize)
+{
+	const size_t entrySize = _kmer_table_entry_size(KMerSize);
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Table->Callbacks.OnDelete != NULL) {
+		for (size_t i = 0; i < Table->Capacity; ++i) {
+			const KMER_TABLE_ENTRY *e = _kmer_table_entry(Table, i);
+
+			if (_kmer_table_entry_valid(e))
+				Table->Callbacks.OnDelete(Table, e->Data, Table->Callbacks.Context);
+		}
+	}
+
+	memset(Table->Entries, 0, Table->Capacity*Table->EntrySize);
+	Table->Count = 0;
+	Table->Deleted = 0;
+	Table->LastOrder = 0;
+	ret = ERR_SUCCESS;
+	if (Table->Capacity*entrySize > Table->EntriesSize) {
+		unsigned char *newEntries = NULL;
+
+		ret = utils_calloc(Table->Capacity, entrySize, (void **)&newEntries);
+		if (ret == ERR_SUCCESS) {
+			utils_free(Table->Entries);
+			Table->Entries = newEntries;
+			Table->EntriesSize = Table->Capacity*entrySize;
+		}
+	}
+
+	if (ret == ERR_SUCCESS) {
+		Table->KMerSize = KMerSize;
+		Table->EntrySize = entrySize;
+	}
+
+	return ret;
+}
+
+
 void kmer_table_print(FILE *Stream, const PKMER_TABLE Table)
 {
-	for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
-		if (kh_exist(Table->KHashTable, it))
-			Table->Callbacks.OnPrint(Table, kh_val(Table->KHashTable, it), Stream);
+	for (size_t i = 0; i < Table->Capacity; ++i) {
+		const KMER_TABLE_ENTRY *e = _kmer_table_entry(Table, i);
+
+		if (_kmer_table_entry_valid(e))
+			Table->Callbacks.OnPrint(Table, e->Data, Stream);
 	}
 
 	return;
@@ -113,29 +266,29 @@ void kmer_table_print(FILE *Stream, const PKMER_TABLE Table)
 
 ERR_VALUE kmer_table_insert(PKMER_TABLE Table, const KMER *KMer, void *Data)
 {
-	int r = 0;
+	PKMER_TABLE_ENTRY e = NULL;
+	const size_t hash = _kmer_table_hash(Table, KMer);
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	khiter_t it;
 
-	it = kh_put(vertexTable, Table->KHashTable, KMer, &r);
-	switch (r) {
-		case 0:
-			ret = ERR_ALREADY_EXISTS;
-			break;
-		case 1:
-		case 2:
-			kh_val(Table->KHashTable, it) = Data;
+	assert(Data != NULL);
+	if (_kmer_table_find(Table, KMer, hash) == NULL) {
+		ret = ERR_SUCCESS;
+		if ((Table->Count + Table->Deleted + 1) * 4 > Table->Capacity * 3)
+			ret = _kmer_table_resize(Table, (Table->Count * 2 >= Table->Capacity) ? Table->Capacity * 2 : Table->Capacity);
+
+		if (ret == ERR_SUCCESS) {
+			e = _kmer_table_find_free(Table, hash);
+			if (e->Data == KMER_TABLE_TOMBSTONE)
+				--Table->Deleted;
+
+			e->Hash = hash;
+			e->Data = Data;
+			kmer_init_from_kmer(&e->KMer, Table->KMerSize, KMer);
+			++Table->Count;
 			Table->Callbacks.OnInsert(Table, Data, Table->LastOrder);
 			++Table->LastOrder;
-			ret = ERR_SUCCESS;
-			break;
-		case -1:
-			ret = ERR_OUT_OF_MEMORY;
-			break;
-		default:
-			assert(FALSE);
-			break;
-	}
+		}
+	} else ret = ERR_ALREADY_EXISTS;
 
 	return ret;
 }
@@ -143,13 +296,17 @@ ERR_VALUE kmer_table_insert(PKMER_TABLE Table, const KMER *KMer, void *Data)
 
 ERR_VALUE kmer_table_delete(PKMER_TABLE Table, const KMER *KMer)
 {
-	khiter_t it;
+	PKMER_TABLE_ENTRY e = NULL;
+	void *data = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	it = kh_get(vertexTable, Table->KHashTable, KMer);
-	if (it != kh_end(Table->KHashTable)) {
-		Table->Callbacks.OnDelete(Table, kh_val(Table->KHashTable, it), Table->Callbacks.Context);
-		kh_del(vertexTable, Table->KHashTable, it);
+	e = _kmer_table_find(Table, KMer, _kmer_table_hash(Table, KMer));
+	if (e != NULL) {
+		data = e->Data;
+		e->Data = KMER_TABLE_TOMBSTONE;
+		--Table->Count;
+		++Table->Deleted;
+		Table->Callbacks.OnDelete(Table, data, Table->Callbacks.Context);
 		ret = ERR_SUCCESS;
 	} else ret = ERR_NOT_FOUND;
 
@@ -160,11 +317,11 @@ ERR_VALUE kmer_table_delete(PKMER_TABLE Table, const KMER *KMer)
 void *kmer_table_get(const struct _KMER_TABLE *Table, const struct _KMER *KMer)
 {
 	void *ret = NULL;
-	khiter_t it;
+	const KMER_TABLE_ENTRY *e = NULL;
 
-	it = kh_get(vertexTable, Table->KHashTable, KMer);
-	if (it != kh_end(Table->KHashTable))
-		ret = kh_val(Table->KHashTable, it);
+	e = _kmer_table_find(Table, KMer, _kmer_table_hash(Table, KMer));
+	if (e != NULL)
+		ret = e->Data;
 
 	return ret;
 }
@@ -172,19 +329,7 @@ void *kmer_table_get(const struct _KMER_TABLE *Table, const struct _KMER *KMer)
 
 ERR_VALUE kmer_table_first(const PKMER_TABLE Table, void **Slot, void **Data)
 {
-	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-
-	ret = ERR_NO_MORE_ENTRIES;
-	for (khiter_t it = kh_begin(Table->KHashTable); it != kh_end(Table->KHashTable); ++it) {
-		if (kh_exist(Table->KHashTable, it)) {
-			*Slot = (void *)it;
-			*Data = kh_val(Table->KHashTable, it);
-			ret = ERR_SUCCESS;
-			break;
-		}
-	}
-
-	return ret;
+	return kmer_table_next(Table, (void *)(size_t)-1, Slot, Data);
 }
 
 
@@ -193,10 +338,12 @@ ERR_VALUE kmer_table_next(const PKMER_TABLE Table, const void *Current, void **N
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
 	ret = ERR_NO_MORE_ENTRIES;
-	for (khiter_t it = (khiter_t)Current + 1; it != kh_end(Table->KHashTable); ++it) {
-		if (kh_exist(Table->KHashTable, it)) {
-			*Next = (void *)it;
-			*Data = kh_val(Table->KHashTable, it);
+	for (size_t i = (size_t)Current + 1; i < Table->Capacity; ++i) {
+		const KMER_TABLE_ENTRY *e = _kmer_table_entry(Table, i);
+
+		if (_kmer_table_entry_valid(e)) {
+			*Next = (void *)i;
+			*Data = e->Data;
 			ret = ERR_SUCCESS;
 			break;
 		}
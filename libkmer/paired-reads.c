@@ -3,114 +3,84 @@
 #include <stdint.h>
 #include "err.h"
 #include "utils.h"
-#include "khash.h"
 #include "reads.h"
 #include "paired-reads.h"
 
 
-KHASH_MAP_INIT_STR(RP, PPOINTER_ARRAY_ONE_READ)
-
-
-static khash_t(RP) *_table = NULL;
-
-
-
-
-ERR_VALUE paired_reads_init(void)
+/** Counts positions where two sequences differ, eight bases at once. */
+static size_t _count_mismatches(const char *A, const char *B, const size_t Length)
 {
-	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-
-	_table = kh_init(RP);
-	ret = (_table != NULL) ? ERR_SUCCESS : ERR_OUT_OF_MEMORY;
-
-	return ret;
-}
-
-
-void paired_reads_finit(void)
-{
-	PPOINTER_ARRAY_ONE_READ pairedReads = NULL;
-
-	for (khiter_t it = kh_begin(_table); it != kh_end(_table); ++it) {
-		if (kh_exist(_table, it)) {
-			pairedReads = kh_val(_table, it);
-			pointer_array_finit_ONE_READ(pairedReads);
-			utils_free(pairedReads);
-			kh_val(_table, it) = NULL;
-		}
+	const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+	size_t ret = 0;
+	size_t i = 0;
+
+	for (i = 0; i + sizeof(uint64_t) <= Length; i += sizeof(uint64_t)) {
+		uint64_t a = 0;
+		uint64_t b = 0;
+		uint64_t x = 0;
+
+		memcpy(&a, A + i, sizeof(a));
+		memcpy(&b, B + i, sizeof(b));
+		x = a ^ b;
+		// The top bit of each byte is set iff the byte is nonzero
+		x = (((x & low7) + low7) | x) & ~low7;
+		ret += (size_t)(((x >> 7) * 0x0101010101010101ULL) >> 56);
 	}
 
+	for (; i < Length; ++i)
+		ret += (A[i] != B[i]);
 
-	kh_destroy(RP, _table);
-	_table = NULL;
-
-	return;
+	return ret;
 }
 
 
-ERR_VALUE paired_reads_insert(const ONE_READ *Read)
+/** @brief
+ *  Groups reads by their templates.
+ *
+ *  @param Paired The structure to initialize.
+ *  @param Reads The reads, numbered by their TemplateId fields.
+ *  @param Count Number of the reads.
+ *
+ *  @remark
+ *  The reads are grouped by a counting sort of their template numbers, reads of
+ *  one template keep their order. Reads without a template (number zero) are
+ *  collected in the group zero that is skipped by the users.
+ */
+ERR_VALUE paired_reads_init(PPAIRED_READS Paired, PONE_READ Reads, const size_t Count)
 {
-	khiter_t it = kh_end(_table);
+	size_t templateCount = 0;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	PPOINTER_ARRAY_ONE_READ pairedReads = NULL;
-
-	ret = ERR_SUCCESS;
-	if (Read->Extension->TemplateName != NULL && *Read->Extension->TemplateName != '\0') {
-		it = kh_get(RP, _table, Read->Extension->TemplateName);
-		if (it == kh_end(_table)) {
-			ret = utils_malloc(sizeof(POINTER_ARRAY_ONE_READ), &pairedReads);
-			if (ret == ERR_SUCCESS) {
-				int tmp = 0;
-
-				pointer_array_init_ONE_READ(pairedReads, 140);
-				it = kh_put(RP, _table, Read->Extension->TemplateName, &tmp);
-				switch (tmp) {
-					case -1: ret = ERR_OUT_OF_MEMORY;  break;
-					case 0: ret = ERR_ALREADY_EXISTS; break;
-					case 2: ret = ERR_NOT_FOUND; break;
-				}
 
-				if (ret == ERR_SUCCESS)
-					kh_value(_table, it) = pairedReads;
-			}
-		} else pairedReads = kh_value(_table, it);
+	memset(Paired, 0, sizeof(PAIRED_READS));
+	for (size_t i = 0; i < Count; ++i)
+		templateCount = max(templateCount, Reads[i].Extension->TemplateId);
 
-		if (ret == ERR_SUCCESS)
-			ret = pointer_array_push_back_ONE_READ(pairedReads, Read);
-	}
+	ret = utils_calloc_size_t(templateCount + 3, &Paired->TemplateStarts);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_size_t(max(Count, 1), &Paired->Members);
+		if (ret == ERR_SUCCESS) {
+			size_t *starts = Paired->TemplateStarts;
 
-	return ret;
-}
+			for (size_t i = 0; i < Count; ++i)
+				++starts[Reads[i].Extension->TemplateId + 2];
 
+			for (size_t i = 1; i < templateCount + 3; ++i)
+				starts[i] += starts[i - 1];
 
-ERR_VALUE paired_reads_insert_array(const ONE_READ *Reads, const size_t Count)
-{
-	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	const ONE_READ *r = Reads;
-
-	ret = ERR_SUCCESS;
-	for (size_t i = 0; i < Count; ++i) {
-		ret = paired_reads_insert(r);
-		if (ret != ERR_SUCCESS)
-			break;
-
-		++r;
-	}
-
-	return ret;
-}
+			// Moves each start to the end of its template, i.e. to the start of the next one
+			for (size_t i = 0; i < Count; ++i) {
+				Paired->Members[starts[Reads[i].Extension->TemplateId + 1]] = i;
+				++starts[Reads[i].Extension->TemplateId + 1];
+			}
 
-ERR_VALUE paired_reads_first(khiter_t *Iterator, PPOINTER_ARRAY_ONE_READ *Reads)
-{
-	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+			Paired->Reads = Reads;
+			Paired->ReadCount = Count;
+			Paired->TemplateCount = templateCount;
+		}
 
-	ret = ERR_NO_MORE_ENTRIES;
-	for (khiter_t it = kh_begin(_table); it != kh_end(_table); ++it) {
-		if (kh_exist(_table, it)) {
-			*Iterator = it;
-			*Reads = kh_value(_table, it);
-			ret = ERR_SUCCESS;
-			break;
+		if (ret != ERR_SUCCESS) {
+			utils_free(Paired->TemplateStarts);
+			Paired->TemplateStarts = NULL;
 		}
 	}
 
@@ -118,41 +88,48 @@ ERR_VALUE paired_reads_first(khiter_t *Iterator, PPOINTER_ARRAY_ONE_READ *Reads)
 }
 
 
-ERR_VALUE paired_reads_next(khiter_t Iterator, khiter_t *NewIt, PPOINTER_ARRAY_ONE_READ *Reads)
+void paired_reads_finit(PPAIRED_READS Paired)
 {
-	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+	if (Paired->Members != NULL)
+		utils_free(Paired->Members);
 
-	ret = ERR_NO_MORE_ENTRIES;
-	for (khiter_t it = Iterator + 1; it != kh_end(_table); ++it) {
-		if (kh_exist(_table, it)) {
-			*NewIt = it;
-			*Reads = kh_value(_table, it);
-			ret = ERR_SUCCESS;
-			break;
-		}
-	}
+	if (Paired->TemplateStarts != NULL)
+		utils_free(Paired->TemplateStarts);
 
-	return ret;
+	memset(Paired, 0, sizeof(PAIRED_READS));
+
+	return;
 }
 
 
-void paired_reads_fix_overlaps(boolean Strip)
+/** @brief
+ *  Detects overlapping mates and optionally strips the mismatching overlaps.
+ *
+ *  @param Paired The reads grouped by their templates.
+ *  @param Strip Shorten the first read of a mismatching overlap.
+ *
+ *  @remark
+ *  Every read belongs to a single template, so the templates are processed in parallel.
+ */
+void paired_reads_fix_overlaps(const PAIRED_READS *Paired, boolean Strip)
 {
-	khiter_t iter;
-	ERR_VALUE err = ERR_INTERNAL_ERROR;
-	PPOINTER_ARRAY_ONE_READ reads = NULL;
+	long t = 0;
 	size_t totalOverlaps = 0;
 	size_t mismatches = 0;
+	size_t mismatchedBases = 0;
+
+#pragma omp parallel for schedule(dynamic, 1024) reduction(+:totalOverlaps, mismatches, mismatchedBases)
+	for (t = 1; t <= (long)Paired->TemplateCount; ++t) {
+		const size_t *members = Paired->Members + Paired->TemplateStarts[t];
+		const size_t count = Paired->TemplateStarts[t + 1] - Paired->TemplateStarts[t];
 
-	err = paired_reads_first(&iter, &reads);
-	while (err == ERR_SUCCESS) {
-		for (size_t i = 0; i < pointer_array_size(reads); ++i) {			
-			for (size_t j = 0; j < pointer_array_size(reads); ++j) {
+		for (size_t i = 0; i < count; ++i) {			
+			for (size_t j = 0; j < count; ++j) {
 				if (i == j)
 					continue;
 				
-				PONE_READ r1 = reads->Data[i];
-				PONE_READ r2 = reads->Data[j];
+				PONE_READ r1 = Paired->Reads + members[i];
+				PONE_READ r2 = Paired->Reads + members[j];
 
 				if (in_range(r1->Pos, r1->ReadSequenceLen, r2->Pos) &&
 					!in_range(r1->Pos, r1->ReadSequenceLen, r2->Pos + r2->ReadSequenceLen)) {
@@ -168,16 +145,12 @@ void paired_reads_fix_overlaps(boolean Strip)
 					if (overlapLength > r2->ReadSequenceLen)
 						overlapLength = r2->ReadSequenceLen;
 
-					matches = (strncmp(or1, or2, overlapLength) == 0);
+					mismatchCount = _count_mismatches(or1, or2, overlapLength);
+					matches = (mismatchCount == 0);
 					r1->NoEndStrip = matches;
 					if (!matches) {
 						++mismatches;
-						for (size_t k = 0; k < overlapLength; ++k) {
-							if (or1[k] != or2[k]) {
-								++mismatchCount;
-							}
-						}
-
+						mismatchedBases += mismatchCount;
 						if (Strip) {
 							if (overlapLength < r2->ReadSequenceLen) {
 								uint32_t r2Move = overlapLength;
@@ -220,44 +193,45 @@ void paired_reads_fix_overlaps(boolean Strip)
 				}
 			}
 		}
-
-		err = paired_reads_next(iter, &iter, &reads);
 	}
 
-//	fprintf(stderr, "Overlaps: %Iu, Mismatching: %Iu\n", totalOverlaps, mismatches);
+//	fprintf(stderr, "Overlaps: %Iu, Mismatching: %Iu (%Iu bases)\n", totalOverlaps, mismatches, mismatchedBases);
 
 	return;
 }
 
 
-void paired_reads_print(FILE *Stream)
+void paired_reads_print(FILE *Stream, const PAIRED_READS *Paired)
 {
-	khiter_t it;
-	PPOINTER_ARRAY_ONE_READ reads = NULL;
-	ERR_VALUE err = ERR_INTERNAL_ERROR;
 	size_t totalCount = 0;
 	GEN_ARRAY_size_t counts;
 
 	dym_array_init_size_t(&counts, 140);
-	err = paired_reads_first(&it, &reads);
-	while (err == ERR_SUCCESS) {
-		if (pointer_array_size(reads) > gen_array_size(&counts)) {
-			dym_array_reserve_size_t(&counts, pointer_array_size(reads));
-			counts.ValidLength = pointer_array_size(reads);
-			counts.Data[pointer_array_size(reads) - 1] = 0;
+	for (size_t t = 1; t <= Paired->TemplateCount; ++t) {
+		const size_t count = Paired->TemplateStarts[t + 1] - Paired->TemplateStarts[t];
+
+		if (count == 0)
+			continue;
+
+		if (count > gen_array_size(&counts)) {
+			const size_t oldCount = gen_array_size(&counts);
+
+			dym_array_reserve_size_t(&counts, count);
+			counts.ValidLength = count;
+			for (size_t i = oldCount; i < count; ++i)
+				counts.Data[i] = 0;
 		}
 
-		counts.Data[pointer_array_size(reads) - 1] += 1;
-		totalCount += pointer_array_size(reads);
-		fprintf(Stream, "%s\t --> %Iu reads\n", reads->Data[0]->Extension->TemplateName, pointer_array_size(reads));
-		err = paired_reads_next(it, &it, &reads);
+		counts.Data[count - 1] += 1;
+		totalCount += count;
+		fprintf(Stream, "%s\t --> %zu reads\n", Paired->Reads[Paired->Members[Paired->TemplateStarts[t]]].Extension->TemplateName, count);
 	}
 
 	for (size_t i = 0; i < gen_array_size(&counts); ++i)
-		fprintf(Stream, "%Iu, %Iu\n", i + 1, counts.Data[i]);
+		fprintf(Stream, "%zu, %zu\n", i + 1, counts.Data[i]);
 
 	dym_array_finit_size_t(&counts);
-	fprintf(Stream, "%Iu reads, %u groups\n", totalCount, _table->n_occupied);
+	fprintf(Stream, "%zu reads, %zu groups\n", totalCount, Paired->TemplateCount);
 
 	return;
 }
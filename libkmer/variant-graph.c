@@ -890,22 +890,24 @@ void vg_graph_finit(PVARIANT_GRAPH Graph)
 }
 
 
-ERR_VALUE vg_graph_add_paired(PVARIANT_GRAPH Graph)
+ERR_VALUE vg_graph_add_paired(PVARIANT_GRAPH Graph, const PAIRED_READS *Paired)
 {
 	PPOINTER_ARRAY_VARIANT_GRAPH_VERTEX *readVertices = NULL;
-	khiter_t pairedIter;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	PPOINTER_ARRAY_ONE_READ pairedReads = NULL;
 
-	ret = paired_reads_first(&pairedIter, &pairedReads);
-	while (ret == ERR_SUCCESS) {
-		const size_t prCount = pointer_array_size(pairedReads);
+	ret = ERR_SUCCESS;
+	for (size_t t = 1; t <= Paired->TemplateCount; ++t) {
+		const size_t *members = Paired->Members + Paired->TemplateStarts[t];
+		const size_t prCount = Paired->TemplateStarts[t + 1] - Paired->TemplateStarts[t];
 		
+		if (prCount < 2)
+			continue;
+
 		ret = utils_calloc_PPOINTER_ARRAY_VARIANT_GRAPH_VERTEX(prCount, &readVertices);
 		if (ret == ERR_SUCCESS) {
 			for (size_t i = 0; i < prCount; ++i) {
 				khiter_t mapIt;
-				const ONE_READ *r = pairedReads->Data[i];
+				const ONE_READ *r = Paired->Reads + members[i];
 
 				readVertices[i] = NULL;
 				mapIt = kh_get(ReadToVertex, Graph->ReadMap, r->ReadIndex);
@@ -984,11 +986,11 @@ ERR_VALUE vg_graph_add_paired(PVARIANT_GRAPH Graph)
 			utils_free(readVertices);
 		}
 
-		if (ret == ERR_SUCCESS)
-			ret = paired_reads_next(pairedIter, &pairedIter, &pairedReads);
+		if (ret != ERR_SUCCESS)
+			break;
 	}
 
-	if (ret == ERR_NO_MORE_ENTRIES)
+	if (ret == ERR_SUCCESS)
 		ret = _compute_components(Graph);
 
 	return ret;
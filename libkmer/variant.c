@@ -1,5 +1,6 @@
 
 #include <inttypes.h>
+#include <ctype.h>
 #include "err.h"
 #include "utils.h"
 #include "refseq-storage.h"
@@ -7,6 +8,112 @@
 #include "variant.h"
 
 
+/************************************************************************/
+/*                        HELPER FUNCTIONS                              */
+/************************************************************************/
+
+
+#define VC_INDEX_MINIMUM_SIZE				16
+
+
+static size_t _vc_string_hash(size_t Hash, const char *String)
+{
+	while (*String != '\0') {
+		Hash = (Hash ^ (unsigned char)tolower((unsigned char)*String)) * 0x100000001b3ULL;
+		++String;
+	}
+
+	return Hash;
+}
+
+
+static size_t _vc_hash(const VARIANT_CALL *VC)
+{
+	size_t ret = 0xcbf29ce484222325ULL;
+
+	ret = (ret ^ VC->Pos) * 0x100000001b3ULL;
+	ret = _vc_string_hash(ret, VC->Chrom);
+	ret = _vc_string_hash(ret ^ '/', VC->Ref);
+	ret = _vc_string_hash(ret ^ '>', VC->Alt);
+	ret ^= (ret >> 29);
+
+	return ret;
+}
+
+
+static void _vc_index_place(size_t *Slots, const size_t Size, const size_t Hash, const size_t Position)
+{
+	size_t slot = Hash & (Size - 1);
+
+	while (Slots[slot] != 0)
+		slot = (slot + 1) & (Size - 1);
+
+	Slots[slot] = Position + 1;
+
+	return;
+}
+
+
+static ERR_VALUE _vc_index_grow(PVC_INDEX Index)
+{
+	size_t *newSlots = NULL;
+	const size_t newSize = Index->Size * 2;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_calloc_size_t(newSize, &newSlots);
+	if (ret == ERR_SUCCESS) {
+		for (size_t i = 0; i < Index->Size; ++i) {
+			if (Index->Slots[i] != 0)
+				_vc_index_place(newSlots, newSize, _vc_hash(Index->Array->Data + Index->Slots[i] - 1), Index->Slots[i] - 1);
+		}
+
+		utils_free(Index->Slots);
+		Index->Slots = newSlots;
+		Index->Size = newSize;
+	}
+
+	return ret;
+}
+
+
+/** Heap of source arrays ordered by position of their next call; ties are
+ *  broken by the source index, so the merge keeps the order of the sources. */
+static boolean _vc_merge_heap_less(const GEN_ARRAY_VARIANT_CALL *Sources, const size_t *Indices, const size_t S1, const size_t S2)
+{
+	const uint64_t p1 = Sources[S1].Data[Indices[S1]].Pos;
+	const uint64_t p2 = Sources[S2].Data[Indices[S2]].Pos;
+
+	return (p1 < p2 || (p1 == p2 && S1 < S2));
+}
+
+
+static void _vc_merge_heap_down(size_t *Heap, const size_t HeapSize, size_t Index, const GEN_ARRAY_VARIANT_CALL *Sources, const size_t *Indices)
+{
+	const size_t s = Heap[Index];
+
+	while (2 * Index + 1 < HeapSize) {
+		size_t child = 2 * Index + 1;
+
+		if (child + 1 < HeapSize && _vc_merge_heap_less(Sources, Indices, Heap[child + 1], Heap[child]))
+			++child;
+
+		if (!_vc_merge_heap_less(Sources, Indices, Heap[child], s))
+			break;
+
+		Heap[Index] = Heap[child];
+		Index = child;
+	}
+
+	Heap[Index] = s;
+
+	return;
+}
+
+
+/************************************************************************/
+/*                     PUBLIC FUNCTIONS                                 */
+/************************************************************************/
+
 
 ERR_VALUE variant_call_init(const char *Chrom, uint64_t Pos, const char *ID, const char *Ref, size_t RefLen, const char *Alt, size_t AltLen, const uint8_t Qual, const GEN_ARRAY_size_t *RefReads, const GEN_ARRAY_size_t *AltReads, PVARIANT_CALL VC)
 {
@@ -140,6 +247,48 @@ ERR_VALUE vc_array_add(PGEN_ARRAY_VARIANT_CALL Array, const VARIANT_CALL *VC, PV
 }
 
 
+/** @brief
+ *  Adds a variant call to an array, using an index to find its duplicate.
+ *
+ *  @param Array The array.
+ *  @param Index Index of the array. The new call is added to it.
+ *  @param VC The call to add.
+ *  @param Existing Optionally receives the duplicate call already in the array.
+ *
+ *  @remark
+ *  Behaves like vc_array_add() but does not scan the whole array.
+ */
+ERR_VALUE vc_array_add_indexed(PGEN_ARRAY_VARIANT_CALL Array, PVC_INDEX Index, const VARIANT_CALL *VC, PVARIANT_CALL *Existing)
+{
+	size_t pos = 0;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = vc_index_find(Index, VC, &pos);
+	if (ret == ERR_SUCCESS) {
+		PVARIANT_CALL tmp = Array->Data + pos;
+
+		if (VC->AltWeight > tmp->AltWeight) {
+			variant_call_finit(tmp);
+			memcpy(tmp, VC, sizeof(VARIANT_CALL));
+		} else {
+			if (Existing != NULL)
+				*Existing = tmp;
+
+			ret = ERR_ALREADY_EXISTS;
+		}
+	} else if (ret == ERR_NOT_FOUND) {
+		ret = dym_array_push_back_VARIANT_CALL(Array, *VC);
+		if (ret == ERR_SUCCESS) {
+			ret = vc_index_insert(Index, gen_array_size(Array) - 1);
+			if (ret != ERR_SUCCESS)
+				dym_array_pop_back_VARIANT_CALL(Array);
+		}
+	}
+
+	return ret;
+}
+
+
 void vc_array_finit(PGEN_ARRAY_VARIANT_CALL Array)
 {
 	vc_array_clear(Array);
@@ -275,64 +424,90 @@ void vc_array_sort(PGEN_ARRAY_VARIANT_CALL Array)
 }
 
 
+/** @brief
+ *  Merges sorted per-thread arrays into one, removing duplicate calls.
+ *
+ *  @param Dest Array receiving the calls.
+ *  @param Sources Arrays to merge. They are sorted and emptied by the routine.
+ *  @param SourceCount Number of source arrays.
+ *
+ *  @remark
+ *  The calls are taken in order of their positions by using a heap of the sources
+ *  and duplicates are detected through a hash index of the destination, so the merge
+ *  takes O(n log SourceCount) time.
+ */
 ERR_VALUE vc_array_merge(PGEN_ARRAY_VARIANT_CALL Dest, PGEN_ARRAY_VARIANT_CALL Sources, const size_t SourceCount)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 	size_t *indices = NULL;
-	size_t *counts = NULL;
-	size_t remainingCount = SourceCount;
+	size_t *heap = NULL;
+	size_t heapSize = 0;
+	size_t totalCount = gen_array_size(Dest);
+	VC_INDEX index;
 
 	for (size_t i = 0; i < SourceCount; ++i) {
 		vc_array_sort(Sources + i);
-		if (gen_array_size(Sources + i) == 0)
-			--remainingCount;
+		totalCount += gen_array_size(Sources + i);
 	}
 
 	ret = ERR_SUCCESS;
-	if (remainingCount > 0) {
+	if (totalCount > gen_array_size(Dest)) {
 		ret = utils_calloc_size_t(SourceCount, &indices);
 		if (ret == ERR_SUCCESS) {
-			memset(indices, 0, SourceCount*sizeof(size_t));
-			ret = utils_calloc_size_t(SourceCount, &counts);
+			ret = utils_calloc_size_t(SourceCount, &heap);
 			if (ret == ERR_SUCCESS) {
-				for (size_t i = 0; i < SourceCount; ++i)
-					counts[i] = gen_array_size(Sources + i);
+				ret = vc_index_init(Dest, totalCount, &index);
+				if (ret == ERR_SUCCESS) {
+					for (size_t i = 0; i < gen_array_size(Dest); ++i) {
+						size_t pos = 0;
+
+						if (vc_index_find(&index, Dest->Data + i, &pos) == ERR_NOT_FOUND)
+							ret = vc_index_insert(&index, i);
+
+						if (ret != ERR_SUCCESS)
+							break;
+					}
+
+					if (ret == ERR_SUCCESS)
+						ret = dym_array_reserve_VARIANT_CALL(Dest, totalCount);
 
-				size_t minSourceIndex = 0;
-				uint64_t minValue = (uint64_t)-1;
-				PVARIANT_CALL minVc = NULL;
-				
-				while (ret == ERR_SUCCESS && remainingCount > 0) {
-					minValue = UINT64_MAX;
 					for (size_t i = 0; i < SourceCount; ++i) {
-						if (indices[i] < counts[i]) {
-							PVARIANT_CALL vc = dym_array_item_VARIANT_CALL(Sources + i, indices[i]);
-
-							if (vc->Pos < minValue) {
-								minValue = vc->Pos;
-								minSourceIndex = i;
-								minVc = vc;
-							}
+						if (gen_array_size(Sources + i) > 0) {
+							heap[heapSize] = i;
+							++heapSize;
 						}
 					}
 
-					if (minValue != UINT64_MAX) {
-						ret = vc_array_add(Dest, minVc, NULL);
+					for (size_t i = heapSize / 2; i > 0; --i)
+						_vc_merge_heap_down(heap, heapSize, i - 1, Sources, indices);
+
+					while (ret == ERR_SUCCESS && heapSize > 0) {
+						const size_t s = heap[0];
+						PVARIANT_CALL vc = dym_array_item_VARIANT_CALL(Sources + s, indices[s]);
+
+						ret = vc_array_add_indexed(Dest, &index, vc, NULL);
 						if (ret == ERR_ALREADY_EXISTS) {
-							variant_call_finit(minVc);
+							variant_call_finit(vc);
 							ret = ERR_SUCCESS;
 						}
 
-						indices[minSourceIndex]++;
-						if (indices[minSourceIndex] == counts[minSourceIndex])
-							--remainingCount;
+						indices[s]++;
+						if (indices[s] == gen_array_size(Sources + s)) {
+							--heapSize;
+							heap[0] = heap[heapSize];
+						}
+
+						if (heapSize > 0)
+							_vc_merge_heap_down(heap, heapSize, 0, Sources, indices);
 					}
+
+					vc_index_finit(&index);
 				}
 
 				for (size_t i = 0; i < SourceCount; ++i)
 					dym_array_clear_VARIANT_CALL(Sources + i);
 
-				utils_free(counts);
+				utils_free(heap);
 			}
 
 			utils_free(indices);
@@ -358,33 +533,62 @@ void vc_array_map_to_edges(PGEN_ARRAY_VARIANT_CALL VCArray)
 }
 
 
-ERR_VALUE vc_array_intersection(GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIANT_CALL *A2, PGEN_ARRAY_VARIANT_CALL Intersection)
+/** @brief
+ *  Adds copies of calls present in both arrays to the third one.
+ *
+ *  @param A1 The first array.
+ *  @param A2 The second array.
+ *  @param Intersection Array receiving the common calls.
+ *  @param IntersectionIndex Index of the @Intersection array, kept by the caller
+ *  between the calls.
+ *
+ *  @remark
+ *  Calls of @A2 are looked up through a hash index. Duplicates within @Intersection
+ *  are found through its persistent index, which is only extended by calls appended
+ *  since the previous use, so the work does not grow with the size of @Intersection.
+ */
+ERR_VALUE vc_array_intersection(GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIANT_CALL *A2, PGEN_ARRAY_VARIANT_CALL Intersection, PVC_INDEX IntersectionIndex)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 	const VARIANT_CALL *v1 = A1->Data;
-	
-	for (size_t i = 0; i < gen_array_size(A1); ++i) {
-		const VARIANT_CALL *v2 = A2->Data;
+	VC_INDEX a2Index;
+	size_t pos = 0;
 
-		for (size_t j = 00; j < gen_array_size(A2); ++j) {			
-			if (variant_call_equal(v1, v2)) {
-				VARIANT_CALL tmp;
+	ret = vc_index_init(A2, gen_array_size(A2), &a2Index);
+	if (ret == ERR_SUCCESS) {
+		for (size_t i = 0; i < gen_array_size(A2); ++i) {
+			if (vc_index_find(&a2Index, A2->Data + i, &pos) == ERR_NOT_FOUND)
+				ret = vc_index_insert(&a2Index, i);
 
-				ret = variant_call_init(v1->Chrom, v1->Pos, v1->ID, v1->Ref, strlen(v1->Ref), v1->Alt, strlen(v1->Alt), v1->Qual, &v1->RefReads, &v1->AltReads, &tmp);
-				if (ret == ERR_SUCCESS) {
-					tmp.KMerSize = min(v1->KMerSize, v2->KMerSize);
-					tmp.BinProb = v1->BinProb;
-					tmp.RefWeight = v1->RefWeight;
-					tmp.AltWeight = v1->AltWeight;
-					if (vc_array_add(Intersection, &tmp, NULL) != ERR_SUCCESS)
-						variant_call_finit(&tmp);
+			if (ret != ERR_SUCCESS)
+				break;
+		}
+
+		if (ret == ERR_SUCCESS) {
+			ret = vc_index_update(IntersectionIndex);
+			if (ret == ERR_SUCCESS) {
+				for (size_t i = 0; ret == ERR_SUCCESS && i < gen_array_size(A1); ++i) {
+					if (vc_index_find(&a2Index, v1, &pos) == ERR_SUCCESS) {
+						const VARIANT_CALL *v2 = A2->Data + pos;
+						VARIANT_CALL tmp;
+
+						ret = variant_call_init(v1->Chrom, v1->Pos, v1->ID, v1->Ref, strlen(v1->Ref), v1->Alt, strlen(v1->Alt), v1->Qual, &v1->RefReads, &v1->AltReads, &tmp);
+						if (ret == ERR_SUCCESS) {
+							tmp.KMerSize = min(v1->KMerSize, v2->KMerSize);
+							tmp.BinProb = v1->BinProb;
+							tmp.RefWeight = v1->RefWeight;
+							tmp.AltWeight = v1->AltWeight;
+							if (vc_array_add_indexed(Intersection, IntersectionIndex, &tmp, NULL) != ERR_SUCCESS)
+								variant_call_finit(&tmp);
+						}
+					}
+
+					++v1;
 				}
 			}
-
-			++v2;
 		}
 
-		++v1;
+		vc_index_finit(&a2Index);
 	}
 
 	return ret;
@@ -429,3 +633,118 @@ ERR_VALUE vc_array_union(const GEN_ARRAY_VARIANT_CALL *A1, const GEN_ARRAY_VARIA
 	return ret;
 }
 
+
+/** @brief
+ *  Creates an empty index of variant calls.
+ *
+ *  @param Array Array the indexed calls are stored in.
+ *  @param CountHint Expected number of indexed calls.
+ *  @param Index Index to initialize.
+ */
+ERR_VALUE vc_index_init(const GEN_ARRAY_VARIANT_CALL *Array, const size_t CountHint, PVC_INDEX Index)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	Index->Array = Array;
+	Index->Count = 0;
+	Index->Covered = 0;
+	Index->Size = VC_INDEX_MINIMUM_SIZE;
+	while (Index->Size < 2 * CountHint)
+		Index->Size *= 2;
+
+	ret = utils_calloc_size_t(Index->Size, &Index->Slots);
+
+	return ret;
+}
+
+
+void vc_index_finit(PVC_INDEX Index)
+{
+	utils_free(Index->Slots);
+	Index->Slots = NULL;
+	Index->Size = 0;
+	Index->Count = 0;
+	Index->Covered = 0;
+
+	return;
+}
+
+
+/** @brief
+ *  Adds a call of the indexed array to the index.
+ *
+ *  @param Index The index.
+ *  @param Position Position of the call in the array.
+ *
+ *  @remark
+ *  The call must not be present in the index yet.
+ */
+ERR_VALUE vc_index_insert(PVC_INDEX Index, const size_t Position)
+{
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	if (2 * (Index->Count + 1) > Index->Size)
+		ret = _vc_index_grow(Index);
+
+	if (ret == ERR_SUCCESS) {
+		_vc_index_place(Index->Slots, Index->Size, _vc_hash(Index->Array->Data + Position), Position);
+		++Index->Count;
+		if (Position >= Index->Covered)
+			Index->Covered = Position + 1;
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Adds calls appended to the indexed array since the last update to the index.
+ *
+ *  @param Index The index.
+ *
+ *  @remark
+ *  Calls equal to an already indexed one are skipped. The calls already covered
+ *  by the index must stay at their positions.
+ */
+ERR_VALUE vc_index_update(PVC_INDEX Index)
+{
+	size_t pos = 0;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	while (ret == ERR_SUCCESS && Index->Covered < gen_array_size(Index->Array)) {
+		if (vc_index_find(Index, Index->Array->Data + Index->Covered, &pos) == ERR_NOT_FOUND)
+			ret = vc_index_insert(Index, Index->Covered);
+		else ++Index->Covered;
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Looks for a call equal to the given one.
+ *
+ *  @param Index The index.
+ *  @param VC The call to look for. It does not need to be stored in the indexed array.
+ *  @param Position Receives position of the indexed call within the array.
+ *
+ *  @return
+ *  ERR_SUCCESS if the call is found, ERR_NOT_FOUND otherwise.
+ */
+ERR_VALUE vc_index_find(const VC_INDEX *Index, const VARIANT_CALL *VC, size_t *Position)
+{
+	size_t slot = _vc_hash(VC) & (Index->Size - 1);
+	ERR_VALUE ret = ERR_NOT_FOUND;
+
+	while (Index->Slots[slot] != 0) {
+		if (variant_call_equal(Index->Array->Data + Index->Slots[slot] - 1, VC)) {
+			*Position = Index->Slots[slot] - 1;
+			ret = ERR_SUCCESS;
+			break;
+		}
+
+		slot = (slot + 1) & (Index->Size - 1);
+	}
+
+	return ret;
+}
@@ -0,0 +1,412 @@
+
+#include <stdint.h>
+#include <zlib.h>
+#include "err.h"
+#include "utils.h"
+#include "reads.h"
+#include "bam-file.h"
+
+
+/************************************************************************/
+/*                        HELPER FUNCTIONS                              */
+/************************************************************************/
+
+static const char _bamSeqTable[16] = {
+	'=', 'A', 'C', 'M', 'G', 'R', 'S', 'V', 'T', 'W', 'Y', 'H', 'K', 'D', 'B', 'N'
+};
+
+static const char _bamCigarTable[16] = {
+	'M', 'I', 'D', 'N', 'S', 'H', 'P', '=', 'X', '?', '?', '?', '?', '?', '?', '?'
+};
+
+
+static uint16_t _le16(const uint8_t *Data)
+{
+	return (uint16_t)(Data[0] | (Data[1] << 8));
+}
+
+
+static uint32_t _le32(const uint8_t *Data)
+{
+	return (uint32_t)Data[0] | ((uint32_t)Data[1] << 8) | ((uint32_t)Data[2] << 16) | ((uint32_t)Data[3] << 24);
+}
+
+
+static ERR_VALUE _bam_copy_string(const char *String, const size_t Length, char **Result)
+{
+	char *tmp = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_malloc((Length + 1)*sizeof(char), (void **)&tmp);
+	if (ret == ERR_SUCCESS) {
+		memcpy(tmp, String, Length*sizeof(char));
+		tmp[Length] = '\0';
+		*Result = tmp;
+	}
+
+	return ret;
+}
+
+
+static ERR_VALUE _bam_reference_name(const BAM_HEADER *Header, const int32_t RefId, const int32_t SameAs, char **Result)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (RefId < 0)
+		ret = _bam_copy_string("*", 1, Result);
+	else if (RefId == SameAs)
+		ret = _bam_copy_string("=", 1, Result);
+	else if ((size_t)RefId < Header->ReferenceCount)
+		ret = utils_copy_string(Header->ReferenceNames[RefId], Result);
+	else ret = ERR_SAM_INVALID_RNAME;
+
+	return ret;
+}
+
+
+static ERR_VALUE _bam_cigar_to_string(const uint8_t *Cigar, const uint32_t Count, char **Result)
+{
+	char *tmp = NULL;
+	char *c = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Count == 0)
+		return _bam_copy_string("*", 1, Result);
+
+	// Each operation takes at most 9 digits and the operation letter
+	ret = utils_malloc(Count * 11 + 1, (void **)&tmp);
+	if (ret == ERR_SUCCESS) {
+		c = tmp;
+		for (uint32_t i = 0; i < Count; ++i) {
+			const uint32_t op = _le32(Cigar + 4 * i);
+
+			c += sprintf(c, "%u%c", op >> 4, _bamCigarTable[op & 0xf]);
+		}
+
+		*Result = tmp;
+	}
+
+	return ret;
+}
+
+
+/************************************************************************/
+/*                     PUBLIC FUNCTIONS                                 */
+/************************************************************************/
+
+
+/** @brief
+ *  Checks the header of a BGZF block and determines the block size.
+ *
+ *  @param Header Start of the block, at least BGZF_HEADER_SIZE bytes.
+ *  @param Length Number of bytes available at @Header.
+ *  @param BlockSize Receives the total size of the compressed block.
+ *
+ *  @return
+ *  ERR_IO_ERROR if the data does not start a BGZF block.
+ */
+ERR_VALUE bgzf_block_size(const uint8_t *Header, const size_t Length, size_t *BlockSize)
+{
+	ERR_VALUE ret = ERR_IO_ERROR;
+
+	if (Length >= BGZF_HEADER_SIZE &&
+		Header[0] == 31 && Header[1] == 139 && Header[2] == 8 && (Header[3] & 4) != 0 &&
+		_le16(Header + 10) == 6 && Header[12] == 'B' && Header[13] == 'C' && _le16(Header + 14) == 2) {
+		*BlockSize = (size_t)_le16(Header + 16) + 1;
+		ret = ERR_SUCCESS;
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Decompresses one BGZF block.
+ *
+ *  @param Block The whole compressed block, including its header and footer.
+ *  @param BlockSize Size of the block.
+ *  @param Output Buffer of BGZF_MAX_BLOCK_SIZE bytes receiving the data.
+ *  @param OutputLength Receives number of decompressed bytes.
+ *
+ *  @remark
+ *  The CRC32 of the data is checked against the block footer.
+ */
+ERR_VALUE bgzf_block_inflate(const uint8_t *Block, const size_t BlockSize, uint8_t *Output, size_t *OutputLength)
+{
+	z_stream zs;
+	uint32_t expectedLength = 0;
+	ERR_VALUE ret = ERR_IO_ERROR;
+
+	if (BlockSize < BGZF_HEADER_SIZE + 8)
+		return ERR_IO_ERROR;
+
+	expectedLength = _le32(Block + BlockSize - 4);
+	if (expectedLength > BGZF_MAX_BLOCK_SIZE)
+		return ERR_IO_ERROR;
+
+	memset(&zs, 0, sizeof(zs));
+	zs.next_in = (Bytef *)(Block + BGZF_HEADER_SIZE);
+	zs.avail_in = (uInt)(BlockSize - BGZF_HEADER_SIZE - 8);
+	zs.next_out = Output;
+	zs.avail_out = BGZF_MAX_BLOCK_SIZE;
+	if (inflateInit2(&zs, -15) == Z_OK) {
+		if (inflate(&zs, Z_FINISH) == Z_STREAM_END && zs.total_out == expectedLength &&
+			crc32(crc32(0L, Z_NULL, 0), Output, (uInt)zs.total_out) == _le32(Block + BlockSize - 8)) {
+			*OutputLength = zs.total_out;
+			ret = ERR_SUCCESS;
+		}
+
+		inflateEnd(&zs);
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Locates the alignment record at the start of decompressed BAM data.
+ *
+ *  @param Data Start of the record (its block_size field).
+ *  @param Length Number of bytes available.
+ *  @param Record Receives address of the record body, following block_size.
+ *  @param RecordLength Receives size of the record body.
+ *
+ *  @return
+ *  ERR_NO_MORE_ENTRIES if the record is not complete.
+ */
+ERR_VALUE bam_next_record(const uint8_t *Data, const size_t Length, const uint8_t **Record, size_t *RecordLength)
+{
+	size_t len = 0;
+	ERR_VALUE ret = ERR_NO_MORE_ENTRIES;
+
+	if (Length >= 4) {
+		len = _le32(Data);
+		if (4 + len <= Length) {
+			*Record = Data + 4;
+			*RecordLength = len;
+			ret = ERR_SUCCESS;
+		}
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Parses the header of a decompressed BAM stream.
+ *
+ *  @param Data Start of the decompressed stream.
+ *  @param Length Number of bytes available.
+ *  @param Header Receives the reference names.
+ *  @param HeaderLength Receives size of the header, in bytes.
+ *
+ *  @return
+ *  ERR_NO_MORE_ENTRIES if more data is needed to parse the whole header,
+ *  ERR_IO_ERROR if the data is not a BAM stream.
+ */
+ERR_VALUE bam_header_parse(const uint8_t *Data, const size_t Length, PBAM_HEADER Header, size_t *HeaderLength)
+{
+	size_t offset = 0;
+	uint32_t refCount = 0;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Length < 12)
+		return (Length >= 4 && memcmp(Data, "BAM\1", 4) != 0) ? ERR_IO_ERROR : ERR_NO_MORE_ENTRIES;
+
+	if (memcmp(Data, "BAM\1", 4) != 0)
+		return ERR_IO_ERROR;
+
+	offset = 8 + (size_t)_le32(Data + 4);
+	if (offset + 4 > Length)
+		return ERR_NO_MORE_ENTRIES;
+
+	refCount = _le32(Data + offset);
+	offset += 4;
+	ret = ERR_SUCCESS;
+	for (uint32_t i = 0; i < refCount; ++i) {
+		if (offset + 4 > Length || offset + 8 + _le32(Data + offset) > Length) {
+			ret = ERR_NO_MORE_ENTRIES;
+			break;
+		}
+
+		offset += 8 + _le32(Data + offset);
+	}
+
+	if (ret == ERR_SUCCESS) {
+		memset(Header, 0, sizeof(BAM_HEADER));
+		if (refCount > 0)
+			ret = utils_calloc(refCount, sizeof(char *), (void **)&Header->ReferenceNames);
+
+		if (ret == ERR_SUCCESS) {
+			offset = 12 + (size_t)_le32(Data + 4);
+			for (uint32_t i = 0; i < refCount; ++i) {
+				const uint32_t nameLen = _le32(Data + offset);
+
+				ret = _bam_copy_string((const char *)Data + offset + 4, (nameLen > 0) ? nameLen - 1 : 0, Header->ReferenceNames + i);
+				if (ret != ERR_SUCCESS)
+					break;
+
+				Header->ReferenceCount++;
+				offset += 8 + nameLen;
+			}
+
+			if (ret == ERR_SUCCESS)
+				*HeaderLength = offset;
+			else bam_header_finit(Header);
+		}
+	}
+
+	return ret;
+}
+
+
+void bam_header_finit(PBAM_HEADER Header)
+{
+	for (size_t i = 0; i < Header->ReferenceCount; ++i)
+		utils_free(Header->ReferenceNames[i]);
+
+	if (Header->ReferenceNames != NULL)
+		utils_free(Header->ReferenceNames);
+
+	memset(Header, 0, sizeof(BAM_HEADER));
+
+	return;
+}
+
+
+/** @brief
+ *  Reads the alignment fields of a BAM record without creating the read.
+ *
+ *  @param Record The record, following its block_size field.
+ *  @param Length Value of the block_size field.
+ *  @param Summary Receives the fields.
+ *
+ *  @remark
+ *  The binary CIGAR is not converted, the CIGAR member lists only the clipping
+ *  operations the record contains (which is what read_stats_add() looks at).
+ */
+ERR_VALUE bam_record_summary(const uint8_t *Record, const size_t Length, PREAD_SAM_SUMMARY Summary)
+{
+	int32_t pos = 0;
+	uint32_t cigarCount = 0;
+	const uint8_t *cigar = NULL;
+	boolean softClipped = FALSE;
+	boolean hardClipped = FALSE;
+
+	if (Length < BAM_RECORD_FIXED_SIZE)
+		return ERR_IO_ERROR;
+
+	cigarCount = _le16(Record + 12);
+	cigar = Record + BAM_RECORD_FIXED_SIZE + Record[8];
+	if (cigar + 4 * cigarCount > Record + Length)
+		return ERR_SAM_INVALID_CIGAR;
+
+	pos = (int32_t)_le32(Record + 4);
+	Summary->Pos = (pos < 0) ? UINT64_MAX : (uint64_t)pos;
+	Summary->PosQuality = Record[9];
+	Summary->Flags.Value = _le16(Record + 14);
+	for (uint32_t i = 0; i < cigarCount; ++i) {
+		switch (_le32(cigar + 4 * i) & 0xf) {
+			case 4: softClipped = TRUE; break;
+			case 5: hardClipped = TRUE; break;
+		}
+	}
+
+	if (softClipped && hardClipped)
+		Summary->CIGAR = "SH";
+	else if (softClipped)
+		Summary->CIGAR = "S";
+	else if (hardClipped)
+		Summary->CIGAR = "H";
+	else Summary->CIGAR = "";
+
+	Summary->CIGARLength = strlen(Summary->CIGAR);
+
+	return ERR_SUCCESS;
+}
+
+
+/** @brief
+ *  Creates a read from a BAM record.
+ *
+ *  @param Record The record, following its block_size field.
+ *  @param Length Value of the block_size field.
+ *  @param Header Header of the BAM file.
+ *  @param Read Receives the read.
+ *
+ *  @remark
+ *  The read looks exactly as if read_create_from_sam_line() parsed the SAM form
+ *  of the record. Missing base qualities (0xff) are replaced by READ_TOP_QUALITY,
+ *  so only the MAPQ limits them.
+ */
+ERR_VALUE bam_record_to_read(const uint8_t *Record, const size_t Length, const BAM_HEADER *Header, PONE_READ Read)
+{
+	uint8_t nameLen = 0;
+	uint32_t cigarCount = 0;
+	uint32_t seqLen = 0;
+	size_t seqOffset = 0;
+	const uint8_t *name = Record + BAM_RECORD_FIXED_SIZE;
+	const uint8_t *cigar = NULL;
+	const uint8_t *seq = NULL;
+	const uint8_t *qual = NULL;
+	int32_t refId = 0;
+	int32_t pos = 0;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (Length < BAM_RECORD_FIXED_SIZE)
+		return ERR_IO_ERROR;
+
+	nameLen = Record[8];
+	cigarCount = _le16(Record + 12);
+	seqLen = _le32(Record + 16);
+	seqOffset = BAM_RECORD_FIXED_SIZE + nameLen + 4 * (size_t)cigarCount;
+	if (nameLen == 0 || seqOffset > Length || ((size_t)seqLen + 1) / 2 + seqLen > Length - seqOffset)
+		return ERR_IO_ERROR;
+
+	cigar = name + nameLen;
+	seq = Record + seqOffset;
+	qual = seq + (seqLen + 1) / 2;
+	memset(Read, 0, sizeof(ONE_READ));
+	ret = utils_malloc(sizeof(ONE_READ_EXTENSION), (void **)&Read->Extension);
+	if (ret == ERR_SUCCESS) {
+		memset(Read->Extension, 0, sizeof(ONE_READ_EXTENSION));
+		refId = (int32_t)_le32(Record);
+		pos = (int32_t)_le32(Record + 4);
+		Read->Pos = (pos < 0) ? UINT64_MAX : (uint64_t)pos;
+		Read->PosQuality = Record[9];
+		Read->Extension->Flags.Value = _le16(Record + 14);
+		Read->Extension->PNext = (uint64_t)((int64_t)(int32_t)_le32(Record + 24) + 1);
+		Read->Extension->TLen = (int32_t)_le32(Record + 28);
+		ret = _bam_copy_string((const char *)name, nameLen - 1, &Read->Extension->TemplateName);
+		if (ret == ERR_SUCCESS)
+			ret = _bam_reference_name(Header, refId, -1, &Read->Extension->RName);
+
+		if (ret == ERR_SUCCESS)
+			ret = _bam_reference_name(Header, (int32_t)_le32(Record + 20), refId, &Read->Extension->RNext);
+
+		if (ret == ERR_SUCCESS)
+			ret = _bam_cigar_to_string(cigar, cigarCount, &Read->Extension->CIGAR);
+
+		if (ret == ERR_SUCCESS)
+			ret = utils_malloc((seqLen + 1)*sizeof(char), (void **)&Read->ReadSequence);
+
+		if (ret == ERR_SUCCESS)
+			ret = utils_malloc((seqLen + 1)*sizeof(uint8_t), (void **)&Read->Quality);
+
+		if (ret == ERR_SUCCESS) {
+			for (uint32_t i = 0; i < seqLen; ++i) {
+				Read->ReadSequence[i] = _bamSeqTable[(seq[i / 2] >> ((i % 2 == 0) ? 4 : 0)) & 0xf];
+				Read->Quality[i] = (qual[i] == 0xff) ? READ_TOP_QUALITY : qual[i];
+			}
+
+			Read->ReadSequence[seqLen] = '\0';
+			Read->Quality[seqLen] = '\0';
+			Read->ReadSequenceLen = seqLen;
+		}
+
+		if (ret != ERR_SUCCESS)
+			_read_destroy_structure(Read);
+	}
+
+	return ret;
+}
@@ -0,0 +1,39 @@
+
+#ifndef __GASSM_BAM_FILE_H__
+#define __GASSM_BAM_FILE_H__
+
+
+#include <stdint.h>
+#include "err.h"
+#include "utils.h"
+#include "reads.h"
+
+
+/** Size of the fixed part of a BGZF block header. */
+#define BGZF_HEADER_SIZE						18
+/** Maximum size of a BGZF block, both compressed and decompressed. */
+#define BGZF_MAX_BLOCK_SIZE						65536
+
+/** Size of the fixed part of a BAM alignment record (without the block_size field). */
+#define BAM_RECORD_FIXED_SIZE					32
+
+
+/** Reference sequence names from the BAM header, indexed by refID. */
+typedef struct _BAM_HEADER {
+	size_t ReferenceCount;
+	char **ReferenceNames;
+} BAM_HEADER, *PBAM_HEADER;
+
+
+ERR_VALUE bgzf_block_size(const uint8_t *Header, const size_t Length, size_t *BlockSize);
+ERR_VALUE bgzf_block_inflate(const uint8_t *Block, const size_t BlockSize, uint8_t *Output, size_t *OutputLength);
+
+ERR_VALUE bam_next_record(const uint8_t *Data, const size_t Length, const uint8_t **Record, size_t *RecordLength);
+ERR_VALUE bam_header_parse(const uint8_t *Data, const size_t Length, PBAM_HEADER Header, size_t *HeaderLength);
+void bam_header_finit(PBAM_HEADER Header);
+ERR_VALUE bam_record_summary(const uint8_t *Record, const size_t Length, PREAD_SAM_SUMMARY Summary);
+ERR_VALUE bam_record_to_read(const uint8_t *Record, const size_t Length, const BAM_HEADER *Header, PONE_READ Read);
+
+
+
+#endif
@@ -72,6 +72,7 @@ typedef int ERR_VALUE;
 
 #define ERR_REF_REPEATS							62
 #define ERR_PLOT_FINISHED						63
+#define ERR_CANCELLED							64
 
 
 
@@ -4,10 +4,14 @@
 #include <assert.h>
 #include "err.h"
 #include "utils.h"
+#include "khash.h"
 #include "file-utils.h"
 #include "options.h"
 #include "gen_dym_array.h"
 #include "reads.h"
+#include "kthread.h"
+#include "bam-file.h"
+#include "read-store.h"
 #include "input-file.h"
 
 
@@ -245,148 +249,1090 @@ void fasta_free(PFASTA_FILE FastaRecord)
 }
 
 
-ERR_VALUE input_get_reads(const char *Filename, const char *InputType, PONE_READ *Reads, size_t *ReadCount)
+/************************************************************************/
+/*                     READ SORTING                                     */
+/************************************************************************/
+
+/** Bits of the position processed by one pass of the radix sort. */
+#define READ_SORT_DIGIT_BITS					8
+#define READ_SORT_BUCKETS						(1 << READ_SORT_DIGIT_BITS)
+/** Blocks smaller than this are not worth a thread of their own. */
+#define READ_SORT_MIN_BLOCK						4096
+
+/** Sort key of a read, the position and index of the read in the unsorted array. */
+typedef struct _READ_SORT_KEY {
+	uint64_t Pos;
+	size_t Index;
+} READ_SORT_KEY, *PREAD_SORT_KEY;
+
+UTILS_TYPED_CALLOC_FUNCTION(READ_SORT_KEY)
+
+/** The keys are split into contiguous blocks, each pass of the sort processes
+ *  one block per thread. */
+typedef struct _READ_SORT_CONTEXT {
+	const ONE_READ *Reads;
+	PONE_READ Sorted;
+	PREAD_SORT_KEY Source;
+	PREAD_SORT_KEY Target;
+	size_t Count;
+	size_t BlockCount;
+	/** Maximum position within each block. */
+	uint64_t *BlockMax;
+	/** Bucket sizes of each block, turned into target offsets before scattering. */
+	size_t *Histograms;
+	uint32_t Shift;
+} READ_SORT_CONTEXT, *PREAD_SORT_CONTEXT;
+
+
+static void _read_sort_block(const READ_SORT_CONTEXT *Context, const long Block, size_t *Start, size_t *End)
+{
+	*Start = Context->Count * (size_t)Block / Context->BlockCount;
+	*End = Context->Count * ((size_t)Block + 1) / Context->BlockCount;
+
+	return;
+}
+
+
+static void _read_sort_keys_worker(void *Data, long Index, size_t ThreadNo)
+{
+	PREAD_SORT_CONTEXT c = (PREAD_SORT_CONTEXT)Data;
+	uint64_t maxPos = 0;
+	size_t start = 0;
+	size_t end = 0;
+
+	_read_sort_block(c, Index, &start, &end);
+	for (size_t i = start; i < end; ++i) {
+		c->Source[i].Pos = c->Reads[i].Pos;
+		c->Source[i].Index = i;
+		if (maxPos < c->Reads[i].Pos)
+			maxPos = c->Reads[i].Pos;
+	}
+
+	c->BlockMax[Index] = maxPos;
+
+	return;
+}
+
+
+static void _read_sort_count_worker(void *Data, long Index, size_t ThreadNo)
+{
+	PREAD_SORT_CONTEXT c = (PREAD_SORT_CONTEXT)Data;
+	size_t *h = c->Histograms + Index*READ_SORT_BUCKETS;
+	size_t start = 0;
+	size_t end = 0;
+
+	_read_sort_block(c, Index, &start, &end);
+	memset(h, 0, READ_SORT_BUCKETS*sizeof(size_t));
+	for (size_t i = start; i < end; ++i)
+		++h[(c->Source[i].Pos >> c->Shift) & (READ_SORT_BUCKETS - 1)];
+
+	return;
+}
+
+
+static void _read_sort_scatter_worker(void *Data, long Index, size_t ThreadNo)
+{
+	PREAD_SORT_CONTEXT c = (PREAD_SORT_CONTEXT)Data;
+	size_t *h = c->Histograms + Index*READ_SORT_BUCKETS;
+	size_t start = 0;
+	size_t end = 0;
+
+	_read_sort_block(c, Index, &start, &end);
+	for (size_t i = start; i < end; ++i) {
+		const size_t d = (c->Source[i].Pos >> c->Shift) & (READ_SORT_BUCKETS - 1);
+
+		c->Target[h[d]] = c->Source[i];
+		++h[d];
+	}
+
+	return;
+}
+
+
+static void _read_sort_gather_worker(void *Data, long Index, size_t ThreadNo)
 {
-	size_t dataLength = 0;
+	PREAD_SORT_CONTEXT c = (PREAD_SORT_CONTEXT)Data;
+	size_t start = 0;
+	size_t end = 0;
+
+	_read_sort_block(c, Index, &start, &end);
+	for (size_t i = start; i < end; ++i)
+		c->Sorted[i] = c->Reads[c->Source[i].Index];
+
+	return;
+}
+
+
+/** @brief
+ *  Sorts reads by their positions into another array.
+ *
+ *  @param Reads The reads to sort.
+ *  @param Count Number of the reads.
+ *  @param ThreadCount Number of threads to use.
+ *  @param Sorted Receives copies of the reads, ordered by their positions.
+ *
+ *  @remark
+ *  Only the compact position-index pairs are sorted, by a parallel LSD radix sort
+ *  processing 8 bits per pass, and the reads are moved just once at the end.
+ *  Passes above the highest bit of the maximal position are skipped. The sort is
+ *  stable, reads at the same position keep their order.
+ */
+static ERR_VALUE _read_sort_by_pos(const ONE_READ *Reads, const size_t Count, const size_t ThreadCount, PONE_READ Sorted)
+{
+	READ_SORT_CONTEXT ctx;
+	PREAD_SORT_KEY keys = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	char *data = NULL;
 
-	ret = utils_file_read(Filename, &data, &dataLength);
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.Reads = Reads;
+	ctx.Sorted = Sorted;
+	ctx.Count = Count;
+	ctx.BlockCount = max(min(ThreadCount, Count / READ_SORT_MIN_BLOCK), 1);
+	ret = utils_calloc_READ_SORT_KEY(2 * max(Count, 1), &keys);
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_uint64_t(ctx.BlockCount, &ctx.BlockMax);
+
+	if (ret == ERR_SUCCESS)
+		ret = utils_calloc_size_t(ctx.BlockCount*READ_SORT_BUCKETS, &ctx.Histograms);
+
 	if (ret == ERR_SUCCESS) {
-		const char *line = data;
-		ONE_READ oneRead;
-		GEN_ARRAY_ONE_READ readArray;
-		const char *lineEnd = _read_line(line);
-
-		dym_array_init_ONE_READ(&readArray, 140);
-		while (ret == ERR_SUCCESS && line != lineEnd) {
-			if (*line != '@') {
-				ret = read_create_from_sam_line(line, &oneRead);
-				if (ret == ERR_SUCCESS) {
-					ret = dym_array_push_back_ONE_READ(&readArray, oneRead);
-					if (ret != ERR_SUCCESS)
-						_read_destroy_structure(&oneRead);
+		const int threadCount = (int)ctx.BlockCount;
+		uint64_t maxPos = 0;
+
+		ctx.Source = keys;
+		ctx.Target = keys + Count;
+		kt_for(threadCount, _read_sort_keys_worker, &ctx, (long)ctx.BlockCount);
+		for (size_t i = 0; i < ctx.BlockCount; ++i)
+			maxPos = max(maxPos, ctx.BlockMax[i]);
+
+		for (ctx.Shift = 0; ctx.Shift < 64 && (maxPos >> ctx.Shift) != 0; ctx.Shift += READ_SORT_DIGIT_BITS) {
+			PREAD_SORT_KEY tmp = NULL;
+			size_t offset = 0;
+
+			kt_for(threadCount, _read_sort_count_worker, &ctx, (long)ctx.BlockCount);
+			// Blocks of the same bucket follow each other, so the sort stays stable
+			for (size_t d = 0; d < READ_SORT_BUCKETS; ++d) {
+				for (size_t b = 0; b < ctx.BlockCount; ++b) {
+					size_t *h = ctx.Histograms + b*READ_SORT_BUCKETS + d;
+					const size_t bucketSize = *h;
+
+					*h = offset;
+					offset += bucketSize;
 				}
 			}
 
-			line = _advance_to_next_line(lineEnd);
-			lineEnd = _read_line(line);
+			kt_for(threadCount, _read_sort_scatter_worker, &ctx, (long)ctx.BlockCount);
+			tmp = ctx.Source;
+			ctx.Source = ctx.Target;
+			ctx.Target = tmp;
 		}
 
+		kt_for(threadCount, _read_sort_gather_worker, &ctx, (long)ctx.BlockCount);
+	}
+
+	if (ctx.Histograms != NULL)
+		utils_free(ctx.Histograms);
+
+	if (ctx.BlockMax != NULL)
+		utils_free(ctx.BlockMax);
+
+	if (keys != NULL)
+		utils_free(keys);
+
+	return ret;
+}
+
+
+/************************************************************************/
+/*                     READ LOADING PIPELINE                            */
+/************************************************************************/
+
+/** Amount of input read at once. */
+#define READ_PIPELINE_CHUNK_SIZE				(8*1024*1024)
+
+/** Part of a chunk processed by one thread. */
+typedef struct _READ_SLICE {
+	/** SAM lines or BAM records of the slice, pointing into the chunk. */
+	const uint8_t *Data;
+	size_t Length;
+	/** Reads of the slice, in order of the input. */
+	GEN_ARRAY_ONE_READ Reads;
+	BAD_READS_STATISTICS Stats;
+	ERR_VALUE Result;
+} READ_SLICE, *PREAD_SLICE;
+
+UTILS_TYPED_CALLOC_FUNCTION(READ_SLICE)
+
+struct _READ_PIPELINE;
+
+/** Part of the input file travelling through the pipeline. */
+typedef struct _READ_CHUNK {
+	struct _READ_PIPELINE *Pipeline;
+	/** SAM: complete lines, null-terminated. BAM: complete BGZF blocks, replaced
+	    by complete alignment records after decompression. Released after parsing. */
+	uint8_t *Data;
+	size_t Length;
+	/** BAM only: offsets of the BGZF blocks within the compressed data
+	    and lengths of their decompressed data. */
+	size_t *BlockOffsets;
+	size_t *BlockLengths;
+	size_t BlockCount;
+	PREAD_SLICE Slices;
+	size_t SliceCount;
+	ERR_VALUE Result;
+} READ_CHUNK, *PREAD_CHUNK;
+
+POINTER_ARRAY_TYPEDEF(READ_CHUNK);
+POINTER_ARRAY_IMPLEMENTATION(READ_CHUNK)
+
+KHASH_MAP_INIT_STR(TemplateIds, size_t)
+
+typedef struct _READ_PIPELINE {
+	FILE *Stream;
+	const READ_LOAD_OPTIONS *Options;
+	boolean BAM;
+	/** Incomplete line or BGZF block at the end of the last chunk. */
+	uint8_t *Rest;
+	size_t RestLength;
+	boolean EndOfFile;
+	/** BAM only: decompressed data not forming a complete record yet. */
+	uint8_t *Pending;
+	size_t PendingLength;
+	boolean HeaderRead;
+	BAM_HEADER Header;
+	/** Parsed chunks in order of the file. */
+	POINTER_ARRAY_READ_CHUNK Chunks;
+	BAD_READS_STATISTICS Stats;
+	size_t ReadCount;
+	/** Template names seen so far and their numbers. */
+	khash_t(TemplateIds) *TemplateIds;
+	size_t TemplateCount;
+	ERR_VALUE Result;
+} READ_PIPELINE, *PREAD_PIPELINE;
+
+
+static void _read_prepare(PONE_READ Read, boolean UseCIGAR)
+{
+	if (UseCIGAR)
+		read_split(Read);
+
+	for (size_t j = 0; j < Read->ReadSequenceLen; ++j)
+		Read->Quality[j] = min(Read->Quality[j], Read->PosQuality);
+
+	return;
+}
+
+
+static void _read_chunk_destroy(PREAD_CHUNK Chunk)
+{
+	for (size_t i = 0; i < Chunk->SliceCount; ++i) {
+		PREAD_SLICE s = Chunk->Slices + i;
+
+		for (size_t j = 0; j < gen_array_size(&s->Reads); ++j)
+			_read_destroy_structure(s->Reads.Data + j);
+
+		dym_array_finit_ONE_READ(&s->Reads);
+	}
+
+	if (Chunk->Slices != NULL)
+		utils_free(Chunk->Slices);
+
+	if (Chunk->BlockOffsets != NULL)
+		utils_free(Chunk->BlockOffsets);
+
+	if (Chunk->Data != NULL)
+		utils_free(Chunk->Data);
+
+	utils_free(Chunk);
+
+	return;
+}
+
+
+/** Determines length of the complete BGZF blocks at the start of the data. */
+static ERR_VALUE _bgzf_complete_length(const uint8_t *Data, const size_t Length, size_t *Complete)
+{
+	size_t offset = 0;
+	size_t blockSize = 0;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	while (ret == ERR_SUCCESS && offset + BGZF_HEADER_SIZE <= Length) {
+		ret = bgzf_block_size(Data + offset, Length - offset, &blockSize);
 		if (ret == ERR_SUCCESS) {
-			PONE_READ tmpReads = NULL;
-			const size_t tmpReadCount = gen_array_size(&readArray);
+			if (offset + blockSize > Length)
+				break;
 
-			ret = utils_calloc_ONE_READ(tmpReadCount, &tmpReads);
-			if (ret == ERR_SUCCESS) {
-				memcpy(tmpReads, readArray.Data, gen_array_size(&readArray)*sizeof(ONE_READ));
-				*Reads = tmpReads;
-				*ReadCount = gen_array_size(&readArray);
+			offset += blockSize;
+		}
+	}
+
+	*Complete = offset;
+
+	return ret;
+}
+
+
+/** The first stage, reads a chunk of complete lines (SAM) or BGZF blocks (BAM).
+ *  Runs sequentially. */
+static PREAD_CHUNK _read_pipeline_read(PREAD_PIPELINE Pipeline)
+{
+	uint8_t *data = NULL;
+	size_t length = 0;
+	PREAD_CHUNK ret = NULL;
+
+	while (Pipeline->Result == ERR_SUCCESS && length == 0 && (!Pipeline->EndOfFile || Pipeline->RestLength > 0)) {
+		size_t bytesRead = 0;
+		size_t complete = 0;
+
+		Pipeline->Result = utils_malloc(Pipeline->RestLength + READ_PIPELINE_CHUNK_SIZE + 1, (void **)&data);
+		if (Pipeline->Result != ERR_SUCCESS)
+			break;
+
+		if (Pipeline->RestLength > 0)
+			memcpy(data, Pipeline->Rest, Pipeline->RestLength);
+
+		if (!Pipeline->EndOfFile) {
+			bytesRead = fread(data + Pipeline->RestLength, 1, READ_PIPELINE_CHUNK_SIZE, Pipeline->Stream);
+			if (bytesRead < READ_PIPELINE_CHUNK_SIZE) {
+				Pipeline->EndOfFile = TRUE;
+				if (ferror(Pipeline->Stream))
+					Pipeline->Result = ERR_IO_ERROR;
 			}
 		}
 
-		if (ret != ERR_SUCCESS) {
-			const size_t len = gen_array_size(&readArray);
+		length = Pipeline->RestLength + bytesRead;
+		if (Pipeline->Rest != NULL) {
+			utils_free(Pipeline->Rest);
+			Pipeline->Rest = NULL;
+			Pipeline->RestLength = 0;
+		}
 
-			for (size_t i = 0; i < len; ++i)
-				_read_destroy_structure((PONE_READ)dym_array_item_ONE_READ(&readArray, i));
+		if (Pipeline->BAM) {
+			if (Pipeline->Result == ERR_SUCCESS)
+				Pipeline->Result = _bgzf_complete_length(data, length, &complete);
+
+			if (Pipeline->Result == ERR_SUCCESS && Pipeline->EndOfFile && complete < length)
+				Pipeline->Result = ERR_IO_ERROR;
+		} else if (!Pipeline->EndOfFile) {
+			complete = length;
+			while (complete > 0 && data[complete - 1] != '\n')
+				--complete;
+		} else complete = length;
+
+		Pipeline->RestLength = length - complete;
+		if (Pipeline->Result == ERR_SUCCESS && Pipeline->RestLength > 0) {
+			Pipeline->Result = utils_malloc(Pipeline->RestLength, (void **)&Pipeline->Rest);
+			if (Pipeline->Result == ERR_SUCCESS)
+				memcpy(Pipeline->Rest, data + complete, Pipeline->RestLength);
+			else Pipeline->RestLength = 0;
 		}
 
-		dym_array_finit_ONE_READ(&readArray);
-		utils_free(data);
+		length = complete;
+		if (length == 0) {
+			utils_free(data);
+			data = NULL;
+		}
 	}
-	
+
+	if (Pipeline->Result == ERR_SUCCESS && length > 0) {
+		data[length] = '\0';
+		if (utils_malloc(sizeof(READ_CHUNK), (void **)&ret) == ERR_SUCCESS) {
+			memset(ret, 0, sizeof(READ_CHUNK));
+			ret->Pipeline = Pipeline;
+			ret->Data = data;
+			ret->Length = length;
+		} else Pipeline->Result = ERR_OUT_OF_MEMORY;
+	}
+
+	if (ret == NULL && data != NULL)
+		utils_free(data);
+
 	return ret;
 }
 
 
+static void _bgzf_inflate_worker(void *Data, long Index, size_t ThreadNo)
+{
+	size_t blockSize = 0;
+	size_t outputLength = 0;
+	PREAD_CHUNK c = (PREAD_CHUNK)Data;
+	const uint8_t *block = c->Data + c->BlockOffsets[Index];
+	uint8_t *output = c->Pipeline->Pending + Index*BGZF_MAX_BLOCK_SIZE;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	blockSize = c->BlockOffsets[Index + 1] - c->BlockOffsets[Index];
+	ret = bgzf_block_inflate(block, blockSize, output, &outputLength);
+	if (ret == ERR_SUCCESS)
+		c->BlockLengths[Index] = outputLength;
+	else c->Result = ret;
 
-ERR_VALUE input_filter_reads(const uint32_t KMerSize, const ONE_READ *Source, const size_t SourceCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_ONE_READ NewReads)
+	return;
+}
+
+
+/** The second stage of BAM input, decompresses the blocks in parallel and appends
+ *  the data to the pending (not yet complete) records. Runs sequentially. */
+static PREAD_CHUNK _read_pipeline_inflate(PREAD_PIPELINE Pipeline, PREAD_CHUNK Chunk)
 {
-	const ONE_READ *r = NULL;
+	size_t offset = 0;
+	size_t blockSize = 0;
+	uint8_t *output = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
-	size_t firstIndex = (size_t)-1;
-	size_t lastIndex = (size_t)-1;
-
-	int leftBorder = 0;
-	int rightBorder = SourceCount - 1;
-	int currIndex = SourceCount / 2;
-
-	while (leftBorder <= rightBorder) {
-		r = Source + currIndex;
-		if (in_range(RegionStart, RegionLength, r->Pos) || in_range(RegionStart, RegionLength, r->Pos + r->ReadSequenceLen)) {
-			while (r != Source && (in_range(RegionStart, RegionLength, r->Pos) || in_range(RegionStart, RegionLength, r->Pos + r->ReadSequenceLen)))
-				--r;
-
-			firstIndex = r - Source;
-			if (!in_range(RegionStart, RegionLength, r->Pos) && !in_range(RegionStart, RegionLength, r->Pos + r->ReadSequenceLen))
-				++firstIndex;
-
-			lastIndex = currIndex;
-			r = Source + currIndex;
-			while (lastIndex < SourceCount - 1 && (in_range(RegionStart, RegionLength, r->Pos) || in_range(RegionStart, RegionLength, r->Pos + r->ReadSequenceLen))) {
-				++r;
-				++lastIndex;
-			}
 
-			if (!in_range(RegionStart, RegionLength, r->Pos) && !in_range(RegionStart, RegionLength, r->Pos + r->ReadSequenceLen))
-				--lastIndex;
+	ret = utils_calloc_size_t(2 * (Chunk->Length / BGZF_HEADER_SIZE + 2), &Chunk->BlockOffsets);
+	if (ret == ERR_SUCCESS) {
+		Chunk->BlockLengths = Chunk->BlockOffsets + Chunk->Length / BGZF_HEADER_SIZE + 2;
+		while (offset < Chunk->Length) {
+			bgzf_block_size(Chunk->Data + offset, Chunk->Length - offset, &blockSize);
+			Chunk->BlockOffsets[Chunk->BlockCount] = offset;
+			++Chunk->BlockCount;
+			offset += blockSize;
+		}
 
-			break;
-		} else if (r->Pos >= RegionStart + RegionLength)
-			rightBorder = currIndex - 1;
-		else leftBorder = currIndex + 1;
+		Chunk->BlockOffsets[Chunk->BlockCount] = offset;
+		ret = utils_malloc(Pipeline->PendingLength + Chunk->BlockCount*BGZF_MAX_BLOCK_SIZE + 1, (void **)&output);
+		if (ret == ERR_SUCCESS) {
+			uint8_t *tmp = Pipeline->Pending;
+
+			// Inflate the blocks behind the pending data, each to its own slot
+			memcpy(output, Pipeline->Pending, Pipeline->PendingLength);
+			Pipeline->Pending = output + Pipeline->PendingLength;
+			Chunk->Result = ERR_SUCCESS;
+			kt_for(Pipeline->Options->ThreadCount, _bgzf_inflate_worker, Chunk, (long)Chunk->BlockCount);
+			Pipeline->Pending = tmp;
+			ret = Chunk->Result;
+			if (ret == ERR_SUCCESS) {
+				size_t length = Pipeline->PendingLength;
+
+				for (size_t i = 0; i < Chunk->BlockCount; ++i) {
+					memmove(output + length, output + Pipeline->PendingLength + i*BGZF_MAX_BLOCK_SIZE, Chunk->BlockLengths[i]);
+					length += Chunk->BlockLengths[i];
+				}
+
+				if (Pipeline->Pending != NULL)
+					utils_free(Pipeline->Pending);
 
-		currIndex = leftBorder + (rightBorder - leftBorder + 1) / 2;
+				Pipeline->Pending = NULL;
+				Pipeline->PendingLength = 0;
+				utils_free(Chunk->Data);
+				Chunk->Data = output;
+				Chunk->Length = length;
+			} else utils_free(output);
+		}
+
+		utils_free(Chunk->BlockOffsets);
+		Chunk->BlockOffsets = NULL;
+		Chunk->BlockLengths = NULL;
 	}
 
-	if (firstIndex != (size_t)-1 && lastIndex != (size_t)-1) {
-		ret = dym_array_reserve_ONE_READ(NewReads, lastIndex - firstIndex + 1);
+	// Skip the header and keep the incomplete record for the next chunk
+	if (ret == ERR_SUCCESS && !Pipeline->HeaderRead) {
+		size_t headerLength = 0;
+
+		ret = bam_header_parse(Chunk->Data, Chunk->Length, &Pipeline->Header, &headerLength);
 		if (ret == ERR_SUCCESS) {
-			r = Source + firstIndex;
-			for (size_t i = firstIndex; i <= lastIndex; ++i) {
-				ONE_READ tmp;
-
-				if (r->ReadSequenceLen > KMerSize) {
-					tmp = *r;
-					read_adjust(&tmp, RegionStart, RegionLength);
-					if (tmp.ReadSequenceLen > KMerSize)
-						dym_array_push_back_no_alloc_ONE_READ(NewReads, tmp);
+			Pipeline->HeaderRead = TRUE;
+			memmove(Chunk->Data, Chunk->Data + headerLength, Chunk->Length - headerLength);
+			Chunk->Length -= headerLength;
+		} else if (ret == ERR_NO_MORE_ENTRIES) {
+			ret = ERR_SUCCESS;
+			Pipeline->Pending = Chunk->Data;
+			Pipeline->PendingLength = Chunk->Length;
+			Chunk->Data = NULL;
+			Chunk->Length = 0;
+		}
+	}
+
+	if (ret == ERR_SUCCESS && Chunk->Length > 0) {
+		const uint8_t *record = NULL;
+		size_t recordLength = 0;
+
+		offset = 0;
+		while (bam_next_record(Chunk->Data + offset, Chunk->Length - offset, &record, &recordLength) == ERR_SUCCESS)
+			offset += 4 + recordLength;
+
+		Pipeline->PendingLength = Chunk->Length - offset;
+		if (Pipeline->PendingLength > 0) {
+			ret = utils_malloc(Pipeline->PendingLength, (void **)&Pipeline->Pending);
+			if (ret == ERR_SUCCESS)
+				memcpy(Pipeline->Pending, Chunk->Data + offset, Pipeline->PendingLength);
+			else Pipeline->PendingLength = 0;
+		}
+
+		Chunk->Length = offset;
+	}
+
+	Chunk->Result = ret;
+
+	return Chunk;
+}
+
+
+static void _read_slice_parse_sam(const READ_LOAD_OPTIONS *Options, PREAD_SLICE Slice)
+{
+	ONE_READ oneRead;
+	READ_SAM_SUMMARY summary;
+	const char *line = (const char *)Slice->Data;
+	const char *end = line + Slice->Length;
+	const char *lineEnd = _read_line(line);
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	while (ret == ERR_SUCCESS && line < end && line != lineEnd) {
+		if (*line != '@') {
+			boolean bad = FALSE;
+
+			if (Options->Filter) {
+				ret = read_sam_line_summary(line, &summary);
+				if (ret == ERR_SUCCESS)
+					bad = read_stats_add(&Slice->Stats, &summary, Options->MinQuality);
+			}
+
+			if (ret == ERR_SUCCESS && !bad) {
+				ret = read_create_from_sam_line(line, &oneRead);
+				if (ret == ERR_SUCCESS) {
+					if (Options->Filter)
+						_read_prepare(&oneRead, Options->UseCIGAR);
+
+					oneRead.ReadIndex = gen_array_size(&Slice->Reads);
+					ret = dym_array_push_back_ONE_READ(&Slice->Reads, oneRead);
+					if (ret != ERR_SUCCESS)
+						_read_destroy_structure(&oneRead);
 				}
+			}
+		}
 
-				++r;
+		line = _advance_to_next_line(lineEnd);
+		lineEnd = _read_line(line);
+	}
+
+	Slice->Result = ret;
+
+	return;
+}
+
+
+static void _read_slice_parse_bam(const READ_LOAD_OPTIONS *Options, const BAM_HEADER *Header, PREAD_SLICE Slice)
+{
+	ONE_READ oneRead;
+	READ_SAM_SUMMARY summary;
+	const uint8_t *record = NULL;
+	size_t recordLength = 0;
+	size_t offset = 0;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	while (ret == ERR_SUCCESS && bam_next_record(Slice->Data + offset, Slice->Length - offset, &record, &recordLength) == ERR_SUCCESS) {
+		boolean bad = FALSE;
+
+		if (Options->Filter) {
+			ret = bam_record_summary(record, recordLength, &summary);
+			if (ret == ERR_SUCCESS)
+				bad = read_stats_add(&Slice->Stats, &summary, Options->MinQuality);
+		}
+
+		if (ret == ERR_SUCCESS && !bad) {
+			ret = bam_record_to_read(record, recordLength, Header, &oneRead);
+			if (ret == ERR_SUCCESS) {
+				if (Options->Filter)
+					_read_prepare(&oneRead, Options->UseCIGAR);
+
+				oneRead.ReadIndex = gen_array_size(&Slice->Reads);
+				ret = dym_array_push_back_ONE_READ(&Slice->Reads, oneRead);
+				if (ret != ERR_SUCCESS)
+					_read_destroy_structure(&oneRead);
 			}
 		}
+
+		offset += 4 + recordLength;
+	}
+
+	Slice->Result = ret;
+
+	return;
+}
+
+
+static void _read_slice_worker(void *Data, long Index, size_t ThreadNo)
+{
+	PREAD_CHUNK c = (PREAD_CHUNK)Data;
+	PREAD_SLICE s = c->Slices + Index;
+
+	if (c->Pipeline->BAM)
+		_read_slice_parse_bam(c->Pipeline->Options, &c->Pipeline->Header, s);
+	else _read_slice_parse_sam(c->Pipeline->Options, s);
+
+	return;
+}
+
+
+/** Parses (and filters) the reads of a chunk. The chunk is split to one slice per
+ *  thread at line or record boundaries and the slices are parsed in parallel. */
+static PREAD_CHUNK _read_pipeline_parse(PREAD_PIPELINE Pipeline, PREAD_CHUNK Chunk)
+{
+	const size_t threadCount = max(Pipeline->Options->ThreadCount, 1);
+	size_t start = 0;
+	ERR_VALUE ret = Chunk->Result;
+
+	if (ret == ERR_SUCCESS && Chunk->Length > 0)
+		ret = utils_calloc_READ_SLICE(threadCount, &Chunk->Slices);
+
+	if (ret == ERR_SUCCESS && Chunk->Length > 0) {
+		for (size_t i = 0; i < threadCount && start < Chunk->Length; ++i) {
+			PREAD_SLICE s = Chunk->Slices + i;
+			size_t end = (i == threadCount - 1) ? Chunk->Length : Chunk->Length * (i + 1) / threadCount;
+
+			// Chunks shorter than the thread count leave some slices empty
+			if (end <= start)
+				end = start + 1;
+
+			if (Pipeline->BAM) {
+				const uint8_t *record = NULL;
+				size_t recordLength = 0;
+				size_t offset = start;
+
+				while (offset < end && bam_next_record(Chunk->Data + offset, Chunk->Length - offset, &record, &recordLength) == ERR_SUCCESS)
+					offset += 4 + recordLength;
+
+				end = offset;
+			} else {
+				while (end < Chunk->Length && Chunk->Data[end - 1] != '\n')
+					++end;
+			}
+
+			s->Data = Chunk->Data + start;
+			s->Length = end - start;
+			dym_array_init_ONE_READ(&s->Reads, 140);
+			++Chunk->SliceCount;
+			start = end;
+		}
+
+		kt_for((int)Chunk->SliceCount, _read_slice_worker, Chunk, (long)Chunk->SliceCount);
+		for (size_t i = 0; i < Chunk->SliceCount; ++i) {
+			if (ret == ERR_SUCCESS)
+				ret = Chunk->Slices[i].Result;
+		}
+	}
+
+	if (Chunk->Data != NULL) {
+		utils_free(Chunk->Data);
+		Chunk->Data = NULL;
+	}
+
+	Chunk->Result = ret;
+
+	return Chunk;
+}
+
+
+/** Numbers the templates in order of their first reads within the file. */
+static ERR_VALUE _read_pipeline_template_ids(PREAD_PIPELINE Pipeline, PREAD_SLICE Slice)
+{
+	int r = 0;
+	khiter_t it;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	for (size_t i = 0; i < gen_array_size(&Slice->Reads); ++i) {
+		PONE_READ_EXTENSION e = Slice->Reads.Data[i].Extension;
+
+		e->TemplateId = 0;
+		if (e->TemplateName == NULL || *e->TemplateName == '\0')
+			continue;
+
+		it = kh_put(TemplateIds, Pipeline->TemplateIds, e->TemplateName, &r);
+		if (r == -1) {
+			ret = ERR_OUT_OF_MEMORY;
+			break;
+		}
+
+		if (r != 0) {
+			++Pipeline->TemplateCount;
+			kh_value(Pipeline->TemplateIds, it) = Pipeline->TemplateCount;
+		}
+
+		e->TemplateId = kh_value(Pipeline->TemplateIds, it);
+	}
+
+	return ret;
+}
+
+
+/** The last stage, collects the chunks in order of the file and assigns template
+ *  numbers to their reads. Runs sequentially. */
+static void _read_pipeline_collect(PREAD_PIPELINE Pipeline, PREAD_CHUNK Chunk)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = pointer_array_push_back_READ_CHUNK(&Pipeline->Chunks, Chunk);
+	if (ret == ERR_SUCCESS) {
+		ret = Chunk->Result;
+		for (size_t i = 0; i < Chunk->SliceCount; ++i) {
+			read_stats_merge(&Pipeline->Stats, &Chunk->Slices[i].Stats);
+			Pipeline->ReadCount += gen_array_size(&Chunk->Slices[i].Reads);
+			if (ret == ERR_SUCCESS)
+				ret = _read_pipeline_template_ids(Pipeline, Chunk->Slices + i);
+		}
+	} else _read_chunk_destroy(Chunk);
+
+	if (Pipeline->Result == ERR_SUCCESS)
+		Pipeline->Result = ret;
+
+	return;
+}
+
+
+/** SAM input is read, parsed and collected; BAM input gets an extra stage
+ *  decompressing the blocks after they are read. */
+static void *_read_pipeline_step(void *Shared, int Step, void *Data)
+{
+	void *ret = NULL;
+	PREAD_PIPELINE p = (PREAD_PIPELINE)Shared;
+
+	if (!p->BAM && Step > 0)
+		++Step;
+
+	switch (Step) {
+		case 0:
+			ret = _read_pipeline_read(p);
+			break;
+		case 1:
+			ret = _read_pipeline_inflate(p, (PREAD_CHUNK)Data);
+			break;
+		case 2:
+			ret = _read_pipeline_parse(p, (PREAD_CHUNK)Data);
+			break;
+		case 3:
+			_read_pipeline_collect(p, (PREAD_CHUNK)Data);
+			break;
 	}
 
 	return ret;
 }
 
 
-void input_free_filtered_reads(PONE_READ Reads, size_t Count)
+/** Concatenates the slices in order of the input and sorts the reads by their
+ *  positions. The slices are emptied. */
+static ERR_VALUE _read_pipeline_merge(PREAD_PIPELINE Pipeline, PONE_READ *Reads, size_t *ReadCount)
 {
-	for (size_t i = 0; i < Count; ++i) {
-		if (Reads[i].SeqsReloacated) {
-			utils_free(Reads[i].ReadSequence - Reads[i].Offset);
-			utils_free(Reads[i].Quality - Reads[i].Offset);
+	PONE_READ unsorted = NULL;
+	PONE_READ tmpReads = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_calloc_ONE_READ(max(Pipeline->ReadCount, 1), &unsorted);
+	if (ret == ERR_SUCCESS) {
+		PONE_READ r = unsorted;
+
+		for (size_t i = 0; i < pointer_array_size(&Pipeline->Chunks); ++i) {
+			PREAD_CHUNK c = Pipeline->Chunks.Data[i];
+
+			for (size_t j = 0; j < c->SliceCount; ++j) {
+				PREAD_SLICE s = c->Slices + j;
+
+				memcpy(r, s->Reads.Data, gen_array_size(&s->Reads)*sizeof(ONE_READ));
+				r += gen_array_size(&s->Reads);
+				dym_array_finit_ONE_READ(&s->Reads);
+				dym_array_init_ONE_READ(&s->Reads, 140);
+			}
 		}
+
+		ret = utils_calloc_ONE_READ(max(Pipeline->ReadCount, 1), &tmpReads);
+		if (ret == ERR_SUCCESS) {
+			ret = _read_sort_by_pos(unsorted, Pipeline->ReadCount, Pipeline->Options->ThreadCount, tmpReads);
+			if (ret == ERR_SUCCESS) {
+				for (size_t i = 0; i < Pipeline->ReadCount; ++i)
+					tmpReads[i].ReadIndex = i;
+
+				*Reads = tmpReads;
+				*ReadCount = Pipeline->ReadCount;
+			}
+
+			if (ret != ERR_SUCCESS)
+				utils_free(tmpReads);
+		}
+
+		// The slices are empty now, the reads must not be lost on failure
+		if (ret != ERR_SUCCESS)
+			read_set_destroy(unsorted, Pipeline->ReadCount);
+		else utils_free(unsorted);
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Determines type of a file with reads by looking at its first bytes.
+ *
+ *  @param Filename Path to the file.
+ *
+ *  @return
+ *  "cache" for read caches created by read_store_save(), "bam" for
+ *  BGZF-compressed files, "sam" otherwise. Read caches are not loaded by
+ *  input_load_reads(), they are mapped by read_store_map().
+ */
+const char *input_guess_reads_type(const char *Filename)
+{
+	FILE *f = NULL;
+	uint8_t magic[BGZF_HEADER_SIZE];
+	size_t blockSize = 0;
+	const char *ret = "sam";
+
+	if (read_store_is_cache(Filename))
+		ret = "cache";
+	else if (utils_fopen(Filename, FOPEN_MODE_READ, &f) == ERR_SUCCESS) {
+		if (fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+			bgzf_block_size(magic, sizeof(magic), &blockSize) == ERR_SUCCESS)
+			ret = "bam";
+
+		utils_fclose(f);
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Loads reads from a SAM or BAM file.
+ *
+ *  @param Filename Path to the file.
+ *  @param InputType Type of the input, "sam" or "bam".
+ *  @param Options Number of threads and filtering options.
+ *  @param Stats Optionally receives statistics of bad reads. Computed only when
+ *  the reads are filtered.
+ *  @param Reads Receives the reads, sorted by their positions.
+ *  @param ReadCount Receives number of the reads.
+ *
+ *  @remark
+ *  The file is processed in chunks by a pipeline: chunks are read sequentially,
+ *  BGZF blocks of BAM input are decompressed in parallel, each chunk is parsed
+ *  (and filtered) by all threads and the reads are sorted by a parallel radix
+ *  sort at the end, so the whole file is never held in memory. When filtering
+ *  is requested, bad reads are skipped before they are created and the good ones
+ *  are split by their CIGAR strings and have their base qualities limited by
+ *  MAPQ, as input_filter_bad_reads() does. Templates are numbered from one in
+ *  order of their first reads, see TemplateId of the read extension.
+ */
+ERR_VALUE input_load_reads(const char *Filename, const char *InputType, const READ_LOAD_OPTIONS *Options, PBAD_READS_STATISTICS Stats, PONE_READ *Reads, size_t *ReadCount)
+{
+	READ_PIPELINE pipeline;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(&pipeline, 0, sizeof(pipeline));
+	if (strcasecmp(InputType, "bam") == 0)
+		pipeline.BAM = TRUE;
+	else if (strcasecmp(InputType, "sam") != 0)
+		return ERR_UNKNOWN_READS_INPUT_TYPE;
+
+	pipeline.Options = Options;
+	pointer_array_init_READ_CHUNK(&pipeline.Chunks, 140);
+	pipeline.TemplateIds = kh_init(TemplateIds);
+	ret = (pipeline.TemplateIds != NULL) ? ERR_SUCCESS : ERR_OUT_OF_MEMORY;
+	if (ret == ERR_SUCCESS)
+		ret = utils_fopen(Filename, FOPEN_MODE_READ, &pipeline.Stream);
+
+	if (ret == ERR_SUCCESS) {
+		pipeline.Result = ERR_SUCCESS;
+		kt_pipeline(2, _read_pipeline_step, &pipeline, pipeline.BAM ? 4 : 3);
+		ret = pipeline.Result;
+		if (ret == ERR_SUCCESS && pipeline.BAM && (!pipeline.HeaderRead || pipeline.PendingLength > 0))
+			ret = ERR_IO_ERROR;
+
+		if (ret == ERR_SUCCESS)
+			ret = _read_pipeline_merge(&pipeline, Reads, ReadCount);
+
+		if (ret == ERR_SUCCESS && Stats != NULL)
+			*Stats = pipeline.Stats;
+
+		for (size_t i = 0; i < pointer_array_size(&pipeline.Chunks); ++i)
+			_read_chunk_destroy(pipeline.Chunks.Data[i]);
+
+		if (pipeline.Pending != NULL)
+			utils_free(pipeline.Pending);
+
+		if (pipeline.Rest != NULL)
+			utils_free(pipeline.Rest);
+
+		if (pipeline.HeaderRead)
+			bam_header_finit(&pipeline.Header);
+
+		utils_fclose(pipeline.Stream);
+	}
+
+	if (pipeline.TemplateIds != NULL)
+		kh_destroy(TemplateIds, pipeline.TemplateIds);
+
+	pointer_array_finit_READ_CHUNK(&pipeline.Chunks);
+
+	return ret;
+}
+
+
+ERR_VALUE input_get_reads(const char *Filename, const char *InputType, PONE_READ *Reads, size_t *ReadCount)
+{
+	READ_LOAD_OPTIONS options;
+
+	memset(&options, 0, sizeof(options));
+	options.ThreadCount = 1;
+	options.Filter = FALSE;
+
+	return input_load_reads(Filename, InputType, &options, NULL, Reads, ReadCount);
+}
+
+
+
+/** Returns index of the first read starting at or after the given position. */
+static size_t _read_lower_bound(const ONE_READ *Reads, const size_t Count, const uint64_t Pos)
+{
+	size_t left = 0;
+	size_t right = Count;
+
+	while (left < right) {
+		const size_t mid = left + (right - left) / 2;
+
+		if (Reads[mid].Pos < Pos)
+			left = mid + 1;
+		else right = mid;
+	}
+
+	return left;
+}
+
+
+/** @brief
+ *  Prepares an index for locating reads overlapping windows of the reference.
+ *
+ *  @param Index The index to initialize.
+ *  @param Reads Reads sorted by their positions.
+ *  @param ReadCount Number of the reads.
+ *
+ *  @remark
+ *  The index remembers length of the longest read, so reads that may overlap
+ *  a window form a continuous range of the sorted array.
+ */
+void input_read_index_init(PREAD_INDEX Index, const ONE_READ *Reads, const size_t ReadCount)
+{
+	memset(Index, 0, sizeof(READ_INDEX));
+	Index->Reads = Reads;
+	Index->ReadCount = ReadCount;
+	for (size_t i = 0; i < ReadCount; ++i) {
+		if (Reads[i].Pos != (uint64_t)-1)
+			Index->MaxReadLength = max(Index->MaxReadLength, Reads[i].ReadSequenceLen);
 	}
 
 	return;
 }
 
 
-static int _read_comparator(const void *A, const void *B)
+/** @brief
+ *  Determines range of reads that may overlap a window of the reference.
+ *
+ *  @param Index The read index.
+ *  @param RegionStart Start of the window.
+ *  @param RegionLength Length of the window.
+ *  @param First Receives index of the first read of the range.
+ *  @param Count Receives number of reads in the range.
+ *
+ *  @remark
+ *  When the windows are queried in order of their starts, the range bounds only
+ *  move forward, so all windows of the reference are served by a single pass
+ *  over the reads. Otherwise, the bounds are found by a binary search. Reads
+ *  of the range still need to be checked by input_region_reads().
+ */
+void input_read_index_range(PREAD_INDEX Index, const uint64_t RegionStart, const size_t RegionLength, size_t *First, size_t *Count)
 {
-	const ONE_READ *rA = (const ONE_READ *)A;
-	const ONE_READ *rB = (const ONE_READ *)B;
+	const ONE_READ *r = Index->Reads;
+	const uint64_t regionEnd = RegionStart + RegionLength;
+
+	if (RegionStart < Index->LastStart) {
+		Index->First = _read_lower_bound(r, Index->ReadCount, (RegionStart > Index->MaxReadLength) ? RegionStart - Index->MaxReadLength : 0);
+		Index->Last = Index->First;
+	}
+
+	while (Index->First < Index->ReadCount && r[Index->First].Pos < RegionStart && RegionStart - r[Index->First].Pos > Index->MaxReadLength)
+		++Index->First;
+
+	if (Index->Last < Index->First)
+		Index->Last = Index->First;
 
-	if (rA->Pos < rB->Pos)
-		return -1;
-	else if (rA->Pos > rB->Pos)
-		return 1;
+	while (Index->Last < Index->ReadCount && r[Index->Last].Pos < regionEnd)
+		++Index->Last;
 
-	return 0;
+	Index->LastStart = RegionStart;
+	*First = Index->First;
+	*Count = Index->Last - Index->First;
+
+	return;
+}
+
+
+/** @brief
+ *  Selects reads overlapping a window of the reference and clips them to it.
+ *
+ *  @param KMerSize Reads not longer than this after clipping are skipped.
+ *  @param Store Store holding the reads, or NULL if the reads own their data.
+ *  @param Reads Candidate reads, usually a range from input_read_index_range().
+ *  @param ReadCount Number of the candidates.
+ *  @param RegionStart Start of the window.
+ *  @param RegionLength Length of the window.
+ *  @param NewReads Receives views of the clipped reads.
+ *  @param Bases Receives the decoded bases the views point to when the reads
+ *  are kept in a store. Not used otherwise.
+ *
+ *  @remark
+ *  Once the arrays have grown large enough, no memory is allocated.
+ */
+ERR_VALUE input_region_reads(const uint32_t KMerSize, const READ_STORE *Store, const ONE_READ *Reads, const size_t ReadCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_READ_VIEW NewReads, PGEN_ARRAY_char Bases)
+{
+	const ONE_READ *r = Reads;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = dym_array_reserve_READ_VIEW(NewReads, ReadCount);
+	if (ret == ERR_SUCCESS && Store != NULL) {
+		size_t baseCount = 0;
+
+		for (size_t i = 0; i < ReadCount; ++i)
+			baseCount += Reads[i].ReadSequenceLen + 1;
+
+		dym_array_clear_char(Bases);
+		ret = dym_array_reserve_char(Bases, baseCount);
+	}
+
+	if (ret == ERR_SUCCESS) {
+		for (size_t i = 0; i < ReadCount; ++i) {
+			READ_VIEW tmp;
+
+			if (r->ReadSequenceLen > KMerSize && r->Pos < RegionStart + RegionLength && r->Pos + r->ReadSequenceLen >= RegionStart) {
+				read_view_init(&tmp, r, RegionStart, RegionLength);
+				if (tmp.ReadSequenceLen > KMerSize) {
+					if (Store != NULL) {
+						char *b = Bases->Data + gen_array_size(Bases);
+
+						read_store_get_bases(Store, r, tmp.Offset - r->Offset, tmp.ReadSequenceLen, b);
+						b[tmp.ReadSequenceLen] = '\0';
+						tmp.ReadSequence = b;
+						Bases->ValidLength += tmp.ReadSequenceLen + 1;
+					}
+
+					dym_array_push_back_no_alloc_READ_VIEW(NewReads, tmp);
+				}
+			}
+
+			++r;
+		}
+	}
+
+	return ret;
+}
+
+
+ERR_VALUE input_filter_reads(const uint32_t KMerSize, const ONE_READ *Source, const size_t SourceCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_READ_VIEW NewReads)
+{
+	READ_INDEX index;
+	size_t first = 0;
+	size_t count = 0;
+
+	input_read_index_init(&index, Source, SourceCount);
+	input_read_index_range(&index, RegionStart, RegionLength, &first, &count);
+
+	return input_region_reads(KMerSize, NULL, Source + first, count, RegionStart, RegionLength, NewReads, NULL);
 }
 
 
@@ -418,26 +1364,39 @@ void input_filter_bad_reads(PONE_READ Reads, size_t *Count, const uint8_t MinQua
 
 	int i = 0;
 #pragma omp parallel for shared(Reads)
-	for (i = 0; i < (int)readSetSize; ++i) {
-		PONE_READ r = Reads + i;
-
-		if (UseCIGAR)
-			read_split(r);
-		
-		for (size_t j = 0; j < r->ReadSequenceLen; ++j)
-			r->Quality[j] = min(r->Quality[j], r->PosQuality);
-	}
+	for (i = 0; i < (int)readSetSize; ++i)
+		_read_prepare(Reads + i, UseCIGAR);
 
 	*Count = readSetSize;
 
 	return;
 }
 
-void input_sort_reads(PONE_READ Reads, const size_t Count)
+/** @brief
+ *  Sorts reads by their positions, see _read_sort_by_pos().
+ *
+ *  @param Reads The reads to sort.
+ *  @param Count Number of the reads.
+ *  @param ThreadCount Number of threads to use.
+ *
+ *  @remark
+ *  Reads at the same position keep their order. The reads stay untouched on failure.
+ */
+ERR_VALUE input_sort_reads(PONE_READ Reads, const size_t Count, const size_t ThreadCount)
 {
-	qsort(Reads, Count, sizeof(ONE_READ), _read_comparator);
+	PONE_READ tmpReads = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	return;
+	ret = utils_calloc_ONE_READ(max(Count, 1), &tmpReads);
+	if (ret == ERR_SUCCESS) {
+		ret = _read_sort_by_pos(Reads, Count, ThreadCount, tmpReads);
+		if (ret == ERR_SUCCESS)
+			memcpy(Reads, tmpReads, Count*sizeof(ONE_READ));
+
+		utils_free(tmpReads);
+	}
+
+	return ret;
 }
 
 
@@ -5,6 +5,8 @@
 
 #include "gen_dym_array.h"
 #include "pointer_array.h"
+#include "reads.h"
+#include "read-store.h"
 
 
 typedef enum _EActiveRegionType {
@@ -38,16 +40,47 @@ typedef struct _REFSEQ_DATA {
 } REFSEQ_DATA, *PREFSEQ_DATA;
 
 
+/** Controls loading of reads by input_load_reads(). */
+typedef struct _READ_LOAD_OPTIONS {
+	/** Number of threads parsing the input. */
+	int ThreadCount;
+	/** Skip bad reads and prepare the good ones as input_filter_bad_reads() does. */
+	boolean Filter;
+	/** Minimum MAPQ of a good read. */
+	uint8_t MinQuality;
+	/** Split reads according to their CIGAR strings. */
+	boolean UseCIGAR;
+} READ_LOAD_OPTIONS, *PREAD_LOAD_OPTIONS;
+
+/** Locates reads overlapping windows of the reference, see input_read_index_range(). */
+typedef struct _READ_INDEX {
+	/** Reads sorted by their positions. */
+	const ONE_READ *Reads;
+	size_t ReadCount;
+	/** Length of the longest mapped read. */
+	size_t MaxReadLength;
+	/** Range of reads of the last window. */
+	size_t First;
+	size_t Last;
+	/** Start of the last window. */
+	uint64_t LastStart;
+} READ_INDEX, *PREAD_INDEX;
+
+
 ERR_VALUE fasta_load(const char *FileName, PFASTA_FILE FastaRecord);
 ERR_VALUE fasta_read_seq(PFASTA_FILE FastaRecord, PREFSEQ_DATA Data);
 void fasta_free_seq(PREFSEQ_DATA Data);
 void fasta_free(PFASTA_FILE FastaRecord);
 
 ERR_VALUE input_get_reads(const char *Filename, const char *InputType, PONE_READ *Reads, size_t *ReadCount);
-ERR_VALUE input_filter_reads(const uint32_t KMerSize, const ONE_READ *Source, const size_t SourceCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_ONE_READ NewReads);
-void input_free_filtered_reads(PONE_READ Reads, size_t Count);
+const char *input_guess_reads_type(const char *Filename);
+ERR_VALUE input_load_reads(const char *Filename, const char *InputType, const READ_LOAD_OPTIONS *Options, PBAD_READS_STATISTICS Stats, PONE_READ *Reads, size_t *ReadCount);
+void input_read_index_init(PREAD_INDEX Index, const ONE_READ *Reads, const size_t ReadCount);
+void input_read_index_range(PREAD_INDEX Index, const uint64_t RegionStart, const size_t RegionLength, size_t *First, size_t *Count);
+ERR_VALUE input_region_reads(const uint32_t KMerSize, const READ_STORE *Store, const ONE_READ *Reads, const size_t ReadCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_READ_VIEW NewReads, PGEN_ARRAY_char Bases);
+ERR_VALUE input_filter_reads(const uint32_t KMerSize, const ONE_READ *Source, const size_t SourceCount, const uint64_t RegionStart, const size_t RegionLength, PGEN_ARRAY_READ_VIEW NewReads);
 void input_filter_bad_reads(PONE_READ Reads, size_t *Count, const uint8_t MinQuality, boolean UseCIGAR);
-void input_sort_reads(PONE_READ Reads, const size_t Count);
+ERR_VALUE input_sort_reads(PONE_READ Reads, const size_t Count, const size_t ThreadCount);
 void input_free_reads(PONE_READ Reads, const size_t Count);
 ERR_VALUE input_refseq_to_regions(const char *RefSeq, const size_t RefSeqLen, PACTIVE_REGION *Regions, size_t *Count);
 ERR_VALUE input_get_region_by_offset(const PACTIVE_REGION Regions, const size_t Count, const uint64_t Offset, size_t *Index, uint64_t *RegionOffset);
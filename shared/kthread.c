@@ -398,4 +398,18 @@ void kt_pipeline(int n_threads, void *(*func)(void*, int, void*), void *shared_d
 	pthread_cond_destroy(&aux.cv);
 }
 
+#else
+
+void kt_pipeline(int n_threads, void *(*func)(void*, int, void*), void *shared_data, int n_steps)
+{
+	void *data;
+	int i;
+
+	// no pthreads, run the steps sequentially
+	while ((data = func(shared_data, 0, 0)) != 0) {
+		for (i = 1; i < n_steps && data; ++i)
+			data = func(shared_data, i, data);
+	}
+}
+
 #endif
\ No newline at end of file
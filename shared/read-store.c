@@ -0,0 +1,731 @@
+
+#include <stdint.h>
+#include <string.h>
+#include "err.h"
+#include "utils.h"
+#include "khash.h"
+#include "reads.h"
+#include "file-utils.h"
+#include "read-store.h"
+
+
+KHASH_SET_INIT_STR(RSStrings)
+KHASH_MAP_INIT_STR(RSOffsets, uint64_t)
+UTILS_TYPED_CALLOC_FUNCTION(ONE_READ_EXTENSION)
+UTILS_TYPED_CALLOC_FUNCTION(ONE_READ)
+
+
+/** Fixed-size header at the start of a read cache. All sections are aligned
+ *  to 8 bytes and their offsets are relative to the start of the file. */
+typedef struct _READ_CACHE_HEADER {
+	char Signature[8];
+	uint32_t Version;
+	uint32_t HeaderSize;
+	uint32_t RecordSize;
+	uint32_t ReadStrip;
+	uint8_t MinQuality;
+	uint8_t Reserved[7];
+	uint64_t ReadCount;
+	uint64_t BaseCount;
+	uint64_t StringsSize;
+	uint64_t RecordsOffset;
+	uint64_t BasesOffset;
+	uint64_t NMaskOffset;
+	uint64_t QualitiesOffset;
+	uint64_t StringsOffset;
+	/** BAD_READS_STATISTICS, field by field. */
+	uint64_t Stats[12];
+} READ_CACHE_HEADER, *PREAD_CACHE_HEADER;
+
+/** Marks a NULL string in a cache record. */
+#define READ_CACHE_NO_STRING				((uint64_t)-1)
+
+/** One read within a read cache, string fields are offsets to the string section. */
+typedef struct _READ_CACHE_RECORD {
+	uint64_t Pos;
+	uint64_t PNext;
+	uint64_t ReadIndex;
+	/** Offset of the first base (and quality) of the read. */
+	uint64_t BaseOffset;
+	uint64_t CIGAR;
+	uint64_t RName;
+	uint64_t RNext;
+	uint64_t TemplateName;
+	uint64_t TemplateId;
+	uint32_t Length;
+	uint32_t Offset;
+	int32_t TLen;
+	uint16_t Flags;
+	uint8_t PosQuality;
+	uint8_t NoEndStrip;
+} READ_CACHE_RECORD, *PREAD_CACHE_RECORD;
+
+
+/************************************************************************/
+/*                        HELPER FUNCTIONS                              */
+/************************************************************************/
+
+/** 2-bit codes of the bases, 4 marks bases stored as N. */
+static const uint8_t _baseToCode[256] = {
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+};
+
+static const char _codeToBase[4] = { 'A', 'C', 'G', 'T' };
+
+
+static size_t _read_store_offset(const READ_STORE *Store, const ONE_READ *Read)
+{
+	return (size_t)(Read->Quality - Store->Qualities);
+}
+
+
+static ERR_VALUE _read_store_copy_string(PREAD_STORE Store, const char *String, char **Result)
+{
+	char *tmp = NULL;
+	const size_t len = strlen(String);
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_arena_alloc(&Store->Strings, (len + 1)*sizeof(char), (void **)&tmp);
+	if (ret == ERR_SUCCESS) {
+		memcpy(tmp, String, (len + 1)*sizeof(char));
+		*Result = tmp;
+	}
+
+	return ret;
+}
+
+
+/** Returns a copy of the string shared by all its occurrences within the store. */
+static ERR_VALUE _read_store_intern(PREAD_STORE Store, khash_t(RSStrings) *Table, const char *String, char **Result)
+{
+	int r = 0;
+	khiter_t it;
+	char *tmp = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	if (String == NULL) {
+		*Result = NULL;
+		return ERR_SUCCESS;
+	}
+
+	it = kh_get(RSStrings, Table, String);
+	if (it == kh_end(Table)) {
+		ret = _read_store_copy_string(Store, String, &tmp);
+		if (ret == ERR_SUCCESS) {
+			it = kh_put(RSStrings, Table, tmp, &r);
+			if (r == -1)
+				ret = ERR_OUT_OF_MEMORY;
+
+			if (ret == ERR_SUCCESS) {
+				++Store->InternedCount;
+				*Result = tmp;
+			}
+		}
+	} else {
+		*Result = (char *)kh_key(Table, it);
+		ret = ERR_SUCCESS;
+	}
+
+	return ret;
+}
+
+
+static ERR_VALUE _read_store_move_extension(PREAD_STORE Store, khash_t(RSStrings) *Table, const ONE_READ_EXTENSION *Source, PONE_READ_EXTENSION Target)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	*Target = *Source;
+	ret = _read_store_intern(Store, Table, Source->CIGAR, &Target->CIGAR);
+	if (ret == ERR_SUCCESS)
+		ret = _read_store_intern(Store, Table, Source->RName, &Target->RName);
+
+	if (ret == ERR_SUCCESS)
+		ret = _read_store_intern(Store, Table, Source->RNext, &Target->RNext);
+
+	if (ret == ERR_SUCCESS) {
+		Target->TemplateName = NULL;
+		if (Source->TemplateName != NULL)
+			ret = _read_store_copy_string(Store, Source->TemplateName, &Target->TemplateName);
+	}
+
+	return ret;
+}
+
+
+static uint64_t _cache_align(const uint64_t Value)
+{
+	return (Value + 7) & ~(uint64_t)7;
+}
+
+
+static void _cache_stats_store(const BAD_READS_STATISTICS *Stats, uint64_t *Values)
+{
+	Values[0] = Stats->Total;
+	Values[1] = Stats->Paired;
+	Values[2] = Stats->BadTotal;
+	Values[3] = Stats->BadPosZero;
+	Values[4] = Stats->BadUnmapped;
+	Values[5] = Stats->BadPosQuality;
+	Values[6] = Stats->BadSupplementary;
+	Values[7] = Stats->BadDuplicate;
+	Values[8] = Stats->BadSecondaryAlignment;
+	Values[9] = Stats->SoftClippedGood;
+	Values[10] = Stats->HardClippedGood;
+	Values[11] = Stats->BothClippedGood;
+
+	return;
+}
+
+
+static void _cache_stats_load(const uint64_t *Values, PBAD_READS_STATISTICS Stats)
+{
+	Stats->Total = (size_t)Values[0];
+	Stats->Paired = (size_t)Values[1];
+	Stats->BadTotal = (size_t)Values[2];
+	Stats->BadPosZero = (size_t)Values[3];
+	Stats->BadUnmapped = (size_t)Values[4];
+	Stats->BadPosQuality = (size_t)Values[5];
+	Stats->BadSupplementary = (size_t)Values[6];
+	Stats->BadDuplicate = (size_t)Values[7];
+	Stats->BadSecondaryAlignment = (size_t)Values[8];
+	Stats->SoftClippedGood = (size_t)Values[9];
+	Stats->HardClippedGood = (size_t)Values[10];
+	Stats->BothClippedGood = (size_t)Values[11];
+
+	return;
+}
+
+
+/** Assigns an offset within the string section to a string, each distinct string is stored once. */
+static ERR_VALUE _cache_string_add(khash_t(RSOffsets) *Table, const char *String, uint64_t *Size)
+{
+	int r = 0;
+	khiter_t it;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	if (String != NULL) {
+		it = kh_put(RSOffsets, Table, String, &r);
+		if (r == -1)
+			ret = ERR_OUT_OF_MEMORY;
+		else if (r != 0) {
+			kh_value(Table, it) = *Size;
+			*Size += strlen(String) + 1;
+		}
+	}
+
+	return ret;
+}
+
+
+static uint64_t _cache_string_offset(const khash_t(RSOffsets) *Table, const char *String)
+{
+	uint64_t ret = READ_CACHE_NO_STRING;
+
+	if (String != NULL)
+		ret = kh_value(Table, kh_get(RSOffsets, Table, String));
+
+	return ret;
+}
+
+
+static ERR_VALUE _cache_write_padding(FILE *Stream, const uint64_t Size)
+{
+	const uint8_t zeros[8] = { 0 };
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	if (_cache_align(Size) != Size)
+		ret = utils_fwrite(zeros, 1, (size_t)(_cache_align(Size) - Size), Stream);
+
+	return ret;
+}
+
+
+static ERR_VALUE _cache_string_get(const READ_CACHE_HEADER *Header, const uint64_t Offset, char **String)
+{
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	*String = NULL;
+	if (Offset != READ_CACHE_NO_STRING) {
+		if (Offset < Header->StringsSize)
+			*String = (char *)Header + Header->StringsOffset + Offset;
+		else ret = ERR_OFFSET_TOO_HIGH;
+	}
+
+	return ret;
+}
+
+
+/** Checks that all sections of a mapped cache fit into the file. */
+static ERR_VALUE _cache_header_check(const READ_CACHE_HEADER *Header, const uint64_t FileSize)
+{
+	ERR_VALUE ret = ERR_TYPE_MISMATCH;
+
+	if (FileSize >= sizeof(READ_CACHE_HEADER) &&
+		memcmp(Header->Signature, READ_CACHE_SIGNATURE, sizeof(Header->Signature)) == 0 &&
+		Header->Version == READ_CACHE_VERSION &&
+		Header->HeaderSize == sizeof(READ_CACHE_HEADER) &&
+		Header->RecordSize == sizeof(READ_CACHE_RECORD)) {
+		ret = ERR_IO_ERROR;
+		if (Header->RecordsOffset + Header->ReadCount*sizeof(READ_CACHE_RECORD) <= Header->BasesOffset &&
+			Header->BasesOffset + ((Header->BaseCount + 31) / 32 + 1)*sizeof(uint64_t) <= Header->NMaskOffset &&
+			Header->NMaskOffset + ((Header->BaseCount + 63) / 64 + 1)*sizeof(uint64_t) <= Header->QualitiesOffset &&
+			Header->QualitiesOffset + Header->BaseCount + 1 <= Header->StringsOffset &&
+			Header->StringsOffset + Header->StringsSize <= FileSize &&
+			(Header->StringsSize == 0 || *((char *)Header + Header->StringsOffset + Header->StringsSize - 1) == '\0'))
+			ret = ERR_SUCCESS;
+	}
+
+	return ret;
+}
+
+
+/************************************************************************/
+/*                     PUBLIC FUNCTIONS                                 */
+/************************************************************************/
+
+
+/** @brief
+ *  Moves a read set into a compact store.
+ *
+ *  @param Store The store to initialize.
+ *  @param Reads The reads. Their sequences, qualities and extensions are moved
+ *  to the store and the original buffers are freed.
+ *  @param Count Number of the reads.
+ *
+ *  @remark
+ *  After the call, ReadSequence of every read is NULL, its bases are available
+ *  through read_store_get_bases(). Quality and Extension point into the store.
+ *  The reads must not be modified or destroyed by _read_destroy_structure(),
+ *  they are released together by read_store_finit(); the array itself is
+ *  still owned by the caller. On failure, the store is empty and the reads
+ *  are untouched.
+ */
+ERR_VALUE read_store_build(PREAD_STORE Store, PONE_READ Reads, const size_t Count)
+{
+	size_t baseCount = 0;
+	khash_t(RSStrings) *table = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Store, 0, sizeof(READ_STORE));
+	for (size_t i = 0; i < Count; ++i)
+		baseCount += Reads[i].ReadSequenceLen;
+
+	ret = utils_arena_init(&Store->Strings, UTILS_ARENA_DEFAULT_CHUNK_SIZE);
+	if (ret == ERR_SUCCESS) {
+		ret = utils_calloc_uint64_t((baseCount + 31) / 32 + 1, &Store->Bases);
+		if (ret == ERR_SUCCESS)
+			ret = utils_calloc_uint64_t((baseCount + 63) / 64 + 1, &Store->NMask);
+
+		if (ret == ERR_SUCCESS)
+			ret = utils_calloc_uint8_t(baseCount + 1, &Store->Qualities);
+
+		if (ret == ERR_SUCCESS)
+			ret = utils_calloc_ONE_READ_EXTENSION(max(Count, 1), &Store->Extensions);
+
+		if (ret == ERR_SUCCESS) {
+			table = kh_init(RSStrings);
+			if (table == NULL)
+				ret = ERR_OUT_OF_MEMORY;
+		}
+
+		// Copy everything first, so the reads stay intact if the store cannot be built
+		if (ret == ERR_SUCCESS) {
+			size_t offset = 0;
+			const ONE_READ *r = Reads;
+
+			for (size_t i = 0; i < Count; ++i) {
+				for (uint32_t j = 0; j < r->ReadSequenceLen; ++j) {
+					const uint8_t code = _baseToCode[(unsigned char)r->ReadSequence[j]];
+					const size_t b = offset + j;
+
+					if (code > 3)
+						Store->NMask[b / 64] |= (1ULL << (b % 64));
+					else Store->Bases[b / 32] |= ((uint64_t)code << (2 * (b % 32)));
+				}
+
+				memcpy(Store->Qualities + offset, r->Quality, r->ReadSequenceLen*sizeof(uint8_t));
+				ret = _read_store_move_extension(Store, table, r->Extension, Store->Extensions + i);
+				if (ret != ERR_SUCCESS)
+					break;
+
+				offset += r->ReadSequenceLen;
+				++r;
+			}
+		}
+
+		if (ret == ERR_SUCCESS) {
+			size_t offset = 0;
+			PONE_READ r = Reads;
+
+			for (size_t i = 0; i < Count; ++i) {
+				const uint32_t len = r->ReadSequenceLen;
+
+				_read_destroy_structure(r);
+				r->ReadSequence = NULL;
+				r->Quality = Store->Qualities + offset;
+				r->Extension = Store->Extensions + i;
+				offset += len;
+				++r;
+			}
+
+			Store->BaseCount = baseCount;
+			Store->ReadCount = Count;
+		}
+
+		if (table != NULL)
+			kh_destroy(RSStrings, table);
+
+		if (ret != ERR_SUCCESS)
+			read_store_finit(Store);
+	}
+
+	return ret;
+}
+
+
+void read_store_finit(PREAD_STORE Store)
+{
+	if (Store->Extensions != NULL)
+		utils_free(Store->Extensions);
+
+	if (Store->Mapping.Address != NULL)
+		utils_file_unmap(&Store->Mapping);
+	else {
+		if (Store->Qualities != NULL)
+			utils_free(Store->Qualities);
+
+		if (Store->NMask != NULL)
+			utils_free(Store->NMask);
+
+		if (Store->Bases != NULL)
+			utils_free(Store->Bases);
+	}
+
+	utils_arena_finit(&Store->Strings);
+	memset(Store, 0, sizeof(READ_STORE));
+
+	return;
+}
+
+
+char read_store_get_base(const READ_STORE *Store, const ONE_READ *Read, const uint32_t Index)
+{
+	const size_t b = _read_store_offset(Store, Read) + Index;
+	char ret = 'N';
+
+	if ((Store->NMask[b / 64] & (1ULL << (b % 64))) == 0)
+		ret = _codeToBase[(Store->Bases[b / 32] >> (2 * (b % 32))) & 3];
+
+	return ret;
+}
+
+
+/** @brief
+ *  Decodes a part of a read's sequence.
+ *
+ *  @param Store The store holding the read.
+ *  @param Read The read.
+ *  @param Start Index of the first base to decode.
+ *  @param Length Number of bases to decode.
+ *  @param Buffer Receives the bases. It is not null-terminated.
+ */
+void read_store_get_bases(const READ_STORE *Store, const ONE_READ *Read, const uint32_t Start, const uint32_t Length, char *Buffer)
+{
+	size_t b = _read_store_offset(Store, Read) + Start;
+	uint64_t word = Store->Bases[b / 32] >> (2 * (b % 32));
+
+	for (uint32_t i = 0; i < Length; ++i) {
+		if (b % 32 == 0)
+			word = Store->Bases[b / 32];
+
+		Buffer[i] = _codeToBase[word & 3];
+		if (Store->NMask[b / 64] & (1ULL << (b % 64)))
+			Buffer[i] = 'N';
+
+		word >>= 2;
+		++b;
+	}
+
+	return;
+}
+
+
+/** Returns number of bytes occupied by the store, the read array excluded. */
+size_t read_store_memory(const READ_STORE *Store)
+{
+	size_t ret = 0;
+
+	ret += ((Store->BaseCount + 31) / 32 + 1)*sizeof(uint64_t);
+	ret += ((Store->BaseCount + 63) / 64 + 1)*sizeof(uint64_t);
+	ret += (Store->BaseCount + 1)*sizeof(uint8_t);
+	ret += Store->ReadCount*sizeof(ONE_READ_EXTENSION);
+	ret += Store->Strings.BytesReserved;
+
+	return ret;
+}
+
+
+/** @brief
+ *  Writes a read set kept in a store into a read cache.
+ *
+ *  @param Store The store holding the reads.
+ *  @param Reads The reads, in the order they should be loaded back.
+ *  @param Count Number of the reads.
+ *  @param Info Preprocessing parameters and statistics saved together with the reads.
+ *  @param FileName Path to the cache file, it is overwritten.
+ *
+ *  @remark
+ *  The cache stores the reads exactly as they are, so they should be filtered,
+ *  sorted and stripped before. Numbers are stored in the native byte order,
+ *  read_store_map() refuses caches it does not understand.
+ */
+ERR_VALUE read_store_save(const READ_STORE *Store, const ONE_READ *Reads, const size_t Count, const READ_CACHE_INFO *Info, const char *FileName)
+{
+	FILE *f = NULL;
+	READ_CACHE_HEADER header;
+	khash_t(RSOffsets) *table = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Signature, READ_CACHE_SIGNATURE, sizeof(header.Signature));
+	header.Version = READ_CACHE_VERSION;
+	header.HeaderSize = sizeof(READ_CACHE_HEADER);
+	header.RecordSize = sizeof(READ_CACHE_RECORD);
+	header.ReadStrip = Info->ReadStrip;
+	header.MinQuality = Info->MinQuality;
+	header.ReadCount = Count;
+	header.BaseCount = Store->BaseCount;
+	_cache_stats_store(&Info->Stats, header.Stats);
+	table = kh_init(RSOffsets);
+	ret = (table != NULL) ? ERR_SUCCESS : ERR_OUT_OF_MEMORY;
+	for (size_t i = 0; i < Count; ++i) {
+		const ONE_READ_EXTENSION *e = Reads[i].Extension;
+
+		if (ret == ERR_SUCCESS)
+			ret = _cache_string_add(table, e->CIGAR, &header.StringsSize);
+
+		if (ret == ERR_SUCCESS)
+			ret = _cache_string_add(table, e->RName, &header.StringsSize);
+
+		if (ret == ERR_SUCCESS)
+			ret = _cache_string_add(table, e->RNext, &header.StringsSize);
+
+		if (ret == ERR_SUCCESS)
+			ret = _cache_string_add(table, e->TemplateName, &header.StringsSize);
+
+		if (ret != ERR_SUCCESS)
+			break;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		header.RecordsOffset = sizeof(READ_CACHE_HEADER);
+		header.BasesOffset = header.RecordsOffset + Count*sizeof(READ_CACHE_RECORD);
+		header.NMaskOffset = header.BasesOffset + ((Store->BaseCount + 31) / 32 + 1)*sizeof(uint64_t);
+		header.QualitiesOffset = header.NMaskOffset + ((Store->BaseCount + 63) / 64 + 1)*sizeof(uint64_t);
+		header.StringsOffset = _cache_align(header.QualitiesOffset + Store->BaseCount + 1);
+		ret = utils_fopen(FileName, FOPEN_MODE_WRITE, &f);
+		if (ret == ERR_SUCCESS) {
+			ret = utils_fwrite(&header, sizeof(header), 1, f);
+			for (size_t i = 0; i < Count; ++i) {
+				const ONE_READ *r = Reads + i;
+				READ_CACHE_RECORD record;
+
+				if (ret != ERR_SUCCESS)
+					break;
+
+				memset(&record, 0, sizeof(record));
+				record.Pos = r->Pos;
+				record.PNext = r->Extension->PNext;
+				record.ReadIndex = r->ReadIndex;
+				record.BaseOffset = _read_store_offset(Store, r);
+				record.CIGAR = _cache_string_offset(table, r->Extension->CIGAR);
+				record.RName = _cache_string_offset(table, r->Extension->RName);
+				record.RNext = _cache_string_offset(table, r->Extension->RNext);
+				record.TemplateName = _cache_string_offset(table, r->Extension->TemplateName);
+				record.TemplateId = r->Extension->TemplateId;
+				record.Length = r->ReadSequenceLen;
+				record.Offset = r->Offset;
+				record.TLen = r->Extension->TLen;
+				record.Flags = r->Extension->Flags.Value;
+				record.PosQuality = r->PosQuality;
+				record.NoEndStrip = r->NoEndStrip;
+				ret = utils_fwrite(&record, sizeof(record), 1, f);
+			}
+
+			if (ret == ERR_SUCCESS)
+				ret = utils_fwrite(Store->Bases, sizeof(uint64_t), (Store->BaseCount + 31) / 32 + 1, f);
+
+			if (ret == ERR_SUCCESS)
+				ret = utils_fwrite(Store->NMask, sizeof(uint64_t), (Store->BaseCount + 63) / 64 + 1, f);
+
+			if (ret == ERR_SUCCESS)
+				ret = utils_fwrite(Store->Qualities, sizeof(uint8_t), Store->BaseCount + 1, f);
+
+			if (ret == ERR_SUCCESS)
+				ret = _cache_write_padding(f, header.QualitiesOffset + Store->BaseCount + 1);
+
+			// Strings go in the order of their offsets, the table is not ordered
+			for (size_t i = 0; i < Count; ++i) {
+				const ONE_READ_EXTENSION *e = Reads[i].Extension;
+				const char *strings[4] = { e->CIGAR, e->RName, e->RNext, e->TemplateName };
+
+				if (ret != ERR_SUCCESS)
+					break;
+
+				for (size_t j = 0; j < sizeof(strings) / sizeof(strings[0]); ++j) {
+					khiter_t it;
+
+					if (strings[j] == NULL)
+						continue;
+
+					it = kh_get(RSOffsets, table, strings[j]);
+					if (kh_value(table, it) != READ_CACHE_NO_STRING) {
+						ret = utils_fwrite(strings[j], sizeof(char), strlen(strings[j]) + 1, f);
+						if (ret != ERR_SUCCESS)
+							break;
+
+						kh_value(table, it) = READ_CACHE_NO_STRING;
+					}
+				}
+			}
+
+			if (utils_fclose(f) != ERR_SUCCESS && ret == ERR_SUCCESS)
+				ret = ERR_IO_ERROR;
+		}
+	}
+
+	if (table != NULL)
+		kh_destroy(RSOffsets, table);
+
+	return ret;
+}
+
+
+/** @brief
+ *  Maps a read cache created by read_store_save() into memory.
+ *
+ *  @param FileName Path to the cache file.
+ *  @param Store Receives a store whose bases, N mask, qualities and strings
+ *  stay in the mapped file.
+ *  @param Reads Receives an array of the cached reads, in the order they were saved.
+ *  @param Count Receives number of the reads.
+ *  @param Info Receives the preprocessing parameters and statistics.
+ *
+ *  @remark
+ *  The mapping is read-only, the reads must not be modified. They are released
+ *  by read_store_finit() and utils_free() of the read array, as for a built store.
+ */
+ERR_VALUE read_store_map(const char *FileName, PREAD_STORE Store, PONE_READ *Reads, size_t *Count, PREAD_CACHE_INFO Info)
+{
+	PONE_READ tmpReads = NULL;
+	const READ_CACHE_HEADER *header = NULL;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Store, 0, sizeof(READ_STORE));
+	ret = utils_file_map(FileName, &Store->Mapping);
+	if (ret == ERR_SUCCESS) {
+		header = (const READ_CACHE_HEADER *)Store->Mapping.Address;
+		ret = _cache_header_check(header, Store->Mapping.Size);
+		if (ret == ERR_SUCCESS)
+			ret = utils_calloc_ONE_READ(max(header->ReadCount, 1), &tmpReads);
+
+		if (ret == ERR_SUCCESS)
+			ret = utils_calloc_ONE_READ_EXTENSION(max(header->ReadCount, 1), &Store->Extensions);
+
+		if (ret == ERR_SUCCESS) {
+			const uint8_t *base = (const uint8_t *)Store->Mapping.Address;
+			const READ_CACHE_RECORD *record = (const READ_CACHE_RECORD *)(base + header->RecordsOffset);
+
+			Store->Bases = (uint64_t *)(base + header->BasesOffset);
+			Store->NMask = (uint64_t *)(base + header->NMaskOffset);
+			Store->Qualities = (uint8_t *)(base + header->QualitiesOffset);
+			Store->BaseCount = header->BaseCount;
+			Store->ReadCount = header->ReadCount;
+			for (size_t i = 0; i < header->ReadCount; ++i) {
+				PONE_READ r = tmpReads + i;
+				PONE_READ_EXTENSION e = Store->Extensions + i;
+
+				if (record->BaseOffset + record->Length > header->BaseCount) {
+					ret = ERR_OFFSET_TOO_HIGH;
+					break;
+				}
+
+				ret = _cache_string_get(header, record->CIGAR, &e->CIGAR);
+				if (ret == ERR_SUCCESS)
+					ret = _cache_string_get(header, record->RName, &e->RName);
+
+				if (ret == ERR_SUCCESS)
+					ret = _cache_string_get(header, record->RNext, &e->RNext);
+
+				if (ret == ERR_SUCCESS)
+					ret = _cache_string_get(header, record->TemplateName, &e->TemplateName);
+
+				if (ret != ERR_SUCCESS)
+					break;
+
+				e->Flags.Value = record->Flags;
+				e->TLen = record->TLen;
+				e->PNext = record->PNext;
+				e->TemplateId = (size_t)record->TemplateId;
+				r->ReadSequenceLen = record->Length;
+				r->Quality = Store->Qualities + record->BaseOffset;
+				r->Pos = record->Pos;
+				r->PosQuality = record->PosQuality;
+				r->ReadIndex = (size_t)record->ReadIndex;
+				r->Offset = record->Offset;
+				r->Extension = e;
+				r->NoEndStrip = record->NoEndStrip;
+				++record;
+			}
+		}
+
+		if (ret == ERR_SUCCESS) {
+			Info->MinQuality = header->MinQuality;
+			Info->ReadStrip = header->ReadStrip;
+			_cache_stats_load(header->Stats, &Info->Stats);
+			*Reads = tmpReads;
+			*Count = header->ReadCount;
+		}
+
+		if (ret != ERR_SUCCESS) {
+			if (tmpReads != NULL)
+				utils_free(tmpReads);
+
+			read_store_finit(Store);
+		}
+	} else memset(Store, 0, sizeof(READ_STORE));
+
+	return ret;
+}
+
+
+/** Determines whether a file starts with the read cache signature. */
+boolean read_store_is_cache(const char *FileName)
+{
+	FILE *f = NULL;
+	char signature[8];
+	boolean ret = FALSE;
+
+	if (utils_fopen(FileName, FOPEN_MODE_READ, &f) == ERR_SUCCESS) {
+		ret = (fread(signature, 1, sizeof(signature), f) == sizeof(signature) &&
+			memcmp(signature, READ_CACHE_SIGNATURE, sizeof(signature)) == 0);
+		utils_fclose(f);
+	}
+
+	return ret;
+}
@@ -0,0 +1,65 @@
+
+#ifndef __GASSM_READ_STORE_H__
+#define __GASSM_READ_STORE_H__
+
+
+#include <stdint.h>
+#include "err.h"
+#include "utils.h"
+#include "reads.h"
+#include "file-utils.h"
+
+
+/** Compact storage of a read set that is not going to be modified.
+ *
+ *  Bases of all reads are kept in one array with two bits per base, bases other
+ *  than A, C, G and T are marked in the N mask and read back as N. Qualities
+ *  of all reads form one continuous array in the same order as the bases, so
+ *  a read's Quality pointer also determines where its bases start. Read
+ *  extensions are kept in one array, reference names and CIGAR strings are
+ *  interned and template names are packed together in an arena.
+ */
+typedef struct _READ_STORE {
+	/** 2-bit codes of the bases, 32 bases per word. */
+	uint64_t *Bases;
+	/** One bit per base, set for bases stored as N. */
+	uint64_t *NMask;
+	uint8_t *Qualities;
+	size_t BaseCount;
+	PONE_READ_EXTENSION Extensions;
+	size_t ReadCount;
+	/** Template names and interned strings. */
+	UTILS_ARENA Strings;
+	/** Number of distinct interned strings. */
+	size_t InternedCount;
+	/** Read cache the arrays point into, the Address is NULL for built stores. */
+	FUTILS_MAPPED_FILE Mapping;
+} READ_STORE, *PREAD_STORE;
+
+
+/** First bytes of a read cache file. */
+#define READ_CACHE_SIGNATURE				"GASRC\x1a\r\n"
+/** Incremented with every incompatible change of the read cache layout. */
+#define READ_CACHE_VERSION					2
+
+/** Parameters of the preprocessing the cached reads went through. */
+typedef struct _READ_CACHE_INFO {
+	uint8_t MinQuality;
+	uint32_t ReadStrip;
+	BAD_READS_STATISTICS Stats;
+} READ_CACHE_INFO, *PREAD_CACHE_INFO;
+
+
+ERR_VALUE read_store_build(PREAD_STORE Store, PONE_READ Reads, const size_t Count);
+void read_store_finit(PREAD_STORE Store);
+char read_store_get_base(const READ_STORE *Store, const ONE_READ *Read, const uint32_t Index);
+void read_store_get_bases(const READ_STORE *Store, const ONE_READ *Read, const uint32_t Start, const uint32_t Length, char *Buffer);
+size_t read_store_memory(const READ_STORE *Store);
+
+ERR_VALUE read_store_save(const READ_STORE *Store, const ONE_READ *Reads, const size_t Count, const READ_CACHE_INFO *Info, const char *FileName);
+ERR_VALUE read_store_map(const char *FileName, PREAD_STORE Store, PONE_READ *Reads, size_t *Count, PREAD_CACHE_INFO Info);
+boolean read_store_is_cache(const char *FileName);
+
+
+
+#endif
@@ -401,66 +401,174 @@ void read_destroy(PONE_READ Read)
 }
 
 
-void read_set_stats(const ONE_READ *Reads, const size_t Count, const uint8_t MinPosQuality, PBAD_READS_STATISTICS Stats)
+/** @brief
+ *  Reads the alignment fields of a SAM line.
+ *
+ *  @param Line The line.
+ *  @param Summary Receives the fields.
+ *
+ *  @remark
+ *  No memory is allocated, so the routine can decide about a read before
+ *  read_create_from_sam_line() materializes it.
+ */
+ERR_VALUE read_sam_line_summary(const char *Line, PREAD_SAM_SUMMARY Summary)
 {
-	memset(Stats, 0, sizeof(BAD_READS_STATISTICS));
-	Stats->Total = Count;
-	for (size_t i = 0; i < Count; ++i) {
-		if (Reads->Extension->Flags.Bits.Paired)
-			++Stats->Paired;
-		
-		if (Reads->Pos == UINT64_MAX ||
-			Reads->PosQuality < MinPosQuality ||
-			Reads->Extension->Flags.Bits.Unmapped ||
-			Reads->Extension->Flags.Bits.Supplementary ||
-			Reads->Extension->Flags.Bits.SecondaryAlignment ||
-			Reads->Extension->Flags.Bits.Duplicate) {
-			++Stats->BadTotal;
-			if (Reads->Pos == (uint64_t)-1LL)
-				++Stats->BadPosZero;
-
-			if (Reads->PosQuality < MinPosQuality)
-				++Stats->BadPosQuality;
-
-			if (Reads->Extension->Flags.Bits.Duplicate)
-				++Stats->BadDuplicate;
-
-			if (Reads->Extension->Flags.Bits.Supplementary)
-				++Stats->BadSupplementary;
-
-			if (Reads->Extension->Flags.Bits.SecondaryAlignment)
-				++Stats->BadSecondaryAlignment;
-
-			if (Reads->Extension->Flags.Bits.Unmapped)
-				++Stats->BadUnmapped;
-		} else {
-			boolean softClipped = FALSE;
-			boolean hardClipped = FALSE;
-			const char *cigar = Reads->Extension->CIGAR;
-			const size_t cigarLen = strlen(cigar);
-			
-			for (size_t j = 0; j < cigarLen; ++j) {
-				switch (cigar[j]) {
-					case 'H':
-						hardClipped = TRUE;
-						break;
-					case 'S':
-						softClipped = TRUE;
-						break;
-				}
-			}
+	uint32_t tmp32 = 0;
+	const char *end = NULL;
+	ERR_VALUE ret = ERR_SUCCESS;
+
+	end = _sam_read_field(Line);
+	if (end != Line && *end == '\t')
+		Line = end + 1;
+	else ret = ERR_SAM_INVALID_QNAME;
+
+	if (ret == ERR_SUCCESS) {
+		Line = _sam_read_uint_field(Line, &tmp32);
+		if (Line != NULL && *Line == '\t') {
+			++Line;
+			Summary->Flags.Value = (uint16_t)tmp32;
+		} else ret = ERR_SAM_INVALID_FLAG;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		end = _sam_read_field(Line);
+		if (end != Line && *end == '\t')
+			Line = end + 1;
+		else ret = ERR_SAM_INVALID_RNAME;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		Line = _sam_read_uint_field(Line, &tmp32);
+		if (Line != NULL && *Line == '\t') {
+			++Line;
+			Summary->Pos = tmp32;
+			Summary->Pos--;
+		} else ret = ERR_SAM_INVALID_POS;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		Line = _sam_read_uint_field(Line, &tmp32);
+		if (Line != NULL && *Line == '\t') {
+			++Line;
+			Summary->PosQuality = (uint8_t)tmp32;
+		} else ret = ERR_SAM_INVALID_MAPQ;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		end = _sam_read_field(Line);
+		if (end != Line && *end == '\t') {
+			Summary->CIGAR = Line;
+			Summary->CIGARLength = end - Line;
+		} else ret = ERR_SAM_INVALID_CIGAR;
+	}
+
+	return ret;
+}
+
 
-			if (hardClipped && softClipped)
-				++Stats->BothClippedGood;
-			else if (hardClipped)
-				++Stats->HardClippedGood;
-			else if (softClipped)
-				++Stats->SoftClippedGood;
+/** @brief
+ *  Accounts one read in the statistics.
+ *
+ *  @param Stats The statistics.
+ *  @param Summary Alignment fields of the read.
+ *  @param MinPosQuality Minimum MAPQ of a good read.
+ *
+ *  @return
+ *  TRUE if the read is bad and should be filtered out, FALSE otherwise.
+ */
+boolean read_stats_add(PBAD_READS_STATISTICS Stats, const READ_SAM_SUMMARY *Summary, const uint8_t MinPosQuality)
+{
+	boolean ret = FALSE;
+
+	++Stats->Total;
+	if (Summary->Flags.Bits.Paired)
+		++Stats->Paired;
+
+	ret = (Summary->Pos == UINT64_MAX ||
+		Summary->PosQuality < MinPosQuality ||
+		Summary->Flags.Bits.Unmapped ||
+		Summary->Flags.Bits.Supplementary ||
+		Summary->Flags.Bits.SecondaryAlignment ||
+		Summary->Flags.Bits.Duplicate);
+	if (ret) {
+		++Stats->BadTotal;
+		if (Summary->Pos == (uint64_t)-1LL)
+			++Stats->BadPosZero;
+
+		if (Summary->PosQuality < MinPosQuality)
+			++Stats->BadPosQuality;
+
+		if (Summary->Flags.Bits.Duplicate)
+			++Stats->BadDuplicate;
+
+		if (Summary->Flags.Bits.Supplementary)
+			++Stats->BadSupplementary;
+
+		if (Summary->Flags.Bits.SecondaryAlignment)
+			++Stats->BadSecondaryAlignment;
+
+		if (Summary->Flags.Bits.Unmapped)
+			++Stats->BadUnmapped;
+	} else {
+		boolean softClipped = FALSE;
+		boolean hardClipped = FALSE;
+
+		for (size_t j = 0; j < Summary->CIGARLength; ++j) {
+			switch (Summary->CIGAR[j]) {
+				case 'H':
+					hardClipped = TRUE;
+					break;
+				case 'S':
+					softClipped = TRUE;
+					break;
+			}
 		}
 
-		++Reads;
+		if (hardClipped && softClipped)
+			++Stats->BothClippedGood;
+		else if (hardClipped)
+			++Stats->HardClippedGood;
+		else if (softClipped)
+			++Stats->SoftClippedGood;
 	}
 
+	return ret;
+}
+
+
+void read_stats_merge(PBAD_READS_STATISTICS Target, const BAD_READS_STATISTICS *Source)
+{
+	Target->Total += Source->Total;
+	Target->Paired += Source->Paired;
+	Target->BadTotal += Source->BadTotal;
+	Target->BadPosZero += Source->BadPosZero;
+	Target->BadUnmapped += Source->BadUnmapped;
+	Target->BadPosQuality += Source->BadPosQuality;
+	Target->BadSupplementary += Source->BadSupplementary;
+	Target->BadDuplicate += Source->BadDuplicate;
+	Target->BadSecondaryAlignment += Source->BadSecondaryAlignment;
+	Target->SoftClippedGood += Source->SoftClippedGood;
+	Target->HardClippedGood += Source->HardClippedGood;
+	Target->BothClippedGood += Source->BothClippedGood;
+
+	return;
+}
+
+
+void read_set_stats(const ONE_READ *Reads, const size_t Count, const uint8_t MinPosQuality, PBAD_READS_STATISTICS Stats)
+{
+	READ_SAM_SUMMARY summary;
+
+	memset(Stats, 0, sizeof(BAD_READS_STATISTICS));
+	for (size_t i = 0; i < Count; ++i) {
+		summary.Flags = Reads->Extension->Flags;
+		summary.Pos = Reads->Pos;
+		summary.PosQuality = Reads->PosQuality;
+		summary.CIGAR = Reads->Extension->CIGAR;
+		summary.CIGARLength = strlen(Reads->Extension->CIGAR);
+		read_stats_add(Stats, &summary, MinPosQuality);
+		++Reads;
+	}
 
 	return;
 }
@@ -555,6 +663,48 @@ void read_adjust(PONE_READ Read, const uint64_t RegionStart, const size_t Region
 }
 
 
+/** @brief
+ *  Creates a view of a read clipped to a region, the same way read_adjust()
+ *  clips the read itself. Nothing is copied or allocated.
+ *
+ *  @param View Receives the clipped read. Its length is zero if the read does
+ *  not overlap the region.
+ *  @param Read The read.
+ *  @param RegionStart Start of the region.
+ *  @param RegionLength Length of the region.
+ */
+void read_view_init(PREAD_VIEW View, const ONE_READ *Read, const uint64_t RegionStart, const size_t RegionLength)
+{
+	uint32_t startStripped = 0;
+	uint32_t endStripped = 0;
+	const uint64_t regionEnd = RegionStart + RegionLength;
+
+	View->Read = Read;
+	View->ReadIndex = Read->ReadIndex;
+	View->ReadSequence = Read->ReadSequence;
+	View->Quality = Read->Quality;
+	View->ReadSequenceLen = Read->ReadSequenceLen;
+	View->Offset = Read->Offset;
+	View->RegionPos = 0;
+	if (Read->Pos < RegionStart)
+		startStripped = (uint32_t)min(RegionStart - Read->Pos, Read->ReadSequenceLen);
+	else View->RegionPos = (uint32_t)(Read->Pos - RegionStart);
+
+	if (Read->Pos + Read->ReadSequenceLen >= regionEnd)
+		endStripped = (uint32_t)min(Read->Pos + Read->ReadSequenceLen - regionEnd, Read->ReadSequenceLen - startStripped);
+
+	// Reads kept in a read store have no sequence, input_region_reads() decodes it
+	if (View->ReadSequence != NULL)
+		View->ReadSequence += startStripped;
+
+	View->Quality += startStripped;
+	View->Offset += startStripped;
+	View->ReadSequenceLen -= (startStripped + endStripped);
+
+	return;
+}
+
+
 void read_split(PONE_READ Read)
 {
 	READ_PART part;
@@ -681,7 +831,7 @@ ERR_VALUE read_append(PONE_READ Read, const char *Seq, const uint8_t *Quality, s
 /*                ASSEMBLY TATKS                                        */
 /************************************************************************/
 
-void assembly_task_init(PASSEMBLY_TASK Task, const char *RefSeq, const size_t RefSeqLen, const char *Alternate1, const size_t Alternate1Length, const char *Alternate2, const size_t Alternate2Length, const ONE_READ *ReadSet, const size_t ReadCount)
+void assembly_task_init(PASSEMBLY_TASK Task, const char *RefSeq, const size_t RefSeqLen, const char *Alternate1, const size_t Alternate1Length, const char *Alternate2, const size_t Alternate2Length, const READ_VIEW *ReadSet, const size_t ReadCount)
 {
 	memset(Task, 0, sizeof(ASSEMBLY_TASK));
 	Task->Allocated = FALSE;
@@ -701,7 +851,6 @@ void assembly_task_init(PASSEMBLY_TASK Task, const char *RefSeq, const size_t Re
 void assembly_task_finit(PASSEMBLY_TASK Task)
 {
 	if (Task->Allocated) {
-		read_set_destroy((PONE_READ)Task->Reads, Task->ReadCount);
 		utils_free((char *)Task->Alternate2);
 		utils_free((char *)Task->Alternate1);
 		utils_free((char *)Task->Reference);
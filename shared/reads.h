@@ -59,6 +59,9 @@ typedef struct _ONE_READ_EXTENSION {
 	int32_t TLen;
 	uint64_t PNext;
 	char *TemplateName;
+	/** Dense number of the template, assigned when the reads are loaded. Zero
+	    for reads without a template name. */
+	size_t TemplateId;
 } ONE_READ_EXTENSION, *PONE_READ_EXTENSION;
 
 typedef struct _ONE_READ {
@@ -72,9 +75,23 @@ typedef struct _ONE_READ {
 	PONE_READ_EXTENSION Extension;
 	uint32_t UnknownKMers;
 	boolean NoEndStrip;
-	boolean SeqsReloacated;
 } ONE_READ, *PONE_READ;
 
+/** A read clipped to an active region. The view owns no memory, its sequence
+ *  and qualities point into the read it was created from. */
+typedef struct _READ_VIEW {
+	const char *ReadSequence;
+	const uint8_t *Quality;
+	uint32_t ReadSequenceLen;
+	/** Number of bases clipped from the start of the read. */
+	uint32_t Offset;
+	/** Position of the first base, relative to the start of the region. */
+	uint32_t RegionPos;
+	/** Index of the read within the whole read set. */
+	size_t ReadIndex;
+	const ONE_READ *Read;
+} READ_VIEW, *PREAD_VIEW;
+
 typedef struct _ASSEMBLY_TASK {
 	boolean Allocated;
 	const char *Name;
@@ -84,13 +101,15 @@ typedef struct _ASSEMBLY_TASK {
 	size_t Alternate1Length;
 	const char *Alternate2;
 	size_t Alternate2Length;
-	const ONE_READ *Reads;
+	const READ_VIEW *Reads;
 	size_t ReadCount;
 	uint64_t RegionStart;
 } ASSEMBLY_TASK, *PASSEMBLY_TASK;
 
 GEN_ARRAY_TYPEDEF(ONE_READ);
 GEN_ARRAY_IMPLEMENTATION(ONE_READ)
+GEN_ARRAY_TYPEDEF(READ_VIEW);
+GEN_ARRAY_IMPLEMENTATION(READ_VIEW)
 POINTER_ARRAY_TYPEDEF(ONE_READ);
 POINTER_ARRAY_IMPLEMENTATION(ONE_READ)
 
@@ -110,6 +129,16 @@ typedef struct _BAD_READS_STATISTICS {
 	size_t BothClippedGood;
 } BAD_READS_STATISTICS, *PBAD_READS_STATISTICS;
 
+/** Alignment fields of a SAM line, obtained without creating the read. */
+typedef struct _READ_SAM_SUMMARY {
+	READ_FLAGS Flags;
+	uint64_t Pos;
+	uint8_t PosQuality;
+	/** Points into the line, not null-terminated. */
+	const char *CIGAR;
+	size_t CIGARLength;
+} READ_SAM_SUMMARY, *PREAD_SAM_SUMMARY;
+
 
 void read_quality_decode(PONE_READ Read);
 void read_quality_encode(PONE_READ Read);
@@ -117,6 +146,7 @@ void read_quality_encode(PONE_READ Read);
 void read_write_fastq(FILE *Stream, const ONE_READ *Read);
 void read_write_sam(FILE *Stream, const ONE_READ *Read);
 ERR_VALUE read_create_from_sam_line(const char *Line, PONE_READ Read);
+ERR_VALUE read_sam_line_summary(const char *Line, PREAD_SAM_SUMMARY Summary);
 ERR_VALUE read_create_from_fastq(const char *Block, const char **NewBlock, PONE_READ Read);
 
 void read_destroy(PONE_READ Read);
@@ -124,15 +154,18 @@ void _read_destroy_structure(PONE_READ Read);
 
 void read_set_stats(const ONE_READ *Reads, const size_t Count, const uint8_t MinPosQuality, PBAD_READS_STATISTICS Stats);
 void read_set_stats_print(FILE *Stream, const BAD_READS_STATISTICS *Stats);
+boolean read_stats_add(PBAD_READS_STATISTICS Stats, const READ_SAM_SUMMARY *Summary, const uint8_t MinPosQuality);
+void read_stats_merge(PBAD_READS_STATISTICS Target, const BAD_READS_STATISTICS *Source);
 
 void read_set_destroy(PONE_READ ReadSet, const size_t Count);
 ERR_VALUE read_set_merge(PONE_READ *Target, const size_t TargetCount, struct _ONE_READ *Source, const size_t SourceCount);
 void read_split(PONE_READ Read);
 void read_adjust(PONE_READ Read, const uint64_t RegionStart, const size_t RegionLength);
+void read_view_init(PREAD_VIEW View, const ONE_READ *Read, const uint64_t RegionStart, const size_t RegionLength);
 void read_shorten(PONE_READ Read, const uint32_t Count);
 ERR_VALUE read_append(PONE_READ Read, const char *Seq, const uint8_t *Quality, size_t Length);
 
-void assembly_task_init(PASSEMBLY_TASK Task, const char *RefSeq, const size_t RefSeqLen, const char *Alternate1, const size_t Alternate1Length, const char *Alternate2, const size_t Alternate2Length, const ONE_READ *ReadSet, const size_t ReadCount);
+void assembly_task_init(PASSEMBLY_TASK Task, const char *RefSeq, const size_t RefSeqLen, const char *Alternate1, const size_t Alternate1Length, const char *Alternate2, const size_t Alternate2Length, const READ_VIEW *ReadSet, const size_t ReadCount);
 void assembly_task_set_name(PASSEMBLY_TASK Task, const char *Name);
 void assembly_task_finit(PASSEMBLY_TASK Task);
 
@@ -0,0 +1,299 @@
+
+#include <stdint.h>
+#include <string.h>
+#include "err.h"
+#include "utils.h"
+#include "kthread.h"
+#include "input-file.h"
+#include "ref-profile.h"
+
+
+
+/************************************************************************/
+/*                        HELPER FUNCTIONS                              */
+/************************************************************************/
+
+/** Base of the rolling hash of the k-mers. */
+#define REF_HASH_BASE						0x100000001B3ULL
+
+
+/** Digit of the bases other than A, C, G and T, k-mers containing them are not compared. */
+#define REF_DIGIT_OTHER						5
+
+
+/** Digits of the rolling hash, bases other than A, C, G and T share one. */
+static const uint8_t _refDigits[256] = {
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 1, 5, 2, 5, 5, 5, 3, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 1, 5, 2, 5, 5, 5, 3, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+	5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+};
+
+
+static size_t _ref_table_size(const size_t Length)
+{
+	size_t ret = 16;
+
+	while (ret < 2 * Length)
+		ret <<= 1;
+
+	return ret;
+}
+
+
+static boolean _ref_kmer_equal(const char *A, const char *B, const uint32_t KMerSize)
+{
+	boolean ret = TRUE;
+
+	for (uint32_t i = 0; i < KMerSize; ++i) {
+		if (_refDigits[(unsigned char)A[i]] != _refDigits[(unsigned char)B[i]]) {
+			ret = FALSE;
+			break;
+		}
+	}
+
+	return ret;
+}
+
+
+/** Counts positions of a sequence whose k-mer occurs at a lower position too.
+ *
+ *  @remark
+ *  K-mers containing bases other than A, C, G and T are skipped. Each slot of the
+ *  table holds the upper half of the rolling hash of a k-mer and its position plus one,
+ *  so k-mers with equal hashes are compared base by base. The sequence must be shorter
+ *  than 4G bases. The table must have _ref_table_size(Length) zeroed slots, it is
+ *  left dirty.
+ */
+static uint32_t _ref_scan(const char *Sequence, const size_t Length, const uint32_t KMerSize, uint64_t *Table, const size_t TableSize, const boolean StopAtFirst)
+{
+	uint64_t h = 0;
+	uint64_t outWeight = 1;
+	uint32_t run = 0;
+	uint32_t ret = 0;
+
+	for (uint32_t i = 1; i < KMerSize; ++i)
+		outWeight *= REF_HASH_BASE;
+
+	for (size_t i = 0; i < Length; ++i) {
+		const uint8_t digit = _refDigits[(unsigned char)Sequence[i]];
+
+		if (i >= KMerSize)
+			h -= _refDigits[(unsigned char)Sequence[i - KMerSize]] * outWeight;
+
+		h = h*REF_HASH_BASE + digit;
+		run = (digit != REF_DIGIT_OTHER) ? run + 1 : 0;
+		if (run >= KMerSize) {
+			const size_t start = i + 1 - KMerSize;
+			size_t slot = (size_t)(((h ^ (h >> 29)) * 0x9E3779B97F4A7C15ULL) >> 7) & (TableSize - 1);
+			boolean found = FALSE;
+
+			// Zero marks free slots of the table
+			while (Table[slot] != 0) {
+				if ((Table[slot] >> 32) == (h >> 32) &&
+					_ref_kmer_equal(Sequence + (uint32_t)Table[slot] - 1, Sequence + start, KMerSize)) {
+					found = TRUE;
+					break;
+				}
+
+				slot = (slot + 1) & (TableSize - 1);
+			}
+
+			if (found) {
+				++ret;
+				if (StopAtFirst)
+					break;
+			} else Table[slot] = ((h >> 32) << 32) | (uint64_t)(start + 1);
+		}
+	}
+
+	return ret;
+}
+
+
+typedef struct _REF_PROFILE_CONTEXT {
+	PREF_PROFILE Profile;
+	/** Hash table of each thread. */
+	uint64_t *Tables;
+	size_t TableSize;
+} REF_PROFILE_CONTEXT, *PREF_PROFILE_CONTEXT;
+
+
+static void _ref_profile_worker(void *Data, long WindowIndex, size_t ThreadNo)
+{
+	PREF_PROFILE_CONTEXT Context = (PREF_PROFILE_CONTEXT)Data;
+	PREF_PROFILE p = Context->Profile;
+	uint64_t *table = Context->Tables + ThreadNo*Context->TableSize;
+	size_t lo = 0;
+	size_t hi = p->RegionCount;
+	const ACTIVE_REGION *r = NULL;
+	size_t index = 0;
+	uint64_t offset = 0;
+
+	// The last region starting at or before the window
+	while (hi - lo > 1) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (p->RegionStarts[mid] <= (size_t)WindowIndex)
+			lo = mid;
+		else hi = mid;
+	}
+
+	while (p->RegionStarts[lo + 1] <= (size_t)WindowIndex)
+		++lo;
+
+	r = p->Regions + lo;
+	index = WindowIndex - p->RegionStarts[lo];
+	offset = (index + 1 == p->RegionStarts[lo + 1] - p->RegionStarts[lo]) ? r->Length - p->WindowLength : index*p->WindowStep;
+	p->KMerSizes[WindowIndex] = 0;
+	for (uint32_t k = p->MinKMerSize; k <= p->MaxKMerSize; k += p->KMerStep) {
+		memset(table, 0, Context->TableSize*sizeof(uint64_t));
+		if (_ref_scan(r->Sequence + offset, p->WindowLength, k, table, Context->TableSize, TRUE) == 0) {
+			p->KMerSizes[WindowIndex] = (uint8_t)k;
+			break;
+		}
+	}
+
+	return;
+}
+
+
+/************************************************************************/
+/*                      PUBLIC FUNCTIONS                                */
+/************************************************************************/
+
+
+/** @brief
+ *  Counts positions of a sequence whose k-mer occurs at a lower position too.
+ *
+ *  @param Sequence The sequence.
+ *  @param Length Length of the sequence.
+ *  @param KMerSize Size of the k-mers.
+ *  @param Count Receives the number of repeated k-mers.
+ */
+ERR_VALUE ref_count_repeats(const char *Sequence, const size_t Length, const uint32_t KMerSize, uint32_t *Count)
+{
+	uint64_t *table = NULL;
+	const size_t tableSize = _ref_table_size(Length);
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_calloc_uint64_t(tableSize, &table);
+	if (ret == ERR_SUCCESS) {
+		*Count = _ref_scan(Sequence, Length, KMerSize, table, tableSize, FALSE);
+		utils_free(table);
+	}
+
+	return ret;
+}
+
+
+/** @brief
+ *  Finds the smallest k-mer size without reference repeats for every window
+ *  of the active regions.
+ *
+ *  @param Regions The active regions. Must stay valid while the profile is used.
+ *  @param RegionCount Number of the regions.
+ *  @param WindowLength Length of the windows.
+ *  @param WindowStep Distance between starts of the windows.
+ *  @param MinKMerSize The first k-mer size of the ladder.
+ *  @param MaxKMerSize The maximum k-mer size.
+ *  @param KMerStep Difference between adjacent k-mer sizes of the ladder.
+ *  @param ThreadCount Number of threads to process the windows.
+ *  @param Profile Receives the profile.
+ *
+ *  @remark
+ *  The windows are processed in parallel, so long regions do not keep one
+ *  thread busy. The k-mer sizes must fit into 8 bits.
+ */
+ERR_VALUE ref_profile_build(const ACTIVE_REGION *Regions, const size_t RegionCount, const uint32_t WindowLength, const uint32_t WindowStep, const uint32_t MinKMerSize, const uint32_t MaxKMerSize, const uint32_t KMerStep, const int ThreadCount, PREF_PROFILE Profile)
+{
+	REF_PROFILE_CONTEXT ctx;
+	const size_t threadCount = (ThreadCount > 1) ? ThreadCount : 1;
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Profile, 0, sizeof(REF_PROFILE));
+	Profile->Regions = Regions;
+	Profile->RegionCount = RegionCount;
+	Profile->WindowLength = WindowLength;
+	Profile->WindowStep = WindowStep;
+	Profile->MinKMerSize = MinKMerSize;
+	Profile->MaxKMerSize = min(MaxKMerSize, 255);
+	Profile->KMerStep = KMerStep;
+	ret = utils_calloc_size_t(RegionCount + 1, &Profile->RegionStarts);
+	if (ret == ERR_SUCCESS) {
+		for (size_t i = 0; i < RegionCount; ++i) {
+			const ACTIVE_REGION *r = Regions + i;
+
+			Profile->RegionStarts[i] = Profile->WindowCount;
+			if (r->Type == artValid && r->Length >= WindowLength)
+				Profile->WindowCount += (r->Length - WindowLength + WindowStep - 1) / WindowStep + 1;
+		}
+
+		Profile->RegionStarts[RegionCount] = Profile->WindowCount;
+		ret = utils_calloc_uint8_t(max(Profile->WindowCount, 1), &Profile->KMerSizes);
+		if (ret == ERR_SUCCESS) {
+			ctx.Profile = Profile;
+			ctx.TableSize = _ref_table_size(WindowLength);
+			ret = utils_calloc_uint64_t(threadCount*ctx.TableSize, &ctx.Tables);
+			if (ret == ERR_SUCCESS) {
+				if (RegionCount > 0)
+					kt_for((int)threadCount, _ref_profile_worker, &ctx, (long)Profile->WindowCount);
+
+				utils_free(ctx.Tables);
+			}
+
+			if (ret != ERR_SUCCESS)
+				utils_free(Profile->KMerSizes);
+		}
+
+		if (ret != ERR_SUCCESS)
+			utils_free(Profile->RegionStarts);
+	}
+
+	return ret;
+}
+
+
+void ref_profile_finit(PREF_PROFILE Profile)
+{
+	utils_free(Profile->KMerSizes);
+	utils_free(Profile->RegionStarts);
+
+	return;
+}
+
+
+/** @brief
+ *  Returns the smallest unique k-mer size of a window, 0 if there is none.
+ *
+ *  @param Profile The profile.
+ *  @param RegionIndex Index of the active region the window belongs to.
+ *  @param WindowOffset Start of the window relative to the region.
+ */
+uint32_t ref_profile_kmer_size(const REF_PROFILE *Profile, const size_t RegionIndex, const uint64_t WindowOffset)
+{
+	const size_t first = Profile->RegionStarts[RegionIndex];
+	const size_t count = Profile->RegionStarts[RegionIndex + 1] - first;
+	uint32_t ret = 0;
+
+	if (count > 0) {
+		const ACTIVE_REGION *r = Profile->Regions + RegionIndex;
+		const size_t index = (WindowOffset == r->Length - Profile->WindowLength) ? count - 1 : (size_t)(WindowOffset / Profile->WindowStep);
+
+		ret = Profile->KMerSizes[first + index];
+	}
+
+	return ret;
+}
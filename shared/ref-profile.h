@@ -0,0 +1,44 @@
+
+#ifndef __GASSM_REF_PROFILE_H__
+#define __GASSM_REF_PROFILE_H__
+
+
+#include <stdint.h>
+#include "err.h"
+#include "utils.h"
+#include "input-file.h"
+
+
+/** K-mer sizes at which windows of the reference contain no repeated k-mers.
+ *
+ *  Windows of each valid active region start every WindowStep bases, the last
+ *  window is aligned to the end of the region. Only k-mer sizes of the ladder
+ *  MinKMerSize, MinKMerSize + KMerStep, ... up to MaxKMerSize are tried. K-mers
+ *  containing bases other than A, C, G and T are ignored.
+ */
+typedef struct _REF_PROFILE {
+	/** The smallest unique k-mer size of each window, 0 if there is none in the ladder. */
+	uint8_t *KMerSizes;
+	size_t WindowCount;
+	/** Index of the first window of each active region, windows of regions that are
+	 *  not valid or are too short are not counted. */
+	size_t *RegionStarts;
+	size_t RegionCount;
+	const ACTIVE_REGION *Regions;
+	uint32_t WindowLength;
+	uint32_t WindowStep;
+	uint32_t MinKMerSize;
+	uint32_t MaxKMerSize;
+	uint32_t KMerStep;
+} REF_PROFILE, *PREF_PROFILE;
+
+
+ERR_VALUE ref_count_repeats(const char *Sequence, const size_t Length, const uint32_t KMerSize, uint32_t *Count);
+
+ERR_VALUE ref_profile_build(const ACTIVE_REGION *Regions, const size_t RegionCount, const uint32_t WindowLength, const uint32_t WindowStep, const uint32_t MinKMerSize, const uint32_t MaxKMerSize, const uint32_t KMerStep, const int ThreadCount, PREF_PROFILE Profile);
+void ref_profile_finit(PREF_PROFILE Profile);
+uint32_t ref_profile_kmer_size(const REF_PROFILE *Profile, const size_t RegionIndex, const uint64_t WindowOffset);
+
+
+
+#endif
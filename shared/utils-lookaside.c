@@ -4,58 +4,88 @@
 #include "utils-lookaside.h"
 
 
+#define LOOKASIDE_SLAB_HEADER_SIZE		((sizeof(UTILS_LOOKASIDE_SLAB) + 15) & ~(size_t)15)
 
 
-
-ERR_VALUE utils_lookaside_init(PUTILS_LOOKASIDE Lookaside, const size_t BlockSize, const size_t Count)
+static ERR_VALUE _lookaside_slab_alloc(PUTILS_LOOKASIDE Lookaside, PUTILS_LOOKASIDE_SLAB *Slab)
 {
+	PUTILS_LOOKASIDE_SLAB tmp = NULL;
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
-	Lookaside->BlockSize = BlockSize;
-	Lookaside->PreallocatedCount = Count;
-	ret = utils_calloc(Count, BlockSize, &Lookaside->PreallocatedArea);
+	ret = utils_malloc(LOOKASIDE_SLAB_HEADER_SIZE + Lookaside->BlockSize*Lookaside->SlabBlockCount, (void **)&tmp);
 	if (ret == ERR_SUCCESS) {
-		PUTILS_LOOKASIDE_BLOCK block = Lookaside->PreallocatedArea;
-		
-		for (size_t i = 0; i < Count - 1; ++i) {
-			block->Next = (PUTILS_LOOKASIDE_BLOCK)((unsigned char *)block + BlockSize);
-			block = block->Next;
-		}
-
-		block->Next = NULL;
-		Lookaside->Block = Lookaside->PreallocatedArea;
+		tmp->Next = NULL;
+		*Slab = tmp;
 	}
 
 	return ret;
 }
 
 
+ERR_VALUE utils_lookaside_init(PUTILS_LOOKASIDE Lookaside, const size_t BlockSize, const size_t Count)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	memset(Lookaside, 0, sizeof(UTILS_LOOKASIDE));
+	Lookaside->BlockSize = UTILS_LOOKASIDE_BLOCK_SIZE(BlockSize);
+	Lookaside->SlabBlockCount = max(Count, 1);
+	ret = _lookaside_slab_alloc(Lookaside, &Lookaside->Slabs);
+	if (ret == ERR_SUCCESS)
+		Lookaside->CurrentSlab = Lookaside->Slabs;
+
+	return ret;
+}
+
+
 void utils_lookaside_finit(PUTILS_LOOKASIDE Lookaside)
 {
-	PUTILS_LOOKASIDE_BLOCK block = NULL;
-	PUTILS_LOOKASIDE_BLOCK old = NULL;
-
-	block = Lookaside->Block;
-	while (block != NULL) {
-		old = block;
-		block = block->Next;
-		if (!in_range(Lookaside->PreallocatedArea, Lookaside->BlockSize*Lookaside->PreallocatedCount, old))
-			utils_free(old);
+	PUTILS_LOOKASIDE_SLAB slab = NULL;
+	PUTILS_LOOKASIDE_SLAB old = NULL;
+
+	slab = Lookaside->Slabs;
+	while (slab != NULL) {
+		old = slab;
+		slab = slab->Next;
+		utils_free(old);
 	}
 
-	utils_free(Lookaside->PreallocatedArea);
+	memset(Lookaside, 0, sizeof(UTILS_LOOKASIDE));
 
 	return;
 }
 
+
 ERR_VALUE utils_lookaside_alloc(PUTILS_LOOKASIDE Lookaside, void **Block)
 {
 	ERR_VALUE ret = ERR_INTERNAL_ERROR;
 
+	ret = ERR_SUCCESS;
 	if (Lookaside->Block != NULL) {
 		*Block = Lookaside->Block;
 		Lookaside->Block = Lookaside->Block->Next;
-	} else ret = utils_malloc(Lookaside->BlockSize, Block);
+		++Lookaside->Hits;
+	} else {
+		PUTILS_LOOKASIDE_SLAB slab = Lookaside->CurrentSlab;
+
+		if (Lookaside->CurrentSlabUsed == Lookaside->SlabBlockCount) {
+			if (slab->Next == NULL) {
+				ret = _lookaside_slab_alloc(Lookaside, &slab->Next);
+				if (ret == ERR_SUCCESS)
+					++Lookaside->Misses;
+			} else ++Lookaside->Hits;
+
+			if (ret == ERR_SUCCESS) {
+				slab = slab->Next;
+				Lookaside->CurrentSlab = slab;
+				Lookaside->CurrentSlabUsed = 0;
+			}
+		} else ++Lookaside->Hits;
+
+		if (ret == ERR_SUCCESS) {
+			*Block = (unsigned char *)slab + LOOKASIDE_SLAB_HEADER_SIZE + Lookaside->CurrentSlabUsed*Lookaside->BlockSize;
+			++Lookaside->CurrentSlabUsed;
+		}
+	}
 
 	return ret;
 }
@@ -70,3 +100,21 @@ void utils_lookaside_free(PUTILS_LOOKASIDE Lookaside, void *Block)
 
 	return;
 }
+
+
+/** @brief
+ *  Returns all blocks to the pool at once.
+ *
+ *  @param Lookaside The pool.
+ *
+ *  @remark
+ *  The slabs are kept and reused by subsequent allocations.
+ */
+void utils_lookaside_reset(PUTILS_LOOKASIDE Lookaside)
+{
+	Lookaside->Block = NULL;
+	Lookaside->CurrentSlab = Lookaside->Slabs;
+	Lookaside->CurrentSlabUsed = 0;
+
+	return;
+}
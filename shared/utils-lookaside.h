@@ -11,21 +11,46 @@ typedef struct _UTILS_LOOKASIDE_BLOCK {
 	struct _UTILS_LOOKASIDE_BLOCK *Next;
 } UTILS_LOOKASIDE_BLOCK, *PUTILS_LOOKASIDE_BLOCK;
 
+/** Continuous area holding @SlabBlockCount blocks. The blocks follow the header. */
+typedef struct _UTILS_LOOKASIDE_SLAB {
+	struct _UTILS_LOOKASIDE_SLAB *Next;
+} UTILS_LOOKASIDE_SLAB, *PUTILS_LOOKASIDE_SLAB;
+
+/** Pool of blocks of the same size.
+ *
+ *  Freed blocks are kept in a list and reused first. New blocks are carved from slabs
+ *  that are allocated @SlabBlockCount blocks at a time, so the heap is touched only
+ *  once per slab. The pool can be emptied in constant time by utils_lookaside_reset(),
+ *  the slabs are reused afterwards.
+ */
 typedef struct _UTILS_LOOKASIDE {
 	size_t BlockSize;
-	size_t PreallocatedCount;
-	boolean Initialized;
-	PUTILS_LOOKASIDE_BLOCK PreallocatedArea;
+	size_t SlabBlockCount;
+	/** List of all slabs. */
+	PUTILS_LOOKASIDE_SLAB Slabs;
+	/** Slab new blocks are taken from. */
+	PUTILS_LOOKASIDE_SLAB CurrentSlab;
+	/** Number of blocks already taken from the current slab. */
+	size_t CurrentSlabUsed;
+	/** Freed blocks. */
 	PUTILS_LOOKASIDE_BLOCK Block;
+	/** Allocations served without asking the heap. */
+	size_t Hits;
+	/** Allocations that required a new slab. */
+	size_t Misses;
 } UTILS_LOOKASIDE, *PUTILS_LOOKASIDE;
 
 UTILS_TYPED_CALLOC_FUNCTION(PUTILS_LOOKASIDE)
 
+/** Size of blocks of a lookaside created for objects of @aSize bytes. */
+#define UTILS_LOOKASIDE_BLOCK_SIZE(aSize)				((max((aSize), sizeof(UTILS_LOOKASIDE_BLOCK)) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
 
 ERR_VALUE utils_lookaside_init(PUTILS_LOOKASIDE Lookaside, const size_t BlockSize, const size_t Count);
 void utils_lookaside_finit(PUTILS_LOOKASIDE Lookaside);
 ERR_VALUE utils_lookaside_alloc(PUTILS_LOOKASIDE Lookaside, void **Block);
 void utils_lookaside_free(PUTILS_LOOKASIDE Lookaside, void *Block);
+void utils_lookaside_reset(PUTILS_LOOKASIDE Lookaside);
 
 
 
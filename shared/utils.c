@@ -368,3 +368,126 @@ size_t utils_pow_mod(const size_t Base, const size_t Power, const size_t Modulus
 	return ret;
 }
 
+
+/************************************************************************/
+/*                      ARENA ALLOCATOR                                 */
+/************************************************************************/
+
+#define ARENA_CHUNK_HEADER_SIZE				((sizeof(UTILS_ARENA_CHUNK) + UTILS_ARENA_ALIGNMENT - 1) & ~(size_t)(UTILS_ARENA_ALIGNMENT - 1))
+
+
+ERR_VALUE utils_arena_init(PUTILS_ARENA Arena, const size_t ChunkSize)
+{
+	memset(Arena, 0, sizeof(UTILS_ARENA));
+	Arena->ChunkSize = ChunkSize;
+
+	return ERR_SUCCESS;
+}
+
+
+void utils_arena_finit(PUTILS_ARENA Arena)
+{
+	PUTILS_ARENA_CHUNK c = Arena->First;
+	PUTILS_ARENA_CHUNK old = NULL;
+
+	while (c != NULL) {
+		old = c;
+		c = c->Next;
+		utils_free(old);
+	}
+
+	memset(Arena, 0, sizeof(UTILS_ARENA));
+
+	return;
+}
+
+
+/** @brief
+ *  Allocates a block of memory from an arena.
+ *
+ *  @param Arena The arena.
+ *  @param Size Size of the block, in bytes.
+ *  @param Address Receives address of the block.
+ *
+ *  @remark
+ *  The block is aligned to UTILS_ARENA_ALIGNMENT bytes. When the current chunk is full,
+ *  the next one (kept from before the last reset) is reused, if it is large enough.
+ */
+ERR_VALUE utils_arena_alloc(PUTILS_ARENA Arena, const size_t Size, void **Address)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+	const size_t size = (Size + UTILS_ARENA_ALIGNMENT - 1) & ~(size_t)(UTILS_ARENA_ALIGNMENT - 1);
+	PUTILS_ARENA_CHUNK c = Arena->Current;
+
+	ret = ERR_SUCCESS;
+	if (c == NULL || c->Used + size > c->Size) {
+		PUTILS_ARENA_CHUNK next = (c != NULL) ? c->Next : Arena->First;
+
+		if (next != NULL && next->Size >= size) {
+			next->Used = 0;
+			c = next;
+		} else {
+			PUTILS_ARENA_CHUNK tmp = NULL;
+			const size_t chunkSize = max(Arena->ChunkSize, size);
+
+			ret = utils_malloc(ARENA_CHUNK_HEADER_SIZE + chunkSize, (void **)&tmp);
+			if (ret == ERR_SUCCESS) {
+				tmp->Size = chunkSize;
+				tmp->Used = 0;
+				tmp->Next = next;
+				if (c != NULL)
+					c->Next = tmp;
+				else Arena->First = tmp;
+
+				Arena->BytesReserved += chunkSize;
+				c = tmp;
+			}
+		}
+
+		if (ret == ERR_SUCCESS)
+			Arena->Current = c;
+	}
+
+	if (ret == ERR_SUCCESS) {
+		*Address = (unsigned char *)c + ARENA_CHUNK_HEADER_SIZE + c->Used;
+		c->Used += size;
+		Arena->BytesUsed += size;
+		if (Arena->PeakBytesUsed < Arena->BytesUsed)
+			Arena->PeakBytesUsed = Arena->BytesUsed;
+	}
+
+	return ret;
+}
+
+
+ERR_VALUE utils_arena_calloc(PUTILS_ARENA Arena, const size_t Count, const size_t Size, void **Address)
+{
+	ERR_VALUE ret = ERR_INTERNAL_ERROR;
+
+	ret = utils_arena_alloc(Arena, Count*Size, Address);
+	if (ret == ERR_SUCCESS)
+		memset(*Address, 0, Count*Size);
+
+	return ret;
+}
+
+
+/** @brief
+ *  Releases all blocks allocated from an arena at once.
+ *
+ *  @param Arena The arena.
+ *
+ *  @remark
+ *  The chunks are not freed, they are reused by subsequent allocations. Only the
+ *  first chunk is touched, so the operation takes constant time.
+ */
+void utils_arena_reset(PUTILS_ARENA Arena)
+{
+	Arena->Current = Arena->First;
+	if (Arena->First != NULL)
+		Arena->First->Used = 0;
+
+	Arena->BytesUsed = 0;
+
+	return;
+}
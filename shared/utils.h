@@ -114,6 +114,41 @@ void utils_allocator_check(void);
 #endif
 
 
+/** One block of memory owned by an arena. The data follow the header. */
+typedef struct _UTILS_ARENA_CHUNK {
+	struct _UTILS_ARENA_CHUNK *Next;
+	/** Number of data bytes the chunk can hold. */
+	size_t Size;
+	/** Number of data bytes already handed out. */
+	size_t Used;
+} UTILS_ARENA_CHUNK, *PUTILS_ARENA_CHUNK;
+
+/** Bump allocator. Individual allocations are never freed, the whole arena is
+ *  recycled by utils_arena_reset() which keeps the chunks for later use.
+ */
+typedef struct _UTILS_ARENA {
+	PUTILS_ARENA_CHUNK First;
+	PUTILS_ARENA_CHUNK Current;
+	/** Minimum size of a newly allocated chunk. */
+	size_t ChunkSize;
+	/** Bytes handed out since the last reset. */
+	size_t BytesUsed;
+	/** Maximum value of @BytesUsed, cleared by the caller when needed. */
+	size_t PeakBytesUsed;
+	/** Total size of all chunks. */
+	size_t BytesReserved;
+} UTILS_ARENA, *PUTILS_ARENA;
+
+#define UTILS_ARENA_ALIGNMENT						16
+#define UTILS_ARENA_DEFAULT_CHUNK_SIZE				(1024*1024)
+
+ERR_VALUE utils_arena_init(PUTILS_ARENA Arena, const size_t ChunkSize);
+void utils_arena_finit(PUTILS_ARENA Arena);
+ERR_VALUE utils_arena_alloc(PUTILS_ARENA Arena, const size_t Size, void **Address);
+ERR_VALUE utils_arena_calloc(PUTILS_ARENA Arena, const size_t Count, const size_t Size, void **Address);
+void utils_arena_reset(PUTILS_ARENA Arena);
+
+
 void *_utils_alloc_mark(void);
 boolean _utils_alloc_diff(void *Mark);
 ERR_VALUE utils_allocator_init(const size_t NumberOfThreads);